@@ -8,12 +8,35 @@ labels = []
 
 ticks = range(0, 100, 10)
 
+# Header of the .tcol column files written by the visualizer and postprocess_case, see src/file/column_io.hpp.
+tcol_header = np.dtype([('magic', 'S8'), ('version', '<u4'), ('dtype', '<u4'), ('data_offset', '<u8'),
+                        ('rank', '<u4'), ('reserved', '<u4'), ('shape', '<u8', 4), ('chunk_rows', '<u8'),
+                        ('chunk_count', '<u8'), ('field_name', 'S64'), ('step', 'S32')])
+
+
+def load_tcol(path):
+    header = np.fromfile(path, dtype=tcol_header, count=1)[0]
+    if header['magic'] != b'TOSTFCOL':
+        raise ValueError(path + " is no column file")
+    shape = tuple(int(s) for s in header['shape'][:header['rank']])
+    return np.memmap(path, dtype='<f4', mode='r', offset=int(header['data_offset']), shape=shape)
+
+
 for subdir in os.listdir(root_dir):
     dir_path = os.path.join(root_dir, subdir)
     labels.append(subdir)
     for f in os.listdir(dir_path):
         if "wallShearStress" in f:  # change type of variable here
-            data = np.genfromtxt(os.path.join(dir_path, f))
+            if f.endswith(".npy") or f.endswith(".tcol"):  # binary exports, vector fields are stored per component
+                if f.endswith(".npy"):
+                    data = np.load(os.path.join(dir_path, f), mmap_mode='r')
+                else:
+                    data = load_tcol(os.path.join(dir_path, f))
+                if data.ndim == 2:
+                    data = np.linalg.norm(data, axis=1)
+                data = data[np.isfinite(data)]
+            else:
+                data = np.genfromtxt(os.path.join(dir_path, f))
             data = data[np.nonzero(data)]  # add * 1055 for WSS
             wss.append(data)
 
@@ -0,0 +1,80 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include <utility/logging.hpp>
+#include <utility/event_profiler.hpp>
+#include <data_processing/line_distance.hpp>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+
+// Compares the generic mcpd with the vectorized kernels on random walks of typical streamline length.
+int main(int argc, char** argv) {
+    tostf::cmd::enable_color();
+    const int line_count = argc > 1 ? std::stoi(argv[1]) : 200;
+    const int line_size = argc > 2 ? std::stoi(argv[2]) : 500;
+    std::mt19937 rng(0);
+    std::normal_distribution<float> step(0.0f, 0.01f);
+    std::uniform_real_distribution<float> start(-1.0f, 1.0f);
+    std::vector<glm::vec4> points(static_cast<size_t>(line_count) * line_size);
+    for (int i = 0; i < line_count; ++i) {
+        glm::vec4 p(start(rng), start(rng), start(rng), 1.0f);
+        for (int j = 0; j < line_size; ++j) {
+            p += glm::vec4(step(rng), step(rng), step(rng), 0.0f);
+            points.at(i * line_size + j) = p;
+        }
+    }
+    const auto lines = tostf::Polyline_set::from_fixed_size(points, line_size);
+    const tostf::Polyline_soa soa(lines);
+    std::vector<float> reference(line_count - 1);
+    std::vector<float> vectorized(line_count - 1);
+    std::vector<float> bounded(line_count - 1);
+    const auto reference_time = tostf::profile_func<std::chrono::microseconds>([&]() {
+        for (int i = 0; i < line_count - 1; ++i) {
+            reference.at(i) = tostf::mcpd(lines.begin(i), lines.end(i), lines.begin(i + 1), lines.end(i + 1));
+        }
+    });
+    const auto vectorized_time = tostf::profile_func<std::chrono::microseconds>([&]() {
+        for (int i = 0; i < line_count - 1; ++i) {
+            vectorized.at(i) = tostf::mcpd(soa, i, i + 1);
+        }
+    });
+    std::vector<float> sorted = reference;
+    std::sort(sorted.begin(), sorted.end());
+    const auto threshold = sorted.at(sorted.size() / 10);
+    const auto bounded_time = tostf::profile_func<std::chrono::microseconds>([&]() {
+        for (int i = 0; i < line_count - 1; ++i) {
+            bounded.at(i) = tostf::mcpd_bounded(soa, i, i + 1, threshold);
+        }
+    });
+    std::vector<unsigned> candidates(line_count - 1);
+    std::iota(candidates.begin(), candidates.end(), 1);
+    std::vector<float> one_vs_many;
+    const auto one_vs_many_time = tostf::profile_func<std::chrono::microseconds>([&]() {
+        one_vs_many = tostf::mcpd_one_vs_many(soa, 0, candidates);
+    });
+
+    float max_error = 0.0f;
+    int bound_violations = 0;
+    for (int i = 0; i < line_count - 1; ++i) {
+        max_error = glm::max(max_error, glm::abs(reference.at(i) - vectorized.at(i)));
+        const auto within = reference.at(i) <= threshold;
+        if (within ? glm::abs(bounded.at(i) - vectorized.at(i)) > 0.0f : bounded.at(i) <= threshold) {
+            ++bound_violations;
+        }
+    }
+    tostf::log_section("mcpd of " + std::to_string(line_count - 1) + " pairs with "
+                       + std::to_string(line_size) + " points");
+    tostf::log_event_timing("generic mcpd", reference_time);
+    tostf::log_event_timing("vectorized mcpd", vectorized_time);
+    tostf::log_event_timing("bounded mcpd", bounded_time);
+    tostf::log_event_timing("one vs many mcpd", one_vs_many_time);
+    tostf::log_info() << "Max deviation from generic mcpd: " << max_error;
+    tostf::log_info() << "Bounded threshold " << threshold << ", violations: " << bound_violations;
+    return bound_violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include <geometry/mesh_handling.hpp>
+#include <file/file_handling.hpp>
+#include <utility/logging.hpp>
+#include <utility/event_profiler.hpp>
+#include <mesh_processing/structured_mesh.hpp>
+#include <preprocessing/inlet_detection.hpp>
+#include <preprocessing/mesh_deformation.hpp>
+#include "assimp/postprocess.h"
+#include <sstream>
+#include <string>
+
+// Usage: deform_meshes <mesh> <output directory> [count] [seed] [variation] [inlet count]
+// Writes one obj per deformation and the parameters of every deformation to deformations.csv.
+// If an inlet count is given the inlets are detected automatically and preserved.
+int main(int argc, char** argv) {
+    tostf::cmd::enable_color();
+    if (argc < 3) {
+        tostf::log_error() << "Usage: deform_meshes <mesh> <output directory> [count] [seed] [variation] [inlet count]";
+        return 1;
+    }
+    const std::filesystem::path mesh_path(argv[1]);
+    const std::filesystem::path out_path(argv[2]);
+    const int count = argc > 3 ? std::stoi(argv[3]) : 200;
+    const uint64_t seed = argc > 4 ? std::stoull(argv[4]) : 0;
+    const float variation = argc > 5 ? std::stof(argv[5]) : 0.2f;
+    const int inlet_count = argc > 6 ? std::stoi(argv[6]) : 0;
+
+    tostf::Event_profiler<std::chrono::milliseconds> profiler;
+    profiler.start();
+    auto loaded_mesh = tostf::load_single_mesh(mesh_path, 0, false, aiProcess_PreTransformVertices);
+    if (!loaded_mesh) {
+        tostf::log_error() << "No mesh in file at path: " << mesh_path.string();
+        return 1;
+    }
+    auto mesh = loaded_mesh.value();
+    const auto mesh_bb = tostf::calculate_bounding_box(mesh->vertices);
+    mesh->join_vertices(1e-6f * distance(glm::vec3(mesh_bb.min), glm::vec3(mesh_bb.max)));
+    tostf::log_event_timing("Loading mesh", profiler.lap());
+
+    std::vector<tostf::Inlet> inlets;
+    if (inlet_count > 0) {
+        const tostf::Structured_mesh structured(mesh);
+        inlets = tostf::detect_inlets_automatically(structured, inlet_count, static_cast<unsigned>(seed));
+        tostf::log_event_timing("Detecting inlets", profiler.lap());
+    }
+
+    const auto params = tostf::gen_deformation_params(tostf::Deformation_params{}, variation, count, seed);
+    std::vector<std::vector<tostf::Deformation_bump>> bumps(count);
+    for (int i = 0; i < count; ++i) {
+        bumps.at(i) = tostf::gen_deformation_bumps(params.at(i), mesh_bb, seed, static_cast<uint64_t>(i));
+    }
+    const auto deformed = tostf::deform_vertices_batch(mesh->vertices, params, bumps, inlets);
+    tostf::log_event_timing("Deforming " + std::to_string(count) + " meshes", profiler.lap());
+
+    std::filesystem::create_directories(out_path);
+    std::stringstream csv;
+    csv << "name,iterations,gauss_variance,rayleigh_variance,rayleigh_shift,scale\n";
+    auto deformed_mesh = std::make_shared<tostf::Mesh>(*mesh);
+    // The normals of the reference do not fit the deformed surfaces.
+    deformed_mesh->normals.clear();
+    for (int i = 0; i < count; ++i) {
+        const auto name = "deformation_" + std::to_string(i + 1);
+        deformed_mesh->vertices = deformed.at(i);
+        tostf::export_geom_as_obj(deformed_mesh, out_path / (name + ".obj"));
+        const auto& p = params.at(i);
+        csv << name << "," << p.iterations << "," << p.gauss_variance << "," << p.rayleigh_variance << ","
+            << p.rayleigh_shift << "," << p.scale << "\n";
+    }
+    tostf::save_str_to_file(out_path / "deformations.csv", csv.str());
+    tostf::log_event_timing("Exporting meshes", profiler.lap());
+    return 0;
+}
@@ -0,0 +1,119 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include <foam_processing/case_export.hpp>
+#include <utility/logging.hpp>
+#include <utility/event_profiler.hpp>
+#include <sstream>
+#include <string>
+
+// Usage: postprocess_case <case> <output directory> [options]
+//   --fields p,U,wallShearStress  fields to export, all fields of the first step by default
+//   --format npy|columns|csv      float32 .npy files (default), float32 .tcol column files or CSV
+//   --temporal wallShearStress    fields reduced over all steps into mean, RMS, min, max, TAWSS and OSI
+//   --reference <case>            also export the differences to the steps of the same name of a reference case
+//   --interpolate                 interpolate the reference values from the 8 nearest datapoints for differences
+//   --volume <resolution>         also export voxel volumes with resolution voxels along the longest side
+//   --skip-first                  skip the earliest time step, e.g. the initial conditions in 0
+//   --no-datapoints               do not export the positions of the cells and boundary faces
+//   --no-statistics               do not write statistics.csv
+//   --verify                      read every .npy or .tcol file back and compare it to the exported values
+int main(int argc, char** argv) {
+    tostf::cmd::enable_color();
+    const std::string usage = "Usage: postprocess_case <case> <output directory> [--fields a,b,...] "
+                              "[--format npy|columns|csv] [--temporal a,b,...] "
+                              "[--reference <case>] [--interpolate] "
+                              "[--volume <resolution>] [--skip-first] [--no-datapoints] [--no-statistics] [--verify]";
+    if (argc < 3) {
+        tostf::log_error() << usage;
+        return 1;
+    }
+    const std::filesystem::path case_path(argv[1]);
+    const std::filesystem::path out_path(argv[2]);
+    tostf::foam::Case_export_settings settings;
+    for (int i = 3; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--fields" && i + 1 < argc) {
+            std::stringstream fields(argv[++i]);
+            std::string field;
+            while (std::getline(fields, field, ',')) {
+                if (!field.empty()) {
+                    settings.fields.push_back(field);
+                }
+            }
+        }
+        else if (arg == "--temporal" && i + 1 < argc) {
+            std::stringstream fields(argv[++i]);
+            std::string field;
+            while (std::getline(fields, field, ',')) {
+                if (!field.empty()) {
+                    settings.temporal_fields.push_back(field);
+                }
+            }
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            const std::string format(argv[++i]);
+            if (format == "npy") {
+                settings.format = tostf::foam::export_format::npy;
+            }
+            else if (format == "columns") {
+                settings.format = tostf::foam::export_format::columns;
+            }
+            else if (format == "csv") {
+                settings.format = tostf::foam::export_format::csv;
+            }
+            else {
+                tostf::log_error() << "Unknown format " << format << "\n" << usage;
+                return 1;
+            }
+        }
+        else if (arg == "--reference" && i + 1 < argc) {
+            settings.reference_case = argv[++i];
+        }
+        else if (arg == "--interpolate") {
+            settings.correspondence = tostf::foam::correspondence_mode::interpolated;
+        }
+        else if (arg == "--volume" && i + 1 < argc) {
+            settings.volume_resolution = std::stoi(argv[++i]);
+        }
+        else if (arg == "--skip-first") {
+            settings.skip_first = true;
+        }
+        else if (arg == "--no-datapoints") {
+            settings.datapoints = false;
+        }
+        else if (arg == "--no-statistics") {
+            settings.statistics = false;
+        }
+        else if (arg == "--verify") {
+            settings.verify = true;
+        }
+        else {
+            tostf::log_error() << "Unknown argument " << arg << "\n" << usage;
+            return 1;
+        }
+    }
+    if (!exists(case_path / "constant" / "polyMesh")) {
+        tostf::log_error() << "No polyMesh in case at path: " << case_path.string();
+        return 1;
+    }
+    if (!settings.reference_case.empty() && !exists(settings.reference_case / "constant" / "polyMesh")) {
+        tostf::log_error() << "No polyMesh in reference case at path: " << settings.reference_case.string();
+        return 1;
+    }
+    tostf::Event_profiler<std::chrono::milliseconds> profiler;
+    profiler.start();
+    try {
+        tostf::foam::export_case(case_path, out_path, settings);
+    }
+    catch (const std::exception& e) {
+        tostf::log_error() << e.what();
+        return 1;
+    }
+    tostf::log_event_timing("Exporting case " + case_path.string(), profiler.lap());
+    return 0;
+}
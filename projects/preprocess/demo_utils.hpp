@@ -22,6 +22,7 @@
 #include "mesh_processing/structured_mesh.hpp"
 #include <preprocessing/inlet_detection.hpp>
 #include <preprocessing/mesh_deformation.hpp>
+#include <preprocessing/remeshing.hpp>
 #include <preprocessing/openfoam_exporter.hpp>
 #include "iconfont/IconsMaterialDesignIcons_c.h"
 #include "glm/gtx/component_wise.hpp"
@@ -272,6 +273,8 @@ struct Step_results {
     Split_mesh split_mesh;
     std::unique_ptr<tostf::Texture2D> reference_picture = nullptr;
     std::vector<tostf::Deformed_mesh> deformed;
+    // Gallery picture of every deformed mesh, kept here as the deformation library has no GL types.
+    std::vector<std::unique_ptr<tostf::Texture2D>> deformed_pictures;
     float min_dist_to_ref{};
     float max_dist_to_ref{};
 };
@@ -305,6 +308,10 @@ struct Deformation_control {
         str << current << "/" << iterations;
         return str.str();
     }
+
+    inline tostf::Deformation_params to_params() const {
+        return {iterations, gauss_variance, rayleigh_variance, rayleigh_shift, scale};
+    }
 };
 
 struct Deformation_settings {
@@ -321,47 +328,29 @@ struct Deformation_settings {
     std::vector<Deformation_control> controls;
     int active_view = -1;
     bool was_run = false;
+    uint64_t seed = 0;
+    std::atomic<bool> cancel{false};
     std::future<void> future;
 
+    // The running deformation is cancelled first, so dropping the future does not wait for the whole batch.
     inline void stop() {
+        cancel = true;
         was_run = true;
         future = std::future<void>();
     }
 
     inline void reset() {
+        seed = std::random_device{}();
+        const auto params = tostf::gen_deformation_params(control_reference.to_params(), value_variance_in_percent,
+                                                          deformation_count, seed);
         controls.clear();
         controls.resize(deformation_count);
-        if (value_variance_in_percent == 0.0f) {
-            for (auto& c : controls) {
-                c.iterations = control_reference.iterations;
-                c.gauss_variance = control_reference.gauss_variance;
-                c.rayleigh_variance = control_reference.rayleigh_variance;
-                c.rayleigh_shift = control_reference.rayleigh_shift;
-                c.scale = control_reference.scale;
-            }
-        }
-        else {
-            std::random_device rd{};
-            std::mt19937 gen{ rd() };
-            std::normal_distribution<float> iter_nd(static_cast<float>(control_reference.iterations),
-                static_cast<float>(
-                    value_variance_in_percent * control_reference.iterations));
-            std::normal_distribution<float> gauss_nd(control_reference.gauss_variance,
-                value_variance_in_percent * control_reference.gauss_variance);
-            std::normal_distribution<float> rayleigh_variance_nd(control_reference.rayleigh_variance,
-                value_variance_in_percent * control_reference.
-                rayleigh_variance);
-            std::normal_distribution<float> shift_nd(control_reference.rayleigh_shift,
-                value_variance_in_percent * control_reference.rayleigh_shift);
-            std::normal_distribution<float> scale_nd(control_reference.scale,
-                value_variance_in_percent * control_reference.scale);
-            for (auto& c : controls) {
-                c.iterations = static_cast<int>(iter_nd(gen));
-                c.gauss_variance = gauss_nd(gen);
-                c.rayleigh_variance = rayleigh_variance_nd(gen);
-                c.rayleigh_shift = shift_nd(gen);
-                c.scale = scale_nd(gen);
-            }
+        for (int i = 0; i < deformation_count; ++i) {
+            controls.at(i).iterations = params.at(i).iterations;
+            controls.at(i).gauss_variance = params.at(i).gauss_variance;
+            controls.at(i).rayleigh_variance = params.at(i).rayleigh_variance;
+            controls.at(i).rayleigh_shift = params.at(i).rayleigh_shift;
+            controls.at(i).scale = params.at(i).scale;
         }
     }
 
@@ -376,6 +365,13 @@ struct Deformation_settings {
     }
 };
 
+struct Remeshing_control {
+    float edge_length_factor = 1.5f;
+    int iterations = 3;
+    float face_ratio = 0.5f;
+    tostf::Remeshing_settings settings;
+};
+
 struct Imgui_settings {
     int bottom_panel_height = 50;
     int top_control_height = 40;
@@ -96,6 +96,7 @@ int main() {
                 std::optional<tostf::Manual_inlet_selection> current_selection;
             } inlet_selector;
             Deformation_settings deform_settings;
+            Remeshing_control remeshing_control;
             id_rendering.update_uniform("model", glm::mat4(1.0f));
             selected_wireframe.update_uniform("model", glm::mat4(1.0f));
             selected_wireframe.update_uniform("line_width", wireframe_settings.line_width);
@@ -167,8 +168,37 @@ int main() {
 
             // Step 1: Open mesh
             bool tested_holes = false;
+            // Builds the data structures, buffers and statistics of a loaded or remeshed mesh.
+            const auto set_mesh = [&results, &cam, &aneurysm, &renderer, &highlight_ssbo, &aneurysm_viewer, &color_ssbo,
+                    &dist_ssbo](const std::shared_ptr<tostf::Mesh>& mesh,
+                                tostf::Event_profiler<std::chrono::milliseconds>& profiler) {
+                aneurysm.init(mesh);
+                log_event_timing("Initializing data structures", profiler.lap());
+                aneurysm.mesh->normals = aneurysm.halfedge->calculate_normals();
+                log_event_timing("Calculating normals", profiler.lap());
+                aneurysm_viewer = std::make_unique<tostf::Aneurysm_viewer>(aneurysm.mesh);
+                results.split_mesh.color_data = std::vector<glm::vec4>(
+                    aneurysm.mesh->vertices.size(), glm::vec4(1.0f));
+                color_ssbo = std::make_unique<tostf::SSBO>(2);
+                color_ssbo->set_data(results.split_mesh.color_data);
+                profiler.pause();
+                cam->set_radius(length(aneurysm.mesh->get_bounding_box().max) * 1.5f);
+                profiler.resume();
+                results.mesh_info.stats = aneurysm.tri_face_mesh->calculate_mesh_stats();
+                results.mesh_info.bounding_box = aneurysm.mesh->get_bounding_box();
+                log_event_timing("Calculate mesh stats", profiler.lap());
+                renderer.vao = std::make_unique<tostf::VAO>();
+                renderer.update_vbos(create_vbos_from_geometry(aneurysm.mesh));
+                renderer.update_ebo(create_ebo_from_geometry(aneurysm.mesh));
+                highlight_ssbo = std::make_unique<tostf::SSBO>(0);
+                const std::vector<float> highlight_data(aneurysm.mesh->vertices.size(), 0.0f);
+                highlight_ssbo->set_data(highlight_data);
+                dist_ssbo = std::make_unique<tostf::SSBO>(3);
+                dist_ssbo->initialize_empty_storage(aneurysm.mesh->vertices.size() * sizeof(float));
+            };
+
             const auto open_mesh = [&settings, &results, &cam, &aneurysm, &renderer, &tested_holes,
-                    &highlight_ssbo, &deform_settings, &aneurysm_viewer, &color_ssbo, &dist_ssbo]() {
+                    &highlight_ssbo, &deform_settings, &aneurysm_viewer, &color_ssbo, &dist_ssbo, &set_mesh]() {
 
                 tested_holes = false;
                 const auto mesh_path = tostf::show_open_file_dialog("Open Mesh", "../../resources/meshes/",
@@ -191,34 +221,15 @@ int main() {
                             settings.reset();
                             results.split_mesh.reset();
                             results.deformed.clear();
+                            results.deformed_pictures.clear();
                             deform_settings.was_run = false;
                             auto mesh = loaded_mesh.value();
                             log_event_timing("Loading mesh", mesh_loading_profiler.lap());
-                            mesh->join_vertices();
+                            // STL exports duplicate every vertex per triangle with rounding noise.
+                            const auto mesh_bb = tostf::calculate_bounding_box(mesh->vertices);
+                            mesh->join_vertices(1e-6f * distance(glm::vec3(mesh_bb.min), glm::vec3(mesh_bb.max)));
                             log_event_timing("Joining vertices", mesh_loading_profiler.lap());
-                            aneurysm.init(mesh);
-                            log_event_timing("Initializing data structures", mesh_loading_profiler.lap());
-                            aneurysm.mesh->normals = aneurysm.halfedge->calculate_normals();
-                            log_event_timing("Calculating normals", mesh_loading_profiler.lap());
-                            aneurysm_viewer = std::make_unique<tostf::Aneurysm_viewer>(aneurysm.mesh);
-                            results.split_mesh.color_data = std::vector<glm::vec4>(
-                                aneurysm.mesh->vertices.size(), glm::vec4(1.0f));
-                            color_ssbo = std::make_unique<tostf::SSBO>(2);
-                            color_ssbo->set_data(results.split_mesh.color_data);
-                            mesh_loading_profiler.pause();
-                            cam->set_radius(length(aneurysm.mesh->get_bounding_box().max) * 1.5f);
-                            mesh_loading_profiler.resume();
-                            results.mesh_info.stats = aneurysm.tri_face_mesh->calculate_mesh_stats();
-                            results.mesh_info.bounding_box = aneurysm.mesh->get_bounding_box();
-                            log_event_timing("Calculate mesh stats", mesh_loading_profiler.lap());
-                            renderer.vao = std::make_unique<tostf::VAO>();
-                            renderer.update_vbos(create_vbos_from_geometry(aneurysm.mesh));
-                            renderer.update_ebo(create_ebo_from_geometry(aneurysm.mesh));
-                            highlight_ssbo = std::make_unique<tostf::SSBO>(0);
-                            const std::vector<float> highlight_data(aneurysm.mesh->vertices.size(), 0.0f);
-                            highlight_ssbo->set_data(highlight_data);
-                            dist_ssbo = std::make_unique<tostf::SSBO>(3);
-                            dist_ssbo->initialize_empty_storage(aneurysm.mesh->vertices.size() * sizeof(float));
+                            set_mesh(mesh, mesh_loading_profiler);
                             settings.finish_step();
                         }
                     }
@@ -416,82 +427,45 @@ int main() {
             dist_legend.set_height(256.0f);
 
             const auto deform_points = [&aneurysm, &deform_settings, &results, &settings, &dist_legend]() {
-                bool finished = false;
-                while (!finished) {
-                    if (deform_settings.was_run) {
-                        break;
-                    }
-                    finished = true;
-                    int offset = 0;
-                    if (deform_settings.append_deforms) {
-                        offset = glm::max(0, static_cast<int>(results.deformed.size() - deform_settings.deformation_count));
-                    }
-        #pragma omp parallel for
-                    for (int c_id = 0; c_id < static_cast<int>(deform_settings.controls.size()); ++c_id) {
-                        if (deform_settings.controls.at(c_id).current < deform_settings.controls.at(c_id).iterations) {
-                            auto random_point = tostf::gen_random_vec(aneurysm.mesh->get_bounding_box().min * 1.5f,
-                                                                            aneurysm.mesh->get_bounding_box().max * 1.5f);
-					        auto random_sign = glm::sign(glm::sign(tostf::gen_random_float_value<float>(-1.0f, 1.0f) + 0.5f));
-					        for (int id = 0; id < static_cast<int>(results.deformed.at(c_id + offset).vertices.size()); id++) {
-						        const auto vert = results.deformed.at(c_id + offset).vertices.at(id);
-						        float dist_to_inlet_weight = 1.0f;
-						        if (deform_settings.preserve_inlets) {
-							        for (const auto& inlet : results.split_mesh.inlets) {
-								        dist_to_inlet_weight = glm::min(dist_to_inlet_weight,
-									        glm::max(glm::max(
-										        abs(length(vert - inlet.center)) -
-										        inlet.radius, 0.0f) / inlet.radius - 0.5f, 0.0f));
-							        }
-						        }
-						        const auto dist_vert = distance(random_point, vert);
-						        const auto gauss_rayleigh =
-							        deform_settings.controls.at(c_id).scale * tostf::math::calc_gauss_rayleigh(
-								        dist_vert, deform_settings.controls.at(c_id).gauss_variance,
-								        deform_settings.controls.at(c_id).rayleigh_variance,
-								        deform_settings.controls.at(c_id).rayleigh_shift);
-						        results.deformed.at(c_id + offset).vertices.at(id) = vert
-							        + (vert - random_point) * random_sign *
-							        gauss_rayleigh * dist_to_inlet_weight;
-					        }
-                            deform_settings.controls.at(c_id).current++;
-                        }
-                        finished = finished && deform_settings.controls.at(c_id).current == deform_settings
-                                                                                            .controls.at(c_id).iterations;
-                    }
+                if (deform_settings.was_run) {
+                    return;
+                }
+                int offset = 0;
+                if (deform_settings.append_deforms) {
+                    offset = glm::max(0, static_cast<int>(results.deformed.size() - deform_settings.deformation_count));
+                }
+                const auto bb = aneurysm.mesh->get_bounding_box();
+                std::vector<tostf::Deformation_params> params;
+                std::vector<std::vector<tostf::Deformation_bump>> bumps;
+                for (int c_id = 0; c_id < static_cast<int>(deform_settings.controls.size()); ++c_id) {
+                    params.push_back(deform_settings.controls.at(c_id).to_params());
+                    bumps.push_back(tostf::gen_deformation_bumps(params.back(), bb, deform_settings.seed, c_id + offset));
+                }
+                std::vector<tostf::Inlet> preserved_inlets;
+                if (deform_settings.preserve_inlets) {
+                    preserved_inlets = results.split_mesh.inlets;
+                }
+                auto deformed = tostf::deform_vertices_batch(aneurysm.mesh->vertices, params, bumps, preserved_inlets,
+                                                             [&deform_settings](const int c_id) {
+                                                                 auto& control = deform_settings.controls.at(c_id);
+                                                                 control.current = control.iterations;
+                                                             }, &deform_settings.cancel);
+                for (int c_id = 0; c_id < static_cast<int>(deformed.size()); ++c_id) {
+                    results.deformed.at(c_id + offset).vertices = std::move(deformed.at(c_id));
                 }
                 for (auto& c : deform_settings.controls) {
                     c.current = 0;
                 }
-                for (auto& d : results.deformed) {
-                    d.distances_to_reference.resize(aneurysm.mesh->vertices.size());
+                // Appended deformations leave the distances of the previous ones untouched.
+                for (int deform_id = offset; deform_id < static_cast<int>(results.deformed.size()); ++deform_id) {
+                    tostf::calc_distances_to_reference(results.deformed.at(deform_id), aneurysm.mesh->vertices,
+                                                       aneurysm.mesh->normals);
                 }
                 results.min_dist_to_ref = FLT_MAX;
                 results.max_dist_to_ref = -FLT_MAX;
-                for (int deform_id = 0; deform_id < static_cast<int>(results.deformed.size()); ++deform_id) {
-                    auto& deformed_verts = results.deformed.at(deform_id).vertices;
-        #pragma omp parallel for
-                    for (int p_id = 0; p_id < static_cast<int>(deformed_verts.size()); ++p_id) {
-                        const auto dir = results.deformed.at(deform_id).vertices.at(p_id) - aneurysm.mesh->vertices.at(p_id);
-                        const auto dist = length(dir);
-                        const auto sign = glm::sign(dot(dir / dist, aneurysm.mesh->normals.at(p_id)));
-                        results.deformed.at(deform_id).distances_to_reference.at(p_id) = dist * sign;
-                    }
-
-                    const auto min_max = std::minmax_element(std::execution::par,
-                                                             results.deformed.at(deform_id).distances_to_reference.begin(),
-                                                             results.deformed.at(deform_id).distances_to_reference.end());
-                    results.deformed.at(deform_id).min_dist_to_ref = *min_max.first;
-                    results.deformed.at(deform_id).max_dist_to_ref = *min_max.second;
-                    results.min_dist_to_ref = glm::min(results.min_dist_to_ref, *min_max.first);
-                    results.max_dist_to_ref = glm::max(results.max_dist_to_ref, *min_max.second);
-                    const auto avg_dist = std::reduce(std::execution::par,
-                                                      results.deformed.at(deform_id).distances_to_reference.begin(),
-                                                      results.deformed.at(deform_id).distances_to_reference.end(), 0.0f);
-                    results.deformed.at(deform_id).avg_dist_to_ref =
-                        avg_dist / static_cast<float>(results.deformed.at(deform_id).vertices.size());
-                    results.deformed.at(deform_id).sd_dist_to_ref = glm::sqrt(tostf::math::variance_seq(
-                        results.deformed.at(deform_id).distances_to_reference, results.deformed.at(deform_id).avg_dist_to_ref));
-
+                for (const auto& d : results.deformed) {
+                    results.min_dist_to_ref = glm::min(results.min_dist_to_ref, d.min_dist_to_ref);
+                    results.max_dist_to_ref = glm::max(results.max_dist_to_ref, d.max_dist_to_ref);
                 }
                 results.min_dist_to_ref = glm::min(results.min_dist_to_ref, -results.max_dist_to_ref);
                 results.max_dist_to_ref = glm::max(-results.min_dist_to_ref, results.max_dist_to_ref);
@@ -541,7 +515,8 @@ int main() {
 
 
             const auto sidebar = [&settings, &results, &inlet_selector, &deform_settings, &imgui_settings, &ms_profiler,
-                    &window, &aneurysm_viewer, &aneurysm, &highlight_ssbo, &color_ssbo, &cam, &deform_points, &renderer]() {
+                    &window, &aneurysm_viewer, &aneurysm, &highlight_ssbo, &color_ssbo, &cam, &deform_points, &renderer,
+                    &remeshing_control, &set_mesh]() {
                 const auto window_flags = ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoCollapse
                                           | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
                 if (settings.step == preprocessing_steps::export_case || settings.step == preprocessing_steps::start_simulation) {
@@ -582,24 +557,38 @@ int main() {
                         ImGui::Separator();
                         ImGui::Text("Triangle area");
                         const auto mesh_scale = results.mesh_info.get_scale();
-                        float scaled_mesh_info_value = mesh_scale * results.mesh_info.stats.area.avg;
+                        float scaled_mesh_info_value = mesh_scale * mesh_scale * results.mesh_info.stats.area.avg;
                         ImGui::InputFloat("average##area", &scaled_mesh_info_value, 0, 0, "%.7fm\xC2\xB2",
                                           ImGuiInputTextFlags_ReadOnly);
-                        scaled_mesh_info_value = mesh_scale * results.mesh_info.stats.area.min;
+                        scaled_mesh_info_value = mesh_scale * mesh_scale
+                                                 * results.mesh_info.stats.area_distribution.quantiles.at(2);
+                        ImGui::InputFloat("median##area", &scaled_mesh_info_value, 0, 0, "%.7fm\xC2\xB2",
+                                          ImGuiInputTextFlags_ReadOnly);
+                        scaled_mesh_info_value = mesh_scale * mesh_scale * results.mesh_info.stats.area.min;
                         ImGui::InputFloat("min##area", &scaled_mesh_info_value, 0, 0, "%.7fm\xC2\xB2",
                                           ImGuiInputTextFlags_ReadOnly);
-                        scaled_mesh_info_value = mesh_scale * results.mesh_info.stats.area.max;
+                        scaled_mesh_info_value = mesh_scale * mesh_scale * results.mesh_info.stats.area.max;
                         ImGui::InputFloat("max##area", &scaled_mesh_info_value, 0, 0, "%.7fm\xC2\xB2",
                                           ImGuiInputTextFlags_ReadOnly);
+                        const auto& area_bins = results.mesh_info.stats.area_distribution.bins;
+                        ImGui::PlotHistogram("##area_histogram", area_bins.data(), static_cast<int>(area_bins.size()),
+                                             0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
                         ImGui::Separator();
                         ImGui::Text("Edge length");
                         scaled_mesh_info_value = mesh_scale * results.mesh_info.stats.edge_length.avg;
                         ImGui::InputFloat("average##edge", &scaled_mesh_info_value, 0, 0, "%.7fm",
                                           ImGuiInputTextFlags_ReadOnly);
+                        scaled_mesh_info_value = mesh_scale
+                                                 * results.mesh_info.stats.edge_length_distribution.quantiles.at(2);
+                        ImGui::InputFloat("median##edge", &scaled_mesh_info_value, 0, 0, "%.7fm",
+                                          ImGuiInputTextFlags_ReadOnly);
                         scaled_mesh_info_value = mesh_scale * results.mesh_info.stats.edge_length.min;
                         ImGui::InputFloat("min##edge", &scaled_mesh_info_value, 0, 0, "%.7fm", ImGuiInputTextFlags_ReadOnly);
                         scaled_mesh_info_value = mesh_scale * results.mesh_info.stats.edge_length.max;
                         ImGui::InputFloat("max##edge", &scaled_mesh_info_value, 0, 0, "%.7fm", ImGuiInputTextFlags_ReadOnly);
+                        const auto& edge_bins = results.mesh_info.stats.edge_length_distribution.bins;
+                        ImGui::PlotHistogram("##edge_histogram", edge_bins.data(), static_cast<int>(edge_bins.size()),
+                                             0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
                         ImGui::Separator();
                         ImGui::Text("Volume");
                         scaled_mesh_info_value = mesh_scale * mesh_scale * mesh_scale * results.mesh_info.stats.volume;
@@ -613,6 +602,35 @@ int main() {
                         scaled_bb = results.mesh_info.bounding_box.max * mesh_scale;
                         ImGui::InputFloat3("min##boundingbox", value_ptr(scaled_bb), "%.5fm");
                         ImGui::PopItemWidth();
+                        ImGui::Separator();
+                        ImGui::Text("Surface resolution");
+                        ImGui::PushItemWidth(-100.0f);
+                        ImGui::DragFloat("feature angle", &remeshing_control.settings.feature_angle, 1.0f, 1.0f, 180.0f,
+                                         "%.0f deg");
+                        ImGui::DragFloat("edge length", &remeshing_control.edge_length_factor, 0.05f, 0.25f, 10.0f,
+                                         "%.2fx median");
+                        ImGui::SliderInt("iterations", &remeshing_control.iterations, 1, 10);
+                        if (ImGui::Button("Remesh isotropically")) {
+                            tostf::log_section("Remeshing");
+                            ms_profiler.start();
+                            auto mesh = tostf::remesh_isotropic(aneurysm.mesh, tostf::calc_target_edge_length(
+                                                                    results.mesh_info.stats,
+                                                                    remeshing_control.edge_length_factor),
+                                                                remeshing_control.iterations, remeshing_control.settings);
+                            log_event_timing("Remeshing", ms_profiler.lap());
+                            set_mesh(mesh, ms_profiler);
+                        }
+                        ImGui::SliderFloat("face ratio", &remeshing_control.face_ratio, 0.01f, 1.0f, "%.2f");
+                        if (ImGui::Button("Decimate")) {
+                            tostf::log_section("Decimation");
+                            ms_profiler.start();
+                            const auto target_face_count = static_cast<size_t>(
+                                remeshing_control.face_ratio * aneurysm.mesh->indices.size() / 3);
+                            auto mesh = tostf::decimate_mesh(aneurysm.mesh, target_face_count, remeshing_control.settings);
+                            log_event_timing("Decimation", ms_profiler.lap());
+                            set_mesh(mesh, ms_profiler);
+                        }
+                        ImGui::PopItemWidth();
                     }
                     // Sidebar find_inlets
                     if (settings.step == preprocessing_steps::find_inlets) {
@@ -843,6 +861,7 @@ int main() {
                                 end_count += deform_count;
                             }
                             results.deformed.resize(end_count);
+                            results.deformed_pictures.resize(end_count);
                             //#pragma omp parallel for
                             for (auto& c : deform_settings.controls) {
                                 c.current = 0;
@@ -852,17 +871,19 @@ int main() {
                             }
                             for (int mesh_id = deform_count; mesh_id < end_count; ++mesh_id) {
                                 results.deformed.at(mesh_id).vertices = aneurysm.mesh->vertices;
-                                results.deformed.at(mesh_id).tex = std::make_unique<tostf::Texture2D>(
+                                results.deformed_pictures.at(mesh_id) = std::make_unique<tostf::Texture2D>(
                                     tostf::tex_res(imgui_settings.deform_pic_size, imgui_settings.deform_pic_size, 1),
                                     tostf::Texture_definition(tostf::tex::intern::rgba32f));
                             }
                             deform_settings.was_run = false;
+                            deform_settings.cancel = false;
                             deform_settings.reset();
                             deform_settings.future = std::async(std::launch::async, deform_points);
                         }
                         if (!results.deformed.empty() && ImGui::Button("Reset deformations")) {
                             settings.reset_step();
                             results.deformed.clear();
+                            results.deformed_pictures.clear();
                         }
                         if (deform_active) {
                             ImGui::PopItemFlag();
@@ -915,13 +936,14 @@ int main() {
                         for (auto& d : results.deformed) {
                             ImGui::SameLine();
                             ImGui::BeginGroup();
-                            if (d.tex) {
+                            const auto& picture = results.deformed_pictures.at(tex_id);
+                            if (picture) {
                                 if (deform_settings.active_view == tex_id) {
                                     ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
                                     ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
                                     if (ImGui::ImageButton(
-                                        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(d.tex->get_name())),
-                                        ImVec2(d.tex->get_res().x + 15.0f, d.tex->get_res().y), ImVec2(0.0f, 1.0f),
+                                        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(picture->get_name())),
+                                        ImVec2(picture->get_res().x + 15.0f, picture->get_res().y), ImVec2(0.0f, 1.0f),
                                         ImVec2(1.0f, 0.0f),
                                         -1, ImVec4(1.0f, 1.0f, 1.0f, 1.0f))) {
                                         deform_settings.active_view = tex_id;
@@ -930,8 +952,8 @@ int main() {
                                 }
                                 else {
                                     if (ImGui::ImageButton(
-                                        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(d.tex->get_name())),
-                                        ImVec2(d.tex->get_res().x + 15.0f, d.tex->get_res().y), ImVec2(0.0f, 1.0f),
+                                        reinterpret_cast<ImTextureID>(static_cast<intptr_t>(picture->get_name())),
+                                        ImVec2(picture->get_res().x + 15.0f, picture->get_res().y), ImVec2(0.0f, 1.0f),
                                         ImVec2(1.0f, 0.0f))) {
                                         deform_settings.active_view = tex_id;
                                     }
@@ -954,6 +976,7 @@ int main() {
                         }
                         if (delete_deform_id > -1) {
                             results.deformed.erase(results.deformed.begin() + delete_deform_id);
+                            results.deformed_pictures.erase(results.deformed_pictures.begin() + delete_deform_id);
                         }
                         ImGui::PopStyleVar();
                     }
@@ -1064,8 +1087,6 @@ int main() {
                         ImGui::EndCollapsingSection();
                     }
                     if (ImGui::BeginCollapsingSection("Postprocessing", nullptr, ImGuiTreeNodeFlags_DefaultOpen)) {
-                        ImGui::Checkbox("Lambda2", &export_info.post_processing.lambda2);
-                        ImGui::Checkbox("Q criterion", &export_info.post_processing.q_criterion);
                         ImGui::Checkbox("Wall Shear Stress", &export_info.post_processing.wall_shear_stress);
                         ImGui::EndCollapsingSection();
                     }
@@ -1156,6 +1177,8 @@ int main() {
                         ImGui::Combo("##meshunitscale", reinterpret_cast<int*>(&results.mesh_info.scale),
                                      "km\0m\0dm\0cm\0mm\0\xC2\xB5m\0nm\0\0");
                         ImGui::PopItemWidth();
+                        ImGui::Combo("Surface file format", reinterpret_cast<int*>(&export_info.surface),
+                                     "OBJ\0binary STL\0\0");
                         ImGui::DragInt("Minimal cell count", &export_info.block_mesh.min_cells, 1, 1, INT_MAX);
                         const auto scaled_bb_min = (results.mesh_info.bounding_box.min - export_info.block_mesh.bb_offset)
                                                    * results.mesh_info.get_scale();
@@ -1167,11 +1190,18 @@ int main() {
                         ImGui::InputInt3("Initial grid size", value_ptr(grid_size), ImGuiInputTextFlags_ReadOnly);
                         if (export_info.parallel) {
                             ImGui::DragInt("Maximal subdomain count", &export_info.decompose_par_dict.max_sub_domains, 1, 1, INT_MAX);
-                            auto bb_diff = glm::vec3(results.mesh_info.bounding_box.max - results.mesh_info.bounding_box.min);
-                            float max_grid_side_length = glm::compMax(bb_diff);
-                            auto max_side_length = abs(max_grid_side_length / export_info.decompose_par_dict.max_sub_domains);
-                            glm::ivec3 subdomain_sizes(ceil(bb_diff / max_side_length));
-                            ImGui::InputInt3("Subdomains per direction", value_ptr(subdomain_sizes), ImGuiInputTextFlags_ReadOnly);
+                            ImGui::Checkbox("Plan load-balanced decomposition", &export_info.decompose_par_dict.plan);
+                            if (export_info.decompose_par_dict.plan) {
+                                ImGui::DragInt("Minimal cells per subdomain",
+                                               &export_info.decompose_par_dict.min_cells_per_subdomain, 100, 1, INT_MAX);
+                            }
+                            else {
+                                auto bb_diff = glm::vec3(results.mesh_info.bounding_box.max - results.mesh_info.bounding_box.min);
+                                float max_grid_side_length = glm::compMax(bb_diff);
+                                auto max_side_length = abs(max_grid_side_length / export_info.decompose_par_dict.max_sub_domains);
+                                glm::ivec3 subdomain_sizes(ceil(bb_diff / max_side_length));
+                                ImGui::InputInt3("Subdomains per direction", value_ptr(subdomain_sizes), ImGuiInputTextFlags_ReadOnly);
+                            }
                         }
                         if (ImGui::BeginCollapsingSection("snappyHexMesh controls", nullptr, ImGuiTreeNodeFlags_DefaultOpen)) {
                             if (ImGui::BeginCollapsingSection("castellatedMesh controls")) {
@@ -1244,8 +1274,7 @@ int main() {
                             settings.popup = popups::export_success;
                             sim_info.dir_path = export_info.export_path;
                             sim_info.case_count = results.deformed.size() + 1;
-                            sim_info.postprocess = export_info.post_processing.lambda2 | export_info.post_processing.wall_shear_stress
-                                | export_info.post_processing.q_criterion;
+                            sim_info.postprocess = export_info.post_processing.wall_shear_stress;
                             sim_info.parallel = export_info.parallel;
                         }
                         else {
@@ -1459,10 +1488,12 @@ int main() {
                             dist_to_ref.update_uniform("proj", proj_d);
                             dist_to_ref.update_uniform("min_dist", results.min_dist_to_ref);
                             dist_to_ref.update_uniform("max_dist", results.max_dist_to_ref);
-                            for (auto& d : results.deformed) {
+                            for (size_t deform_id = 0; deform_id < results.deformed.size(); ++deform_id) {
+                                const auto& d = results.deformed.at(deform_id);
                                 dist_ssbo->set_data(d.distances_to_reference);
                                 renderer.vbos.at(0).vbo->set_data(d.vertices);
-                                deform_fbo.attach_color_texture(d.tex->get_fbo_tex_def(), 0);
+                                deform_fbo.attach_color_texture(
+                                    results.deformed_pictures.at(deform_id)->get_fbo_tex_def(), 0);
                                 deform_fbo.bind();
                                 tostf::gl::clear_all();
                                 renderer.vao->draw_elements(tostf::gl::draw::triangles);
@@ -1516,6 +1547,7 @@ int main() {
                 window.poll_events();
             }
             deform_settings.was_run = true;
+            deform_settings.cancel = true;
             if (deform_settings.future.valid()) {
                 deform_settings.future.wait();
             }
@@ -0,0 +1,350 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include <geometry/mesh_handling.hpp>
+#include <file/file_handling.hpp>
+#include <utility/logging.hpp>
+#include <utility/event_profiler.hpp>
+#include <mesh_processing/structured_mesh.hpp>
+#include <preprocessing/inlet_detection.hpp>
+#include <preprocessing/mesh_deformation.hpp>
+#include <preprocessing/openfoam_exporter.hpp>
+#include "assimp/postprocess.h"
+#include <omp.h>
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Usage: preprocess_batch <config>
+// The config holds one "key = value" pair per line, "#" starts a comment. Every "mesh" line adds an input mesh,
+// relative paths are resolved against the directory of the config. Each mesh is exported to export_path/<mesh name>.
+//
+//   export_path = cases
+//   mesh = patient_01.stl
+//   mesh = patient_02.stl
+//   # "auto" clusters truncation planes, "holes" closes the boundary loops of open meshes.
+//   inlet_detection = auto
+//   inlet_count = 3
+//   # Boundary that becomes the inlet, -1 picks the one with the largest radius. All others are outlets.
+//   inlet_id = -1
+//   inflow_velocity = 0.5
+//   deformation_count = 10
+//   seed = 0
+//   variation = 0.2
+//   # Reference deformation the variation is applied to, see Deformation_params.
+//   deformation_iterations = 100
+//   deformation_gauss_variance = 2.0
+//   deformation_rayleigh_variance = 1.0
+//   deformation_rayleigh_shift = 1.0
+//   deformation_scale = 1.0
+//   preserve_inlets = true
+//   # Factor from mesh units to meters, e.g. 0.001 for meshes in millimeters.
+//   scale = 0.001
+//   cell_size = 0.0005
+//   parallel = true
+//   max_sub_domains = 4
+//   surface_format = binary_stl
+//   # Meshes processed at the same time, 0 uses one per thread.
+//   jobs = 0
+struct Batch_config {
+    std::filesystem::path export_path;
+    std::vector<std::filesystem::path> meshes;
+    bool detect_from_holes = false;
+    int inlet_count = 3;
+    int inlet_id = -1;
+    float inflow_velocity = 0.5f;
+    int deformation_count = 0;
+    uint64_t seed = 0;
+    tostf::Deformation_params deformation{};
+    float variation = 0.2f;
+    bool preserve_inlets = false;
+    float scale = 1.0f;
+    int jobs = 0;
+    tostf::foam::OpenFOAM_export_info export_info{};
+};
+
+bool parse_bool(const std::string& value) {
+    if (value == "true" || value == "1") {
+        return true;
+    }
+    if (value == "false" || value == "0") {
+        return false;
+    }
+    throw std::invalid_argument{value + " is no boolean"};
+}
+
+void set_config_value(Batch_config& config, const std::string& key, const std::string& value,
+                      const std::filesystem::path& config_dir) {
+    if (key == "export_path") {
+        config.export_path = config_dir / value;
+    }
+    else if (key == "mesh") {
+        config.meshes.push_back(config_dir / value);
+    }
+    else if (key == "inlet_detection") {
+        if (value != "auto" && value != "holes") {
+            throw std::invalid_argument{"unknown inlet detection " + value};
+        }
+        config.detect_from_holes = value == "holes";
+    }
+    else if (key == "inlet_count") {
+        config.inlet_count = std::max(1, std::stoi(value));
+    }
+    else if (key == "inlet_id") {
+        config.inlet_id = std::stoi(value);
+    }
+    else if (key == "inflow_velocity") {
+        config.inflow_velocity = std::stof(value);
+    }
+    else if (key == "deformation_count") {
+        config.deformation_count = std::max(0, std::stoi(value));
+    }
+    else if (key == "seed") {
+        config.seed = std::stoull(value);
+    }
+    else if (key == "variation") {
+        config.variation = std::stof(value);
+    }
+    else if (key == "deformation_iterations") {
+        config.deformation.iterations = std::max(0, std::stoi(value));
+    }
+    else if (key == "deformation_gauss_variance") {
+        config.deformation.gauss_variance = std::stof(value);
+    }
+    else if (key == "deformation_rayleigh_variance") {
+        config.deformation.rayleigh_variance = std::stof(value);
+    }
+    else if (key == "deformation_rayleigh_shift") {
+        config.deformation.rayleigh_shift = std::stof(value);
+    }
+    else if (key == "deformation_scale") {
+        config.deformation.scale = std::stof(value);
+    }
+    else if (key == "preserve_inlets") {
+        config.preserve_inlets = parse_bool(value);
+    }
+    else if (key == "scale") {
+        config.scale = std::stof(value);
+    }
+    else if (key == "cell_size") {
+        config.export_info.block_mesh.initial_cell_size = std::stof(value);
+    }
+    else if (key == "parallel") {
+        config.export_info.parallel = parse_bool(value);
+    }
+    else if (key == "max_sub_domains") {
+        config.export_info.decompose_par_dict.max_sub_domains = std::max(1, std::stoi(value));
+    }
+    else if (key == "surface_format") {
+        if (value != "obj" && value != "binary_stl") {
+            throw std::invalid_argument{"unknown surface format " + value};
+        }
+        config.export_info.surface = value == "obj" ? tostf::foam::surface_format::obj
+                                                    : tostf::foam::surface_format::binary_stl;
+    }
+    else if (key == "dynamic_viscosity") {
+        config.export_info.blood_flow.dynamic_viscosity = std::stof(value);
+    }
+    else if (key == "density") {
+        config.export_info.blood_flow.density = std::stof(value);
+    }
+    else if (key == "jobs") {
+        config.jobs = std::max(0, std::stoi(value));
+    }
+    else {
+        throw std::invalid_argument{"unknown key " + key};
+    }
+}
+
+Batch_config load_batch_config(const std::filesystem::path& path) {
+    Batch_config config;
+    std::istringstream lines(tostf::load_file_str(path));
+    const auto config_dir = path.parent_path();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(lines, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            continue;
+        }
+        const auto separator = line.find('=');
+        if (separator == std::string::npos) {
+            throw std::runtime_error{path.string() + ":" + std::to_string(line_number) + ": expected key = value"};
+        }
+        const auto trim = [](const std::string& s) {
+            const auto begin = s.find_first_not_of(" \t\r");
+            if (begin == std::string::npos) {
+                return std::string{};
+            }
+            return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+        };
+        const auto key = trim(line.substr(0, separator));
+        const auto value = trim(line.substr(separator + 1));
+        try {
+            set_config_value(config, key, value, config_dir);
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error{path.string() + ":" + std::to_string(line_number) + ": " + e.what()};
+        }
+    }
+    if (config.export_path.empty()) {
+        throw std::runtime_error{path.string() + ": export_path is missing"};
+    }
+    std::set<std::string> names;
+    for (const auto& mesh : config.meshes) {
+        if (!names.insert(mesh.stem().string()).second) {
+            throw std::runtime_error{path.string() + ": two meshes are named " + mesh.stem().string()};
+        }
+    }
+    auto& blood_flow = config.export_info.blood_flow;
+    blood_flow.transport_fields = tostf::foam::fields_from_model(blood_flow.model);
+    blood_flow.transport_fields.at(0).internal_value = blood_flow.dynamic_viscosity / blood_flow.density;
+    config.export_info.inlet_specified = true;
+    return config;
+}
+
+std::vector<unsigned> flatten_faces(const std::vector<std::array<unsigned, 3>>& faces) {
+    std::vector<unsigned> indices;
+    indices.reserve(faces.size() * 3);
+    for (const auto& f : faces) {
+        indices.insert(indices.end(), f.begin(), f.end());
+    }
+    return indices;
+}
+
+// Runs the steps of the preprocess GUI without any user interaction, failures are reported as exceptions.
+void preprocess_mesh(const std::filesystem::path& mesh_path, const Batch_config& config) {
+    const auto name = mesh_path.stem().string();
+    tostf::Event_profiler<std::chrono::milliseconds> profiler;
+    profiler.start();
+    auto loaded_mesh = tostf::load_single_mesh(mesh_path, 0, true,
+                                               aiProcess_JoinIdenticalVertices | aiProcess_FindDegenerates |
+                                               aiProcess_FixInfacingNormals | aiProcess_PreTransformVertices);
+    if (!loaded_mesh) {
+        throw std::runtime_error{"No mesh in file at path: " + mesh_path.string()};
+    }
+    auto mesh = loaded_mesh.value();
+    const auto mesh_bb = tostf::calculate_bounding_box(mesh->vertices);
+    mesh->join_vertices(1e-6f * distance(glm::vec3(mesh_bb.min), glm::vec3(mesh_bb.max)));
+    tostf::Structured_mesh aneurysm(mesh);
+    mesh->normals = aneurysm.halfedge->calculate_normals();
+    // Like in the GUI the statistics are taken from the loaded mesh, before any inlet faces are removed.
+    auto stats = aneurysm.tri_face_mesh->calculate_mesh_stats();
+    tostf::log_event_timing(name + ": loading mesh", profiler.lap());
+
+    std::vector<tostf::Inlet> inlets;
+    if (config.detect_from_holes) {
+        // The holes are closed with new faces, the wall keeps the faces of the open mesh.
+        inlets = tostf::detect_inlets_from_holes(aneurysm);
+        aneurysm.halfedge = std::make_unique<tostf::Halfedge_mesh>(mesh);
+        mesh->normals = aneurysm.halfedge->calculate_normals();
+        stats = aneurysm.tri_face_mesh->calculate_mesh_stats();
+    }
+    else {
+        inlets = tostf::detect_inlets_automatically(aneurysm, config.inlet_count, static_cast<unsigned>(config.seed));
+        for (const auto& inlet : inlets) {
+            aneurysm.tri_face_mesh->remove_faces(inlet.indices);
+        }
+    }
+    if (inlets.empty()) {
+        throw std::runtime_error{"No inlets found in " + mesh_path.string()};
+    }
+    auto inlet_id = config.inlet_id;
+    if (inlet_id < 0) {
+        inlet_id = static_cast<int>(std::max_element(inlets.begin(), inlets.end(),
+                                                     [](const tostf::Inlet& a, const tostf::Inlet& b) {
+                                                         return a.radius < b.radius;
+                                                     }) - inlets.begin());
+    }
+    if (inlet_id >= static_cast<int>(inlets.size())) {
+        throw std::runtime_error{"Inlet " + std::to_string(inlet_id) + " does not exist, only "
+                                 + std::to_string(inlets.size()) + " were found in " + mesh_path.string()};
+    }
+    inlets.at(inlet_id).set_boundary_type(tostf::boundary_type::inlet);
+    inlets.at(inlet_id).inflow_velocity = config.inflow_velocity;
+    const tostf::Geometry_view wall(mesh, aneurysm.tri_face_mesh->get_indices());
+    std::vector<tostf::Geometry_view> inlet_views;
+    for (const auto& inlet : inlets) {
+        inlet_views.emplace_back(mesh, flatten_faces(inlet.indices));
+    }
+    tostf::log_event_timing(name + ": detecting " + std::to_string(inlets.size()) + " inlets", profiler.lap());
+
+    std::vector<tostf::Deformed_mesh> deformed(config.deformation_count);
+    if (config.deformation_count > 0) {
+        const auto bb = mesh->get_bounding_box();
+        const auto params = tostf::gen_deformation_params(config.deformation, config.variation,
+                                                          config.deformation_count, config.seed);
+        std::vector<std::vector<tostf::Deformation_bump>> bumps(config.deformation_count);
+        for (int i = 0; i < config.deformation_count; ++i) {
+            bumps.at(i) = tostf::gen_deformation_bumps(params.at(i), bb, config.seed, static_cast<uint64_t>(i));
+        }
+        std::vector<tostf::Inlet> preserved_inlets;
+        if (config.preserve_inlets) {
+            preserved_inlets = inlets;
+        }
+        auto deformed_vertices = tostf::deform_vertices_batch(mesh->vertices, params, bumps, preserved_inlets);
+        for (int i = 0; i < config.deformation_count; ++i) {
+            deformed.at(i).name = "deformation_" + std::to_string(i + 1);
+            deformed.at(i).vertices = std::move(deformed_vertices.at(i));
+            tostf::calc_distances_to_reference(deformed.at(i), mesh->vertices, mesh->normals);
+        }
+        tostf::log_event_timing(name + ": deforming " + std::to_string(config.deformation_count) + " meshes",
+                                profiler.lap());
+    }
+
+    auto info = config.export_info;
+    info.export_path = config.export_path / name;
+    std::filesystem::create_directories(info.export_path);
+    tostf::foam::export_openfoam_cases(name, info, config.scale, mesh->get_bounding_box(), stats.edge_length.avg,
+                                       mesh, deformed, wall, inlet_views, inlets);
+    tostf::log_event_timing(name + ": exporting " + std::to_string(deformed.size() + 1) + " cases", profiler.lap());
+}
+
+int main(int argc, char** argv) {
+    tostf::cmd::enable_color();
+    if (argc < 2) {
+        tostf::log_error() << "Usage: preprocess_batch <config>";
+        return 1;
+    }
+    Batch_config config;
+    try {
+        config = load_batch_config(argv[1]);
+    }
+    catch (const std::exception& e) {
+        tostf::log_error() << e.what();
+        return 1;
+    }
+    tostf::Event_profiler<std::chrono::milliseconds> profiler;
+    profiler.start();
+    const auto mesh_count = static_cast<int>(config.meshes.size());
+    const auto jobs = std::min(config.jobs > 0 ? config.jobs : omp_get_max_threads(), std::max(mesh_count, 1));
+    // Whole meshes are distributed over the threads, the parallel loops within one mesh run on the thread
+    // that processes it. A failing mesh is reported and does not stop the others.
+    std::vector<std::string> errors(mesh_count);
+#pragma omp parallel for schedule(dynamic) num_threads(jobs)
+    for (int i = 0; i < mesh_count; ++i) {
+        try {
+            preprocess_mesh(config.meshes.at(i), config);
+        }
+        catch (const std::exception& e) {
+            errors.at(i) = e.what();
+            tostf::log_error() << config.meshes.at(i).string() << ": " << e.what();
+        }
+    }
+    const auto failed = std::count_if(errors.begin(), errors.end(), [](const std::string& e) { return !e.empty(); });
+    tostf::log_event_timing("Preprocessing " + std::to_string(mesh_count) + " meshes with " + std::to_string(jobs)
+                            + " jobs", profiler.lap());
+    if (failed > 0) {
+        tostf::log_error() << failed << " of " << mesh_count << " meshes failed.";
+        return 1;
+    }
+    return 0;
+}
@@ -32,53 +32,9 @@
 #include "glm/gtx/component_wise.hpp"
 #include "visualization/vis_utilities.hpp"
 #include "gpu_interface/debug.hpp"
-#include "data_processing/clustering.hpp"
+#include "data_processing/line_clustering.hpp"
 #include "utility/random.hpp"
 
-std::vector<int> eigen_kmeans(Eigen::MatrixXf M, int k) {
-	std::vector<Eigen::VectorXf> center(k);
-	std::vector<int> assignment(M.rows());
-	Eigen::IOFormat HeavyFmt(Eigen::FullPrecision, 0, ", ", ";\n", "[", "]", "[", "]");
-	for (int i = 0; i < k; ++i) {
-		center.at(i) = M.row(tostf::gen_random_int_value<int>(0, M.rows() - 1));
-		tostf::log() << center.at(i).format(HeavyFmt);
-	}
-	int assignments = 1;
-	while (assignments > 0) {
-		assignments = 0;
-		Eigen::VectorXf ref_center = Eigen::VectorXf::Zero(k);
-		tostf::log() << ref_center.format(HeavyFmt);
-		std::vector<Eigen::VectorXf> new_center(k, ref_center);
-		std::vector<float> to_center_count(k, 0.0f);
-		for (int j = 0; j < M.rows(); ++j) {
-			Eigen::VectorXf m_row = M.row(j);
-			tostf::log() << m_row.format(HeavyFmt);
-			int curr_cluster = -1;
-			float min_dist = FLT_MAX;
-			for (int i = 0; i < k; ++i) {
-				float dist = (center.at(i) - m_row).norm();
-				if (dist < min_dist) {
-					curr_cluster = i;
-					min_dist = dist;
-				}
-			}
-			if (assignment.at(j) != curr_cluster) {
-				assignment.at(j) = curr_cluster;
-				assignments++;
-			}
-			new_center.at(curr_cluster) += m_row;
-			to_center_count.at(curr_cluster) += 1.0f;
-		}
-		for (int i = 0; i < k; ++i) {
-			if (to_center_count.at(i) > 0) {
-				center.at(i) = new_center.at(i) / to_center_count.at(i);
-			}
-			tostf::log() << center.at(i).format(HeavyFmt);
-		}
-	}
-	return assignment;
-}
-
 int main() {
     tostf::cmd::enable_color();
 	const tostf::window_config win_conf{
@@ -99,55 +55,16 @@ int main() {
 		streamlines.at(i) = tostf::gen_random_vec(glm::vec4(-1.0f), glm::vec4(1.0f));
 	}
 	
-	float sigma = 0.33;
-	auto Weight = Eigen::MatrixXf(line_count, line_count);
-	auto Diag = Eigen::VectorXf(line_count);
-	for (int i = 0; i < line_count; ++i) {
-		auto a_beg = streamlines.begin() + i * line_size;
-		auto a_end = a_beg + line_size;
-		for (int j = 0; j < line_count; ++j) {
-			if (i == j) {
-				Weight(i, j) = 0.0f;
-				continue;
-			}
-			auto b_beg = streamlines.begin() + j * line_size;
-			auto b_end = b_beg + line_size;
-			auto sim = tostf::mcpd(a_beg, a_end, b_beg, b_end);
-			auto weight = glm::exp(-sim * sim / 2.0f * sigma * sigma);
-			Weight(i, j) = weight;
-		}
-	}
-	for (int i = 0; i < line_count; ++i) {
-		Diag(i) = 0.0f;
-		for (int j = 0; j < line_count; ++j) {
-			if (i == j) {
-				continue;
-			}
-			Diag(i) += Weight(i, j);
-		}
-	}
-	Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> sqrtinverse(Diag.asDiagonal().toDenseMatrix());
-	Eigen::IOFormat HeavyFmt(Eigen::FullPrecision, 0, ", ", ";\n", "[", "]", "[", "]");
-	auto inverse_sqrt_D = sqrtinverse.operatorInverseSqrt();
-	auto L = inverse_sqrt_D * Weight * inverse_sqrt_D;
-
-	Eigen::EigenSolver<Eigen::MatrixXf> es(L);
-	auto eig_vals = es.eigenvalues().real();
-	std::vector<std::pair<float, int>> sorted_eigenvalues(eig_vals.size());
-	for (int i = 0; i < static_cast<int>(sorted_eigenvalues.size()); ++i) {
-		sorted_eigenvalues.at(i) = std::make_pair<>(eig_vals(i), i);
-	}
-	std::sort(sorted_eigenvalues.begin(), sorted_eigenvalues.end(),
-		[](const std::pair<float, int>& a, const std::pair<float, int>& b) {
-		return a.first < b.first;
-	});
-
-	Eigen::MatrixXf U(line_count, k);
-	for (int j = 0; j < k; ++j) {
-		U.col(j) = es.eigenvectors().col(j).real();
-	}
-	U.rowwise().normalize();
-	auto cluster = eigen_kmeans(U, k);
+	const auto lines = tostf::Polyline_set::from_fixed_size(streamlines, line_size);
+	tostf::Line_clustering_settings settings;
+	settings.cluster_count = k;
+	settings.sigma = 0.33f;
+	tostf::Event_profiler<std::chrono::milliseconds> profiler;
+	profiler.start();
+	const auto clusters = tostf::cluster_lines(lines, settings);
+	tostf::log_event_timing("Line clustering", profiler.lap());
+	tostf::log_info() << "Compared " << clusters.compared_pairs << " of "
+		<< line_count * (line_count - 1) / 2 << " line pairs.";
 	std::vector<glm::vec4> cluster_colors(k);
 	for (int i = 0; i < k; ++i) {
 		cluster_colors.at(i) = tostf::gen_random_vec(glm::vec4(0.0f), glm::vec4(1.0f));
@@ -155,9 +72,10 @@ int main() {
 	std::vector<glm::vec4> colors(streamlines.size());
 #pragma omp parallel for
 	for (int i = 0; i < line_count; ++i) {
-		auto col = cluster_colors.at(cluster.at(i));
+		const auto cluster_id = clusters.cluster_ids.at(i);
+		const auto col = cluster_id < 0 ? glm::vec4(0.5f, 0.5f, 0.5f, 1.0f) : cluster_colors.at(cluster_id);
 		for (int j = 0; j < line_size; ++j) {
-			colors.at(i * line_count + j) = col;
+			colors.at(i * line_size + j) = col;
 		}
 	}
 	auto buffer = std::make_shared<tostf::VBO>(streamlines, 4);
@@ -566,7 +566,12 @@ auto main() -> int {
                                    * curr_case->flow_renderer.settings.step_size_factor
                                    / max_value;
             curr_case->flow_renderer.init_pathlines_buffer();
-            curr_case->flow_renderer.init_pathline_integrators();
+            std::vector<glm::vec4> velocities;
+            if (curr_case->flow_renderer.seeding_uses_velocities()) {
+                velocities = curr_case->mesh.load_vector_field_from_file(
+                    curr_case->player.steps.at(curr_case->player.current_step), "U").internal_data;
+            }
+            curr_case->flow_renderer.init_pathline_integrators(curr_case->mesh, velocities);
             curr_case->flow_renderer.pathline_settings.start_pathline_step = curr_case->player.current_step;
             if (curr_case->flow_renderer.pathline_settings.start_pathline_step < curr_case->player.get_max_step_id()) {
                 curr_case->flow_renderer.pathlines->bind_base(tostf::vis_ssbo_defines::streamlines);
@@ -626,7 +631,7 @@ auto main() -> int {
                 const auto step_size = curr_case->volume_renderer.grid_info.cell_size
                                        * curr_case->flow_renderer.settings.step_size_factor;
                 curr_case->flow_renderer.init_line_buffer();
-                curr_case->flow_renderer.init_seeds();
+                curr_case->flow_renderer.init_seeds(curr_case->mesh, field.internal_data);
                 glFinish();
                 curr_case->flow_renderer.lines->bind_base(tostf::vis_ssbo_defines::streamlines);
                 visualization_selector.flow_vis.generate_streamlines->update_uniform(
@@ -1121,6 +1126,37 @@ auto main() -> int {
                             auto format_scale =
                                 "%." + std::to_string(glm::max(-tostf::get_float_exp(curr_case->mesh_scale) + 2, 3))
                                 + "f";
+                            auto& seeding = curr_case->flow_renderer.seeding;
+                            if (ImGui::BeginCombo(("Seeding" + label).c_str(),
+                                                  seeding_strategy_to_str(seeding.strategy).c_str())) {
+                                for (int i = 0; i < static_cast<int>(tostf::vis::seeding_strategy::count); ++i) {
+                                    const auto strategy_i = static_cast<tostf::vis::seeding_strategy>(i);
+                                    const bool is_selected = seeding.strategy == strategy_i;
+                                    if (ImGui::Selectable(seeding_strategy_to_str(strategy_i).c_str(), is_selected)) {
+                                        curr_case->flow_renderer.updated = !is_selected
+                                                                           || curr_case->flow_renderer.updated;
+                                        seeding.strategy = strategy_i;
+                                    }
+                                    if (is_selected) {
+                                        ImGui::SetItemDefaultFocus();
+                                    }
+                                }
+                                ImGui::EndCombo();
+                            }
+                            curr_case->flow_renderer.updated =
+                                ImGui::Checkbox(("Only seed inside of the lumen" + label).c_str(),
+                                                &seeding.reject_outside)
+                                || curr_case->flow_renderer.updated;
+                            if (seeding.strategy == tostf::vis::seeding_strategy::inlet_planes) {
+                                curr_case->flow_renderer.updated =
+                                    ImGui::SliderFloat(("Inlet radius factor" + label).c_str(),
+                                                       &seeding.inlet_radius_factor, 0.0f, 1.0f)
+                                    || curr_case->flow_renderer.updated;
+                                curr_case->flow_renderer.updated =
+                                    ImGui::SliderFloat(("Inlet offset" + label).c_str(), &seeding.inlet_offset,
+                                                       0.0f, 1.0f)
+                                    || curr_case->flow_renderer.updated;
+                            }
                             curr_case->flow_renderer.updated =
                                 ImGui::DragFloat3(("Sphere position" + label).c_str(),
                                                   &curr_case->flow_renderer.settings.seed_sphere_pos[0],
@@ -1184,6 +1220,42 @@ auto main() -> int {
                             ImGui::EndCollapsingSection();
                         }
                     }
+                    if (ImGui::BeginCollapsingSection("Temporal statistics")) {
+                        ImGui::TextWrapped("Mean, RMS, min and max over all steps, TAWSS and OSI for wallShearStress.");
+                        std::vector<std::string> step_fields;
+                        for (const auto& f : curr_case->fields) {
+                            if (curr_case->temporal_fields.find(f.first) == curr_case->temporal_fields.end()
+                                && !tostf::foam::parse_difference_field_name(f.first)) {
+                                step_fields.push_back(f.first);
+                            }
+                        }
+                        for (const auto& field_name : step_fields) {
+                            if (ImGui::Button((field_name + "##temporal" + name).c_str())) {
+                                comparer.calc_temporal_statistics(field_name);
+                            }
+                        }
+                        ImGui::EndCollapsingSection();
+                    }
+                    if (other_case && ImGui::BeginCollapsingSection("Case differences")) {
+                        ImGui::TextWrapped("Differences of the comparing case to the reference case at the current "
+                                           "steps, mapped between the meshes once and cached in the comparing case.");
+                        if (ImGui::RadioButton(("Nearest datapoint##difference" + name).c_str(),
+                                               comparer.difference_mode
+                                               == tostf::foam::correspondence_mode::nearest)) {
+                            comparer.difference_mode = tostf::foam::correspondence_mode::nearest;
+                        }
+                        ImGui::SameLine();
+                        if (ImGui::RadioButton(("Interpolated##difference" + name).c_str(),
+                                               comparer.difference_mode
+                                               == tostf::foam::correspondence_mode::interpolated)) {
+                            comparer.difference_mode = tostf::foam::correspondence_mode::interpolated;
+                        }
+                        const auto label = comparer.has_differences() ? "Update differences" : "Compute differences";
+                        if (ImGui::Button((label + ("##difference" + name)).c_str())) {
+                            comparer.enable_differences();
+                        }
+                        ImGui::EndCollapsingSection();
+                    }
                     if (ImGui::BeginCollapsingSection("Timestep export")) {
                         std::string temp_path = curr_case->export_path.string();
                         ImGui::InputText(("##exportpath" + name).c_str(), &temp_path, ImGuiInputTextFlags_ReadOnly);
@@ -1220,6 +1292,7 @@ auto main() -> int {
                             other_case->clipping.clipping_ssbo->set_data(temp_planes);
 							other_case->flow_renderer.settings = curr_case->flow_renderer.settings;
 							other_case->flow_renderer.pathline_settings = curr_case->flow_renderer.pathline_settings;
+                            other_case->flow_renderer.seeding = curr_case->flow_renderer.seeding;
                             other_case->flow_renderer.updated = true;
                             other_case->flow_renderer.seeds_set = curr_case->flow_renderer.seeds_set;
                         }
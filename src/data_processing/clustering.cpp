@@ -6,6 +6,7 @@
 //
 
 #include "clustering.hpp"
+#include <numeric>
 
 tostf::Cluster_assignment::Cluster_assignment(const int id) : data_id(id) {}
 
@@ -25,3 +26,46 @@ void tostf::sort_cluster_assignments(const std::vector<Cluster_assignment>::iter
                   return a.cluster_id < b.cluster_id;
               });
 }
+
+int tostf::sample_weighted_id(const std::vector<float>& weights, const float r) {
+    constexpr int block_count = 64;
+    const auto size = static_cast<int>(weights.size());
+    const auto block_size = (size + block_count - 1) / block_count;
+    std::vector<double> block_sums(block_count, 0.0);
+#pragma omp parallel for
+    for (int b = 0; b < block_count; b++) {
+        for (int i = b * block_size; i < std::min((b + 1) * block_size, size); i++) {
+            block_sums.at(b) += weights.at(i);
+        }
+    }
+    const auto total = std::accumulate(block_sums.begin(), block_sums.end(), 0.0);
+    if (total <= 0.0) {
+        return std::min(static_cast<int>(r * static_cast<float>(size)), size - 1);
+    }
+    auto target = r * total;
+    int last_positive_block = 0;
+    for (int b = 0; b < block_count; b++) {
+        if (block_sums.at(b) <= 0.0) {
+            continue;
+        }
+        last_positive_block = b;
+        if (target >= block_sums.at(b)) {
+            target -= block_sums.at(b);
+            continue;
+        }
+        for (int i = b * block_size; i < std::min((b + 1) * block_size, size); i++) {
+            target -= weights.at(i);
+            if (target < 0.0 && weights.at(i) > 0.0f) {
+                return i;
+            }
+        }
+        break;
+    }
+    // Only reached through rounding errors, the last point with a positive weight is returned.
+    for (int i = std::min((last_positive_block + 1) * block_size, size) - 1; i > last_positive_block * block_size; i--) {
+        if (weights.at(i) > 0.0f) {
+            return i;
+        }
+    }
+    return last_positive_block * block_size;
+}
@@ -10,9 +10,11 @@
 #include <vector>
 #include <algorithm>
 #include <random>
+#include <numeric>
 #include "math/vector_math.hpp"
 #include "math/statistics.hpp"
 #include "utility/vector.hpp"
+#include "utility/random.hpp"
 
 namespace tostf
 {
@@ -34,12 +36,34 @@ namespace tostf
     void sort_cluster_assignments(std::vector<Cluster_assignment>::iterator begin,
                                   std::vector<Cluster_assignment>::iterator end);
 
+    enum class seeding_method {
+        automatic,
+        k_means_pp,
+        k_means_parallel
+    };
+
+    // Returns an index with a probability proportional to its weight for r in [0, 1).
+    // Weights are summed in a fixed number of blocks that are combined in block order, so the result does not depend
+    // on the thread count.
+    int sample_weighted_id(const std::vector<float>& weights, float r);
+
+    // k-means++ seeding, the distance of every point to its closest seed is updated only against the newest seed.
     template <typename T>
-    std::vector<T> find_k_means_seeds(const std::vector<T>& v, int k);
+    std::vector<T> find_k_means_seeds(const std::vector<T>& v, int k, unsigned seed = 0);
 
+    // Scalable k-means|| seeding (Bahmani et al.). Samples about oversampling points per round in parallel
+    // and reduces them to k seeds with weighted k-means++. Oversampling defaults to 2 * k if <= 0.
     template <typename T>
-    std::vector<Cluster<T>> k_means_pp(const std::vector<T>& v, int k, int max_iterations = 100);
+    std::vector<T> find_k_means_parallel_seeds(const std::vector<T>& v, int k, unsigned seed = 0, int rounds = 5,
+                                               float oversampling = 0.0f);
 
+    // Automatic seeding uses k-means|| for large data sets and k-means++ otherwise.
+    template <typename T>
+    std::vector<Cluster<T>> k_means_pp(const std::vector<T>& v, int k, int max_iterations = 100, unsigned seed = 0,
+                                       seeding_method seeding = seeding_method::automatic);
+
+    // Lloyd's algorithm with Hamerly's bounds to skip distance computations. Stops once no assignment changes.
+    // Centers are accumulated per fixed block of points and the block sums are added in block order.
     template <typename T>
     std::vector<Cluster<T>> k_means(const std::vector<T>& v, std::vector<T> centers,
                                     int k, int max_iterations = 100);
@@ -58,31 +82,115 @@ void tostf::Cluster<T>::remove_outlier() {
 }
 
 template <typename T>
-std::vector<T> tostf::find_k_means_seeds(const std::vector<T>& v, const int k) {
+std::vector<T> tostf::find_k_means_seeds(const std::vector<T>& v, const int k, const unsigned seed) {
     if (static_cast<int>(v.size()) < k) {
         throw std::runtime_error{"Cannot find k seeds in vector smaller than k."};
     }
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    const std::uniform_int_distribution<int> uni(0, static_cast<unsigned>(v.size() - 1));
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> uni(0, static_cast<int>(v.size() - 1));
+    std::uniform_real_distribution<float> uni_float(0.0f, 1.0f);
 
     std::vector<T> centers{v.at(uni(rng))};
-    std::vector<float> weight(v.size());
+    std::vector<float> min_sq_dist(v.size(), FLT_MAX);
     for (int c = 1; c < k; c++) {
+#pragma omp parallel for
         for (int i = 0; i < static_cast<int>(v.size()); i++) {
-            float min_dist_to_center = static_cast<float>(math::min_dist(v.at(i), centers));
-            weight.at(i) = min_dist_to_center * min_dist_to_center;
+            const auto dist = static_cast<float>(distance(v.at(i), centers.back()));
+            min_sq_dist.at(i) = glm::min(min_sq_dist.at(i), dist * dist);
         }
-        const std::discrete_distribution<> d(weight.begin(), weight.end());
-        centers.push_back(v.at(d(rng)));
+        centers.push_back(v.at(sample_weighted_id(min_sq_dist, uni_float(rng))));
+    }
+    return centers;
+}
+
+template <typename T>
+std::vector<T> tostf::find_k_means_parallel_seeds(const std::vector<T>& v, const int k, const unsigned seed,
+                                                  const int rounds, float oversampling) {
+    const auto data_size = static_cast<int>(v.size());
+    if (data_size < k) {
+        throw std::runtime_error{"Cannot find k seeds in vector smaller than k."};
+    }
+    if (oversampling <= 0.0f) {
+        oversampling = 2.0f * static_cast<float>(k);
+    }
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> uni(0, data_size - 1);
+    std::uniform_real_distribution<float> uni_float(0.0f, 1.0f);
+
+    std::vector<int> candidate_ids{uni(rng)};
+    std::vector<float> min_sq_dist(data_size, FLT_MAX);
+    std::vector<int> nearest_candidate(data_size, 0);
+    int updated_candidates = 0;
+    for (int round = 0; round <= rounds; round++) {
+        const auto candidate_count = static_cast<int>(candidate_ids.size());
+#pragma omp parallel for
+        for (int i = 0; i < data_size; i++) {
+            for (int c = updated_candidates; c < candidate_count; c++) {
+                const auto dist = static_cast<float>(distance(v.at(i), v.at(candidate_ids.at(c))));
+                if (dist * dist < min_sq_dist.at(i)) {
+                    min_sq_dist.at(i) = dist * dist;
+                    nearest_candidate.at(i) = c;
+                }
+            }
+        }
+        updated_candidates = candidate_count;
+        if (round == rounds) {
+            break;
+        }
+        const auto cost = std::accumulate(min_sq_dist.begin(), min_sq_dist.end(), 0.0);
+        if (cost <= 0.0) {
+            break;
+        }
+        std::vector<int> sampled;
+#pragma omp parallel
+        {
+            std::vector<int> local_sampled;
+#pragma omp for nowait
+            for (int i = 0; i < data_size; i++) {
+                const auto probability = static_cast<double>(oversampling * min_sq_dist.at(i)) / cost;
+                const auto counter = static_cast<uint64_t>(round) * static_cast<uint64_t>(data_size)
+                                     + static_cast<uint64_t>(i);
+                const auto r = gen_counter_random_float(seed, counter);
+                if (r < probability) {
+                    local_sampled.push_back(i);
+                }
+            }
+#pragma omp critical
+            sampled.insert(sampled.end(), local_sampled.begin(), local_sampled.end());
+        }
+        std::sort(sampled.begin(), sampled.end());
+        candidate_ids.insert(candidate_ids.end(), sampled.begin(), sampled.end());
+    }
+    const auto candidate_count = static_cast<int>(candidate_ids.size());
+    if (candidate_count <= k) {
+        return find_k_means_seeds(v, k, seed);
+    }
+    // Every candidate is weighted by the number of points it is closest to.
+    std::vector<float> weights(candidate_count, 0.0f);
+    for (int i = 0; i < data_size; i++) {
+        weights.at(nearest_candidate.at(i)) += 1.0f;
+    }
+    std::vector<T> centers{v.at(candidate_ids.at(sample_weighted_id(weights, uni_float(rng))))};
+    std::vector<float> candidate_min_sq_dist(candidate_count, FLT_MAX);
+    std::vector<float> candidate_weights(candidate_count);
+    for (int c = 1; c < k; c++) {
+        for (int i = 0; i < candidate_count; i++) {
+            const auto dist = static_cast<float>(distance(v.at(candidate_ids.at(i)), centers.back()));
+            candidate_min_sq_dist.at(i) = glm::min(candidate_min_sq_dist.at(i), dist * dist);
+            candidate_weights.at(i) = weights.at(i) * candidate_min_sq_dist.at(i);
+        }
+        centers.push_back(v.at(candidate_ids.at(sample_weighted_id(candidate_weights, uni_float(rng)))));
     }
     return centers;
 }
 
 template <typename T>
 std::vector<tostf::Cluster<T>> tostf::k_means_pp(const std::vector<T>& v, const int k,
-                                                 const int max_iterations) {
-    auto centers = find_k_means_seeds(v, k);
+                                                 const int max_iterations, const unsigned seed,
+                                                 const seeding_method seeding) {
+    const auto use_parallel_seeding = seeding == seeding_method::k_means_parallel
+                                      || (seeding == seeding_method::automatic && v.size() >= 100000);
+    auto centers = use_parallel_seeding ? find_k_means_parallel_seeds(v, k, seed) : find_k_means_seeds(v, k, seed);
     return k_means(v, centers, k, max_iterations);
 }
 
@@ -92,50 +200,124 @@ std::vector<tostf::Cluster<T>> tostf::k_means(const std::vector<T>& v, std::vect
     if (k < 2) {
         return {{math::mean(v), v}};
     }
-    auto cluster_assignments = init_cluster_assignments(static_cast<int>(v.size()));
-    std::vector<int> cluster_sizes(k, 0);
+    if (static_cast<int>(centers.size()) != k) {
+        throw std::runtime_error{"Number of initial centers does not match k."};
+    }
+    const auto data_size = static_cast<int>(v.size());
+    std::vector<int> assignment(data_size, -1);
+    // Upper bound of the distance to the assigned center and lower bound of the distance to all other centers.
+    std::vector<float> upper(data_size);
+    std::vector<float> lower(data_size);
+    const auto assign_nearest = [&v, &centers, &assignment, &upper, &lower, k](const int i) {
+        auto min_dist = FLT_MAX;
+        auto second_min_dist = FLT_MAX;
+        int min_c_id = 0;
+        for (int c = 0; c < k; c++) {
+            const auto dist = static_cast<float>(distance(centers.at(c), v.at(i)));
+            if (dist < min_dist) {
+                second_min_dist = min_dist;
+                min_dist = dist;
+                min_c_id = c;
+            }
+            else if (dist < second_min_dist) {
+                second_min_dist = dist;
+            }
+        }
+        upper.at(i) = min_dist;
+        lower.at(i) = second_min_dist;
+        const auto changed = assignment.at(i) != min_c_id;
+        assignment.at(i) = min_c_id;
+        return changed;
+    };
+    constexpr int block_count = 64;
+    const auto block_size = (data_size + block_count - 1) / block_count;
+    std::vector<std::vector<T>> block_sums(block_count, std::vector<T>(k));
+    std::vector<std::vector<int>> block_sizes(block_count, std::vector<int>(k));
+    std::vector<float> half_center_dist(k);
+    std::vector<float> center_movement(k);
     for (int iteration = 0; iteration < max_iterations; iteration++) {
-        cluster_sizes = std::vector<int>(k, 0);
         int assignments = 0;
-        std::vector<T> new_centers(k, T(0));
+        if (iteration == 0) {
+#pragma omp parallel for reduction(+:assignments)
+            for (int i = 0; i < data_size; i++) {
+                assign_nearest(i);
+                assignments++;
+            }
+        }
+        else {
 #pragma omp parallel for
-        for (int i = 0; i < static_cast<int>(v.size()); i++) {
-            auto point = v.at(i);
-            int min_c_id = -1;
-            auto min_dist = FLT_MAX;
-            for (int j = 0; j < k; j++) {
-                const auto dist = distance(centers.at(j), point);
-                if (dist < min_dist) {
-                    min_c_id = j;
-                    min_dist = dist;
+            for (int c = 0; c < k; c++) {
+                auto min_dist = FLT_MAX;
+                for (int o = 0; o < k; o++) {
+                    if (o != c) {
+                        min_dist = glm::min(min_dist, static_cast<float>(distance(centers.at(c), centers.at(o))));
+                    }
                 }
+                half_center_dist.at(c) = 0.5f * min_dist;
             }
-            if (cluster_assignments.at(i).cluster_id != min_c_id) {
-                assignments++;
-                cluster_assignments.at(i).cluster_id = min_c_id;
+#pragma omp parallel for reduction(+:assignments)
+            for (int i = 0; i < data_size; i++) {
+                const auto bound = glm::max(half_center_dist.at(assignment.at(i)), lower.at(i));
+                if (upper.at(i) <= bound) {
+                    continue;
+                }
+                upper.at(i) = static_cast<float>(distance(centers.at(assignment.at(i)), v.at(i)));
+                if (upper.at(i) <= bound) {
+                    continue;
+                }
+                if (assign_nearest(i)) {
+                    assignments++;
+                }
             }
-            new_centers.at(min_c_id) += point;
-            cluster_sizes.at(min_c_id) += 1;
+        }
+        if (assignments == 0) {
+            break;
         }
 #pragma omp parallel for
+        for (int b = 0; b < block_count; b++) {
+            std::fill(block_sums.at(b).begin(), block_sums.at(b).end(), T(0));
+            std::fill(block_sizes.at(b).begin(), block_sizes.at(b).end(), 0);
+            for (int i = b * block_size; i < glm::min((b + 1) * block_size, data_size); i++) {
+                block_sums.at(b).at(assignment.at(i)) += v.at(i);
+                block_sizes.at(b).at(assignment.at(i)) += 1;
+            }
+        }
         for (int c = 0; c < k; c++) {
-            auto center = new_centers.at(c) / static_cast<float>(cluster_sizes.at(c));
-            centers.at(c) = math::nearest(center, v);
+            auto sum = T(0);
+            int size = 0;
+            for (int b = 0; b < block_count; b++) {
+                sum += block_sums.at(b).at(c);
+                size += block_sizes.at(b).at(c);
+            }
+            // Empty clusters keep their previous center.
+            center_movement.at(c) = 0.0f;
+            if (size > 0) {
+                const auto center = sum / static_cast<float>(size);
+                center_movement.at(c) = static_cast<float>(distance(center, centers.at(c)));
+                centers.at(c) = center;
+            }
+        }
+        const auto max_movement_it = std::max_element(center_movement.begin(), center_movement.end());
+        const auto max_movement_id = static_cast<int>(std::distance(center_movement.begin(), max_movement_it));
+        const auto max_movement = *max_movement_it;
+        auto second_max_movement = 0.0f;
+        for (int c = 0; c < k; c++) {
+            if (c != max_movement_id) {
+                second_max_movement = glm::max(second_max_movement, center_movement.at(c));
+            }
         }
-    }
-    sort_cluster_assignments(cluster_assignments.begin(), cluster_assignments.end());
-    std::vector<T> v_copy(v.size());
 #pragma omp parallel for
-    for (int i = 0; i < static_cast<int>(v.size()); i++) {
-        v_copy.at(i) = v.at(cluster_assignments.at(i).data_id);
+        for (int i = 0; i < data_size; i++) {
+            upper.at(i) += center_movement.at(assignment.at(i));
+            lower.at(i) -= assignment.at(i) == max_movement_id ? second_max_movement : max_movement;
+        }
     }
     std::vector<Cluster<T>> res(k);
-    const auto split_ids = sub_vector(cluster_sizes, cluster_sizes.size() - 1);
-    auto split_res = split_vector(v_copy, split_ids);
-#pragma omp parallel for
-    for (int i = 0; i < k; i++) {
-        res.at(i).data_points = std::move(split_res.at(i));
-        res.at(i).center = centers.at(i);
+    for (int c = 0; c < k; c++) {
+        res.at(c).center = centers.at(c);
+    }
+    for (int i = 0; i < data_size; i++) {
+        res.at(assignment.at(i)).data_points.push_back(v.at(i));
     }
     return res;
 }
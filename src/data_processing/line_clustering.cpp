@@ -0,0 +1,266 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "line_clustering.hpp"
+#include "math/lanczos.hpp"
+#include "utility/logging.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+std::vector<tostf::Line_bounds> tostf::calc_line_bounds(const Polyline_set& lines) {
+    std::vector<Line_bounds> bounds(lines.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(bounds.size()); ++i) {
+        auto& b = bounds.at(i);
+        for (auto p = lines.begin(i); p != lines.end(i); ++p) {
+            b.bb.min = glm::min(b.bb.min, *p);
+            b.bb.max = glm::max(b.bb.max, *p);
+        }
+        b.first = *lines.begin(i);
+        b.last = *(lines.end(i) - 1);
+    }
+    return bounds;
+}
+
+float tostf::bounding_box_distance(const Bounding_box& a, const Bounding_box& b) {
+    const auto gap = glm::max(glm::vec3(0.0f), glm::max(glm::vec3(a.min) - glm::vec3(b.max),
+                                                         glm::vec3(b.min) - glm::vec3(a.max)));
+    return length(gap);
+}
+
+float tostf::endpoint_distance(const Line_bounds& a, const Line_bounds& b) {
+    // Streamlines are not oriented consistently, so both pairings of the endpoints are considered.
+    const auto same = distance(glm::vec3(a.first), glm::vec3(b.first)) + distance(glm::vec3(a.last), glm::vec3(b.last));
+    const auto flipped = distance(glm::vec3(a.first), glm::vec3(b.last)) + distance(glm::vec3(a.last), glm::vec3(b.first));
+    return 0.5f * glm::min(same, flipped);
+}
+
+struct Line_neighbor {
+    int id;
+    float dist;
+};
+
+// Ties are broken by id, so the kept neighbors do not depend on the order the pairs are found in.
+bool is_nearer(const Line_neighbor& a, const Line_neighbor& b) {
+    return a.dist < b.dist || (a.dist == b.dist && a.id < b.id);
+}
+
+// Neighbors are kept in a max heap of at most neighbor_count entries with the farthest one on top.
+void keep_nearest(std::vector<Line_neighbor>& nearest, const Line_neighbor& n, const size_t neighbor_count) {
+    if (nearest.size() < neighbor_count) {
+        nearest.push_back(n);
+        std::push_heap(nearest.begin(), nearest.end(), is_nearer);
+    }
+    else if (is_nearer(n, nearest.front())) {
+        std::pop_heap(nearest.begin(), nearest.end(), is_nearer);
+        nearest.back() = n;
+        std::push_heap(nearest.begin(), nearest.end(), is_nearer);
+    }
+}
+
+// Pairs found by a thread are buffered and merged in batches, so the memory stays bounded by the kept neighbors
+// even if dense bundles hold many more pairs within the cutoff.
+constexpr size_t neighbor_merge_size = 1u << 14u;
+
+// Sweep and prune along x, only pairs whose bounding boxes are closer than the cutoff are compared.
+// Returns the neighbor_count nearest neighbors of every line.
+std::vector<std::vector<Line_neighbor>> find_line_neighbors(const tostf::Polyline_set& lines,
+                                                            const std::vector<tostf::Line_bounds>& bounds,
+                                                            const float cutoff, const float endpoint_cutoff,
+                                                            const int neighbor_count, size_t& compared_pairs) {
+    const auto kept_count = static_cast<size_t>(std::max(neighbor_count, 0));
+    const auto line_count = static_cast<int>(lines.size());
+    std::vector<int> order(line_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&bounds](const int a, const int b) {
+        return bounds.at(a).bb.min.x < bounds.at(b).bb.min.x;
+    });
+    const tostf::Polyline_soa soa(lines);
+    std::vector<std::vector<Line_neighbor>> neighbors(line_count);
+    size_t pairs = 0;
+#pragma omp parallel
+    {
+        std::vector<std::pair<int, Line_neighbor>> local_edges;
+        std::vector<unsigned> candidates;
+        size_t local_pairs = 0;
+        const auto merge_edges = [&local_edges, &neighbors, kept_count]() {
+#pragma omp critical
+            for (const auto& [i, n] : local_edges) {
+                keep_nearest(neighbors.at(i), n, kept_count);
+                keep_nearest(neighbors.at(n.id), Line_neighbor{i, n.dist}, kept_count);
+            }
+            local_edges.clear();
+        };
+#pragma omp for schedule(dynamic, 16) nowait
+        for (int oi = 0; oi < line_count; ++oi) {
+            const auto i = order.at(oi);
+            const auto& bi = bounds.at(i);
+            candidates.clear();
+            for (int oj = oi + 1; oj < line_count; ++oj) {
+                const auto j = order.at(oj);
+                const auto& bj = bounds.at(j);
+                if (bj.bb.min.x > bi.bb.max.x + cutoff) {
+                    break;
+                }
+                if (tostf::bounding_box_distance(bi.bb, bj.bb) > cutoff) {
+                    continue;
+                }
+                if (endpoint_cutoff > 0.0f && tostf::endpoint_distance(bi, bj) > endpoint_cutoff) {
+                    continue;
+                }
+                candidates.push_back(static_cast<unsigned>(j));
+            }
+            local_pairs += candidates.size();
+            const auto dists = tostf::mcpd_one_vs_many(soa, static_cast<size_t>(i), candidates, cutoff);
+            for (size_t c = 0; c < candidates.size(); ++c) {
+                if (dists.at(c) <= cutoff) {
+                    local_edges.emplace_back(i, Line_neighbor{static_cast<int>(candidates.at(c)), dists.at(c)});
+                }
+            }
+            if (local_edges.size() >= neighbor_merge_size) {
+                merge_edges();
+            }
+        }
+        merge_edges();
+#pragma omp atomic
+        pairs += local_pairs;
+    }
+    compared_pairs = pairs;
+    return neighbors;
+}
+
+// Seeded k-means++ followed by Lloyd iterations on the rows of the spectral embedding.
+std::vector<int> cluster_embedding(const Eigen::MatrixXf& embedding, const int k,
+                                   const int max_iterations, const unsigned seed) {
+    const auto row_count = static_cast<int>(embedding.rows());
+    std::mt19937 rng(seed);
+    Eigen::MatrixXf centers(k, embedding.cols());
+    std::vector<float> min_sq_dist(row_count, FLT_MAX);
+    centers.row(0) = embedding.row(std::uniform_int_distribution<int>(0, row_count - 1)(rng));
+    for (int c = 1; c < k; ++c) {
+#pragma omp parallel for
+        for (int i = 0; i < row_count; ++i) {
+            min_sq_dist.at(i) = glm::min(min_sq_dist.at(i),
+                                         (embedding.row(i) - centers.row(c - 1)).squaredNorm());
+        }
+        // If every row coincides with a center all weights are 0, which discrete_distribution does not allow.
+        if (std::all_of(min_sq_dist.begin(), min_sq_dist.end(), [](const float d) { return d <= 0.0f; })) {
+            centers.row(c) = embedding.row(std::uniform_int_distribution<int>(0, row_count - 1)(rng));
+            continue;
+        }
+        std::discrete_distribution<int> pick(min_sq_dist.begin(), min_sq_dist.end());
+        centers.row(c) = embedding.row(pick(rng));
+    }
+    std::vector<int> assignment(row_count, -1);
+    for (int iteration = 0; iteration < max_iterations; ++iteration) {
+        int changes = 0;
+#pragma omp parallel for reduction(+:changes)
+        for (int i = 0; i < row_count; ++i) {
+            int best = 0;
+            auto best_dist = FLT_MAX;
+            for (int c = 0; c < k; ++c) {
+                const auto d = (embedding.row(i) - centers.row(c)).squaredNorm();
+                if (d < best_dist) {
+                    best_dist = d;
+                    best = c;
+                }
+            }
+            if (assignment.at(i) != best) {
+                assignment.at(i) = best;
+                ++changes;
+            }
+        }
+        if (changes == 0) {
+            break;
+        }
+        Eigen::MatrixXf sums = Eigen::MatrixXf::Zero(k, embedding.cols());
+        std::vector<int> counts(k, 0);
+        for (int i = 0; i < row_count; ++i) {
+            sums.row(assignment.at(i)) += embedding.row(i);
+            ++counts.at(assignment.at(i));
+        }
+        for (int c = 0; c < k; ++c) {
+            if (counts.at(c) > 0) {
+                centers.row(c) = sums.row(c) / static_cast<float>(counts.at(c));
+            }
+        }
+    }
+    return assignment;
+}
+
+tostf::Line_clusters tostf::cluster_lines(const Polyline_set& lines, const Line_clustering_settings& settings) {
+    const auto line_count = static_cast<int>(lines.size());
+    if (settings.cluster_count < 1) {
+        throw std::runtime_error{"Line clustering requires at least one cluster."};
+    }
+    const auto cutoff = settings.cutoff > 0.0f ? settings.cutoff : 3.0f * settings.sigma;
+    Line_clusters res;
+    res.cluster_ids.resize(line_count, -1);
+    const auto bounds = calc_line_bounds(lines);
+    auto neighbors = find_line_neighbors(lines, bounds, cutoff, settings.endpoint_cutoff, settings.neighbor_count,
+                                         res.compared_pairs);
+
+    // Only the nearest neighbors of each line are kept, the graph is symmetrized by taking the union.
+    std::vector<Eigen::Triplet<float>> triplets;
+    for (int i = 0; i < line_count; ++i) {
+        for (const auto& n : neighbors.at(i)) {
+            const auto w = glm::exp(-n.dist * n.dist / (2.0f * settings.sigma * settings.sigma));
+            triplets.emplace_back(i, n.id, w);
+            triplets.emplace_back(n.id, i, w);
+        }
+    }
+    neighbors.clear();
+    math::Sparse_matrix weights(line_count, line_count);
+    weights.setFromTriplets(triplets.begin(), triplets.end(), [](const float a, const float b) {
+        return glm::max(a, b);
+    });
+    triplets.clear();
+
+    // Lines without any neighbor are left out of the embedding.
+    Eigen::VectorXf inv_sqrt_degree = weights * Eigen::VectorXf::Ones(line_count);
+    std::vector<int> connected;
+    std::vector<int> compact_id(line_count, -1);
+    for (int i = 0; i < line_count; ++i) {
+        if (inv_sqrt_degree(i) > 0.0f) {
+            compact_id.at(i) = static_cast<int>(connected.size());
+            connected.push_back(i);
+            inv_sqrt_degree(i) = 1.0f / glm::sqrt(inv_sqrt_degree(i));
+        }
+    }
+    const auto connected_count = static_cast<int>(connected.size());
+    if (connected_count < settings.cluster_count) {
+        log_warning() << "Only " << connected_count << " lines have neighbors, cannot build "
+            << settings.cluster_count << " clusters.";
+        return res;
+    }
+    for (int i = 0; i < line_count; ++i) {
+        for (math::Sparse_matrix::InnerIterator it(weights, i); it; ++it) {
+            triplets.emplace_back(compact_id.at(i), compact_id.at(static_cast<int>(it.col())),
+                                  it.value() * inv_sqrt_degree(i) * inv_sqrt_degree(static_cast<int>(it.col())));
+        }
+    }
+    math::Sparse_matrix normalized(connected_count, connected_count);
+    normalized.setFromTriplets(triplets.begin(), triplets.end());
+    triplets.clear();
+
+    const auto eig = math::lanczos_largest_eigenpairs(normalized, settings.cluster_count,
+                                                      settings.lanczos_iterations, settings.seed);
+    res.eigenvalues.resize(settings.cluster_count);
+    for (int i = 0; i < settings.cluster_count; ++i) {
+        res.eigenvalues.at(i) = eig.values(i);
+    }
+    Eigen::MatrixXf embedding = eig.vectors;
+    embedding.rowwise().normalize();
+    const auto assignment = cluster_embedding(embedding, settings.cluster_count,
+                                              settings.max_k_means_iterations, settings.seed);
+    for (int i = 0; i < connected_count; ++i) {
+        res.cluster_ids.at(connected.at(i)) = assignment.at(i);
+    }
+    return res;
+}
@@ -0,0 +1,50 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <vector>
+#include "data_processing/line_distance.hpp"
+#include "geometry/geometry.hpp"
+
+namespace tostf
+{
+    struct Line_bounds {
+        Bounding_box bb;
+        glm::vec4 first{};
+        glm::vec4 last{};
+    };
+
+    std::vector<Line_bounds> calc_line_bounds(const Polyline_set& lines);
+    // Lower bound of the mcpd of two lines, every point of a is at least this far away from any point of b.
+    float bounding_box_distance(const Bounding_box& a, const Bounding_box& b);
+    float endpoint_distance(const Line_bounds& a, const Line_bounds& b);
+
+    struct Line_clustering_settings {
+        int cluster_count = 5;
+        // Number of nearest neighbors kept per line in the sparse affinity graph.
+        int neighbor_count = 10;
+        float sigma = 0.33f;
+        // Pairs farther apart than this are never compared. Defaults to 3 * sigma if <= 0.
+        float cutoff = 0.0f;
+        // Skip pairs whose endpoints are farther apart on average than this. Disabled if <= 0.
+        float endpoint_cutoff = 0.0f;
+        // Size of the Krylov subspace. Chosen from cluster_count if <= 0.
+        int lanczos_iterations = 0;
+        int max_k_means_iterations = 100;
+        unsigned seed = 0;
+    };
+
+    struct Line_clusters {
+        // Lines without any neighbor inside the cutoff are not clustered and marked with -1.
+        std::vector<int> cluster_ids;
+        std::vector<float> eigenvalues;
+        size_t compared_pairs = 0;
+    };
+
+    Line_clusters cluster_lines(const Polyline_set& lines, const Line_clustering_settings& settings);
+}
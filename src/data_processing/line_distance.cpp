@@ -0,0 +1,174 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "line_distance.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+tostf::Polyline_set::Polyline_set(std::vector<glm::vec4> in_points, std::vector<unsigned> in_offsets)
+    : points(std::move(in_points)), offsets(std::move(in_offsets)) {
+    if (offsets.empty() || offsets.front() != 0 || offsets.back() != points.size()) {
+        throw std::runtime_error{"Polyline offsets do not match the point data."};
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        if (offsets.at(i) <= offsets.at(i - 1)) {
+            throw std::runtime_error{"Polyline offsets have to be strictly increasing."};
+        }
+    }
+}
+
+tostf::Polyline_set tostf::Polyline_set::from_fixed_size(std::vector<glm::vec4> in_points, const unsigned line_size) {
+    if (line_size == 0 || in_points.size() % line_size != 0) {
+        throw std::runtime_error{"Point count is not a multiple of the line size."};
+    }
+    const auto line_count = in_points.size() / line_size;
+    std::vector<unsigned> offsets(line_count + 1);
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        offsets.at(i) = static_cast<unsigned>(i * line_size);
+    }
+    return Polyline_set(std::move(in_points), std::move(offsets));
+}
+
+size_t tostf::Polyline_set::size() const {
+    return offsets.size() - 1;
+}
+
+std::vector<glm::vec4>::const_iterator tostf::Polyline_set::begin(const size_t line_id) const {
+    return points.begin() + offsets.at(line_id);
+}
+
+std::vector<glm::vec4>::const_iterator tostf::Polyline_set::end(const size_t line_id) const {
+    return points.begin() + offsets.at(line_id + 1);
+}
+
+tostf::Polyline_soa::Polyline_soa(const Polyline_set& lines) {
+    const auto line_count = lines.size();
+    starts.resize(line_count);
+    sizes.resize(line_count);
+    unsigned padded_size = 0;
+    for (size_t i = 0; i < line_count; ++i) {
+        sizes.at(i) = lines.offsets.at(i + 1) - lines.offsets.at(i);
+        starts.at(i) = padded_size;
+        padded_size += (sizes.at(i) + block_size - 1) / block_size * block_size;
+    }
+    x.resize(padded_size);
+    y.resize(padded_size);
+    z.resize(padded_size);
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(line_count); ++i) {
+        const auto padded_line_size = (sizes.at(i) + block_size - 1) / block_size * block_size;
+        for (unsigned p = 0; p < padded_line_size; ++p) {
+            const auto& point = lines.points.at(lines.offsets.at(i) + std::min(p, sizes.at(i) - 1));
+            x.at(starts.at(i) + p) = point.x;
+            y.at(starts.at(i) + p) = point.y;
+            z.at(starts.at(i) + p) = point.z;
+        }
+    }
+}
+
+size_t tostf::Polyline_soa::size() const {
+    return sizes.size();
+}
+
+#if defined(__AVX2__)
+inline __m256 sq_dist_avx(const __m256 px, const __m256 py, const __m256 pz,
+                          const float bx, const float by, const float bz) {
+    const auto dx = _mm256_sub_ps(px, _mm256_set1_ps(bx));
+    const auto dy = _mm256_sub_ps(py, _mm256_set1_ps(by));
+    const auto dz = _mm256_sub_ps(pz, _mm256_set1_ps(bz));
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+}
+#endif
+
+// Minimum squared distances of one block of points of line a to all points of line b.
+// The points of b are broadcast, so only the block of a has to be padded.
+void min_sq_dist_block(const float* ax, const float* ay, const float* az,
+                       const float* bx, const float* by, const float* bz, const unsigned b_size, float* out) {
+#if defined(__AVX2__)
+    static_assert(tostf::Polyline_soa::block_size == 8, "AVX2 kernel processes 8 points at once.");
+    const auto px = _mm256_loadu_ps(ax);
+    const auto py = _mm256_loadu_ps(ay);
+    const auto pz = _mm256_loadu_ps(az);
+    // Two independent minima hide the latency of the min instruction.
+    auto min_a = _mm256_set1_ps(FLT_MAX);
+    auto min_b = min_a;
+    unsigned j = 0;
+    for (; j + 1 < b_size; j += 2) {
+        min_a = _mm256_min_ps(min_a, sq_dist_avx(px, py, pz, bx[j], by[j], bz[j]));
+        min_b = _mm256_min_ps(min_b, sq_dist_avx(px, py, pz, bx[j + 1], by[j + 1], bz[j + 1]));
+    }
+    if (j < b_size) {
+        min_a = _mm256_min_ps(min_a, sq_dist_avx(px, py, pz, bx[j], by[j], bz[j]));
+    }
+    _mm256_storeu_ps(out, _mm256_min_ps(min_a, min_b));
+#else
+    constexpr auto block_size = tostf::Polyline_soa::block_size;
+    float mins[block_size];
+    std::fill(mins, mins + block_size, FLT_MAX);
+    for (unsigned j = 0; j < b_size; ++j) {
+        for (unsigned l = 0; l < block_size; ++l) {
+            const auto dx = ax[l] - bx[j];
+            const auto dy = ay[l] - by[j];
+            const auto dz = az[l] - bz[j];
+            mins[l] = std::min(mins[l], dx * dx + dy * dy + dz * dz);
+        }
+    }
+    std::copy(mins, mins + block_size, out);
+#endif
+}
+
+// Sum of the closest point distances of line a to line b, stops once the sum exceeds limit.
+float directed_distance_sum(const tostf::Polyline_soa& lines, const size_t a, const size_t b, const float limit) {
+    constexpr auto block_size = tostf::Polyline_soa::block_size;
+    const auto a_size = lines.sizes.at(a);
+    const auto b_start = lines.starts.at(b);
+    float mins[block_size];
+    float sum = 0.0f;
+    for (unsigned block = 0; block < a_size; block += block_size) {
+        const auto a_start = lines.starts.at(a) + block;
+        min_sq_dist_block(lines.x.data() + a_start, lines.y.data() + a_start, lines.z.data() + a_start,
+                          lines.x.data() + b_start, lines.y.data() + b_start, lines.z.data() + b_start,
+                          lines.sizes.at(b), mins);
+        const auto valid = std::min(block_size, a_size - block);
+        for (unsigned l = 0; l < valid; ++l) {
+            sum += std::sqrt(mins[l]);
+        }
+        if (sum > limit) {
+            break;
+        }
+    }
+    return sum;
+}
+
+float tostf::mcpd(const Polyline_soa& lines, const size_t a, const size_t b) {
+    return mcpd_bounded(lines, a, b, FLT_MAX);
+}
+
+float tostf::mcpd_bounded(const Polyline_soa& lines, const size_t a, const size_t b, const float threshold) {
+    // mcpd = 0.5 * (sum_a / n_a + sum_b / n_b), both sums only grow, so each one is bounded by the threshold.
+    const auto a_size = static_cast<float>(lines.sizes.at(a));
+    const auto b_size = static_cast<float>(lines.sizes.at(b));
+    const auto a_mean = directed_distance_sum(lines, a, b, 2.0f * threshold * a_size) / a_size;
+    if (0.5f * a_mean > threshold) {
+        return 0.5f * a_mean;
+    }
+    const auto b_mean = directed_distance_sum(lines, b, a, (2.0f * threshold - a_mean) * b_size) / b_size;
+    return 0.5f * (a_mean + b_mean);
+}
+
+std::vector<float> tostf::mcpd_one_vs_many(const Polyline_soa& lines, const size_t a,
+                                           const std::vector<unsigned>& candidates, const float threshold) {
+    std::vector<float> res(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        res.at(i) = mcpd_bounded(lines, a, candidates.at(i), threshold);
+    }
+    return res;
+}
@@ -0,0 +1,70 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <vector>
+#include <cfloat>
+#include <iterator>
+#include "math/glm_helper.hpp"
+
+namespace tostf
+{
+    // Polylines are stored back to back in one point vector, line i spans [offsets[i], offsets[i + 1]).
+    struct Polyline_set {
+        Polyline_set() = default;
+        Polyline_set(std::vector<glm::vec4> in_points, std::vector<unsigned> in_offsets);
+        static Polyline_set from_fixed_size(std::vector<glm::vec4> in_points, unsigned line_size);
+        size_t size() const;
+        std::vector<glm::vec4>::const_iterator begin(size_t line_id) const;
+        std::vector<glm::vec4>::const_iterator end(size_t line_id) const;
+        std::vector<glm::vec4> points;
+        std::vector<unsigned> offsets{0};
+    };
+
+    // Mean of the distances of every point of [a_begin, a_end) to its closest point in [b_begin, b_end).
+    template <typename It>
+    float directed_mcpd(It a_begin, It a_end, It b_begin, It b_end) {
+        float sum = 0.0f;
+        for (auto a = a_begin; a != a_end; ++a) {
+            auto min_sq_dist = FLT_MAX;
+            for (auto b = b_begin; b != b_end; ++b) {
+                const auto diff = glm::vec3(*a) - glm::vec3(*b);
+                min_sq_dist = glm::min(min_sq_dist, dot(diff, diff));
+            }
+            sum += glm::sqrt(min_sq_dist);
+        }
+        return sum / static_cast<float>(std::distance(a_begin, a_end));
+    }
+
+    // Symmetric mean of closest point distances between two polylines.
+    template <typename It>
+    float mcpd(It a_begin, It a_end, It b_begin, It b_end) {
+        return 0.5f * (directed_mcpd(a_begin, a_end, b_begin, b_end) + directed_mcpd(b_begin, b_end, a_begin, a_end));
+    }
+
+    // Structure of arrays copy of a Polyline_set for the vectorized mcpd kernels.
+    // Every line starts at a multiple of the block size and is padded with its last point.
+    struct Polyline_soa {
+        static constexpr unsigned block_size = 8;
+        Polyline_soa() = default;
+        explicit Polyline_soa(const Polyline_set& lines);
+        size_t size() const;
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<unsigned> starts;
+        std::vector<unsigned> sizes;
+    };
+
+    float mcpd(const Polyline_soa& lines, size_t a, size_t b);
+    // Stops as soon as the mcpd is known to exceed the threshold and returns a lower bound > threshold in that case.
+    float mcpd_bounded(const Polyline_soa& lines, size_t a, size_t b, float threshold);
+    // Bounded mcpd of line a to every candidate, evaluated serially so it can be called from parallel loops.
+    std::vector<float> mcpd_one_vs_many(const Polyline_soa& lines, size_t a, const std::vector<unsigned>& candidates,
+                                        float threshold = FLT_MAX);
+}
@@ -8,8 +8,10 @@
 #include "plane_fitting.hpp"
 #include "utility/logging.hpp"
 #include "utility/vector.hpp"
-#include <Eigen/Eigenvalues>
-#include "math/glm_eigen_interop.hpp"
+#include "utility/random.hpp"
+#include <array>
+#include <algorithm>
+#include <stdexcept>
 
 tostf::Plane::Plane(const glm::vec4 in_center, const glm::vec4 in_normal) : center(in_center), normal(in_normal) {}
 
@@ -32,18 +34,176 @@ bool tostf::Plane::is_on_plane(const glm::vec4 p, const float bias) const {
     return abs(dot(center - p, normal)) <= bias;
 }
 
-tostf::Plane tostf::find_plane(const std::vector<glm::vec4>& points) {
-    auto plane_verts = to_eig_point_mat(points);
-    const auto center = plane_verts.rowwise().mean();
-    auto centered_points = plane_verts.colwise() - center;
-    const auto svd_setting = Eigen::ComputeFullU;
-    auto svd = centered_points.jacobiSvd(svd_setting);
-    auto u = svd.matrixU();
+// Eigenvector of the symmetric matrix with the given rows for the eigenvalue, taken as the longest cross product of
+// two rows of m - eigenvalue * I. Returns a zero vector if the eigenvalue is not simple.
+glm::dvec3 calc_eigenvector(const std::array<glm::dvec3, 3>& m, const double eigenvalue) {
+    const std::array<glm::dvec3, 3> shifted{
+        m.at(0) - glm::dvec3(eigenvalue, 0.0, 0.0), m.at(1) - glm::dvec3(0.0, eigenvalue, 0.0),
+        m.at(2) - glm::dvec3(0.0, 0.0, eigenvalue)
+    };
+    const std::array<glm::dvec3, 3> candidates{
+        cross(shifted.at(0), shifted.at(1)), cross(shifted.at(0), shifted.at(2)), cross(shifted.at(1), shifted.at(2))
+    };
+    auto best = candidates.at(0);
+    for (const auto& c : candidates) {
+        if (dot(c, c) > dot(best, best)) {
+            best = c;
+        }
+    }
+    const auto row_scale = glm::max(dot(shifted.at(0), shifted.at(0)),
+                                    glm::max(dot(shifted.at(1), shifted.at(1)), dot(shifted.at(2), shifted.at(2))));
+    if (dot(best, best) <= 1e-20 * row_scale * row_scale) {
+        return glm::dvec3(0.0);
+    }
+    return normalize(best);
+}
+
+glm::dvec3 find_perpendicular(const glm::dvec3& v) {
+    const auto axis = glm::abs(v.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+    return normalize(cross(v, axis));
+}
+
+void tostf::Plane_moments::add(const glm::vec4& p) {
+    const glm::dvec3 d(p);
+    count += 1.0;
+    sum += d;
+    sum_sq += d * d;
+    sum_mixed += glm::dvec3(d.x * d.y, d.x * d.z, d.y * d.z);
+}
+
+void tostf::Plane_moments::merge(const Plane_moments& other) {
+    count += other.count;
+    sum += other.sum;
+    sum_sq += other.sum_sq;
+    sum_mixed += other.sum_mixed;
+}
+
+tostf::Plane tostf::Plane_moments::to_plane() const {
+    if (count <= 0.0) {
+        return {};
+    }
+    const auto mean = sum / count;
+    const auto variance = sum_sq / count - mean * mean;
+    const auto covariance = sum_mixed / count - glm::dvec3(mean.x * mean.y, mean.x * mean.z, mean.y * mean.z);
+    const std::array<glm::dvec3, 3> cov{
+        glm::dvec3(variance.x, covariance.x, covariance.y), glm::dvec3(covariance.x, variance.y, covariance.z),
+        glm::dvec3(covariance.y, covariance.z, variance.z)
+    };
+    // Closed form eigenvalues of a symmetric 3x3 matrix (Smith 1961).
+    const auto q = (variance.x + variance.y + variance.z) / 3.0;
+    const auto diag = variance - q;
+    const auto p = glm::sqrt((dot(diag, diag) + 2.0 * dot(covariance, covariance)) / 6.0);
+    glm::dvec3 normal(0.0);
+    glm::dvec3 tangent(0.0);
+    if (p > 0.0) {
+        // Determinant of (cov - q * I) / p, its half is the cosine of three times the angle of the eigenvalues.
+        const auto b0 = (cov.at(0) - glm::dvec3(q, 0.0, 0.0)) / p;
+        const auto b1 = (cov.at(1) - glm::dvec3(0.0, q, 0.0)) / p;
+        const auto b2 = (cov.at(2) - glm::dvec3(0.0, 0.0, q)) / p;
+        const auto r = glm::clamp(dot(b0, cross(b1, b2)) / 2.0, -1.0, 1.0);
+        const auto phi = glm::acos(r) / 3.0;
+        normal = calc_eigenvector(cov, q + 2.0 * p * glm::cos(phi + 2.0 * glm::pi<double>() / 3.0));
+        tangent = calc_eigenvector(cov, q + 2.0 * p * glm::cos(phi));
+    }
+    // Degenerate point sets have repeated eigenvalues, any vector of the eigenspace is used then.
+    if (dot(normal, normal) == 0.0 && dot(tangent, tangent) == 0.0) {
+        normal = glm::dvec3(0.0, 0.0, 1.0);
+        tangent = glm::dvec3(1.0, 0.0, 0.0);
+    }
+    else if (dot(normal, normal) == 0.0) {
+        normal = find_perpendicular(tangent);
+    }
+    else if (dot(tangent, tangent) == 0.0) {
+        tangent = find_perpendicular(normal);
+    }
+    tangent = normalize(tangent - dot(tangent, normal) * normal);
+    const auto bitangent = cross(normal, tangent);
     return {
-        to_glm(center), normalize(to_glm(u.col(2), 0)), normalize(to_glm(u.col(0), 0)), normalize(to_glm(u.col(1), 0))
+        glm::vec4(glm::vec3(mean), 1.0f), glm::vec4(glm::vec3(normal), 0.0f), glm::vec4(glm::vec3(tangent), 0.0f),
+        glm::vec4(glm::vec3(bitangent), 0.0f)
     };
 }
 
+tostf::Plane tostf::find_plane(const std::vector<glm::vec4>& points) {
+    Plane_moments moments;
+    for (const auto& p : points) {
+        moments.add(p);
+    }
+    return moments.to_plane();
+}
+
+std::vector<tostf::Plane> tostf::find_planes(const std::vector<glm::vec4>& points, const std::vector<int>& labels,
+                                             const int label_count) {
+    if (points.size() != labels.size()) {
+        throw std::runtime_error{"Labels do not match the points."};
+    }
+    // Points are split into a fixed number of blocks which are combined in order, so the sums are reproducible.
+    constexpr int block_count = 64;
+    const auto point_count = static_cast<int>(points.size());
+    std::vector<Plane_moments> block_moments(static_cast<size_t>(block_count) * label_count);
+#pragma omp parallel for
+    for (int b = 0; b < block_count; ++b) {
+        const auto end = static_cast<int>(static_cast<int64_t>(point_count) * (b + 1) / block_count);
+        for (auto i = static_cast<int>(static_cast<int64_t>(point_count) * b / block_count); i < end; ++i) {
+            const auto label = labels.at(i);
+            if (label >= 0 && label < label_count) {
+                block_moments.at(b * label_count + label).add(points.at(i));
+            }
+        }
+    }
+    std::vector<Plane> planes(label_count);
+#pragma omp parallel for
+    for (int l = 0; l < label_count; ++l) {
+        Plane_moments moments;
+        for (int b = 0; b < block_count; ++b) {
+            moments.merge(block_moments.at(b * label_count + l));
+        }
+        planes.at(l) = moments.to_plane();
+    }
+    return planes;
+}
+
+tostf::Plane tostf::find_plane_ransac(const std::vector<glm::vec4>& points, const float inlier_distance,
+                                      const int iterations, const unsigned seed) {
+    const auto point_count = static_cast<int>(points.size());
+    if (point_count < 3 || iterations <= 0) {
+        return find_plane(points);
+    }
+    std::vector<Plane> hypotheses(iterations);
+    std::vector<int> inlier_counts(iterations, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (int it = 0; it < iterations; ++it) {
+        std::array<glm::vec3, 3> samples{};
+        for (int k = 0; k < 3; ++k) {
+            const auto r = gen_counter_random_float(seed, static_cast<uint64_t>(it) * 3 + static_cast<uint64_t>(k));
+            samples.at(k) = glm::vec3(points.at(glm::min(static_cast<int>(r * static_cast<float>(point_count)),
+                                                         point_count - 1)));
+        }
+        const auto normal = cross(samples.at(1) - samples.at(0), samples.at(2) - samples.at(0));
+        if (dot(normal, normal) <= 0.0f) {
+            continue;
+        }
+        hypotheses.at(it) = {glm::vec4(samples.at(0), 1.0f), glm::vec4(normalize(normal), 0.0f)};
+        int count = 0;
+        for (const auto& p : points) {
+            count += glm::abs(dot(p - hypotheses.at(it).center, hypotheses.at(it).normal)) <= inlier_distance ? 1 : 0;
+        }
+        inlier_counts.at(it) = count;
+    }
+    // Hypotheses are stored per iteration and max_element returns the first of equally good ones.
+    const auto best = std::max_element(inlier_counts.begin(), inlier_counts.end()) - inlier_counts.begin();
+    if (inlier_counts.at(best) == 0) {
+        return find_plane(points);
+    }
+    Plane_moments moments;
+    for (const auto& p : points) {
+        if (glm::abs(dot(p - hypotheses.at(best).center, hypotheses.at(best).normal)) <= inlier_distance) {
+            moments.add(p);
+        }
+    }
+    return moments.to_plane();
+}
+
 void tostf::remove_outliers(std::vector<glm::vec4>& points, const glm::vec4 center, const float bias) {
     float avg_dist = 0;
     std::vector<float> dists;
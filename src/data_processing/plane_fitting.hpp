@@ -23,6 +23,27 @@ namespace tostf
         bool is_on_plane(glm::vec4 p, float bias = 0.001) const;
     };
 
+    // First and second order moments of a point set, accumulated in double precision.
+    struct Plane_moments {
+        void add(const glm::vec4& p);
+        void merge(const Plane_moments& other);
+        // Least squares plane through the points. The normal is the eigenvector of the smallest eigenvalue of the
+        // covariance matrix, the tangent the one of the largest eigenvalue.
+        Plane to_plane() const;
+        double count = 0.0;
+        glm::dvec3 sum{0.0};
+        // Sums of xx, yy, zz and xy, xz, yz.
+        glm::dvec3 sum_sq{0.0};
+        glm::dvec3 sum_mixed{0.0};
+    };
+
     Plane find_plane(const std::vector<glm::vec4>& points);
+    // Fits one plane per label in a single parallel pass over the points. Points with a negative label are skipped,
+    // labels without points result in a default plane.
+    std::vector<Plane> find_planes(const std::vector<glm::vec4>& points, const std::vector<int>& labels,
+                                   int label_count);
+    // Plane through three random points with the most points closer than inlier_distance, refitted to its inliers.
+    Plane find_plane_ransac(const std::vector<glm::vec4>& points, float inlier_distance, int iterations = 128,
+                            unsigned seed = 0);
     void remove_outliers(std::vector<glm::vec4>& points, glm::vec4 center, float bias = 0);
 }
@@ -0,0 +1,149 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "column_io.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+constexpr char column_magic[] = "TOSTFCOL";
+constexpr size_t column_magic_size = 8;
+constexpr uint32_t column_version = 1;
+constexpr size_t column_max_rank = 4;
+constexpr size_t column_alignment = 64;
+
+struct Column_file_header {
+    char magic[column_magic_size];
+    uint32_t version;
+    uint32_t dtype;
+    uint64_t data_offset;
+    uint32_t rank;
+    uint32_t reserved;
+    uint64_t shape[column_max_rank];
+    uint64_t chunk_rows;
+    uint64_t chunk_count;
+    char field_name[64];
+    char step[32];
+};
+
+static_assert(sizeof(Column_file_header) == 176, "The column file header has to be packed.");
+
+std::string read_column_str(const char* str, const size_t max_size) {
+    return std::string(str, std::find(str, str + max_size, '\0'));
+}
+
+void tostf::export_column(const std::filesystem::path& path, const Column_info& info, const std::vector<float>& data) {
+    if (info.shape.empty() || info.shape.size() > column_max_rank) {
+        throw std::runtime_error{"Column files support 1 to 4 dimensions, " + path.string() + " has "
+                                 + std::to_string(info.shape.size())};
+    }
+    if (std::accumulate(info.shape.begin(), info.shape.end(), uint64_t{1}, std::multiplies<>()) != data.size()) {
+        throw std::runtime_error{"The shape of " + path.string() + " does not fit " + std::to_string(data.size())
+                                 + " values"};
+    }
+    Column_file_header header{};
+    if (info.field_name.size() >= sizeof(header.field_name) || info.step.size() >= sizeof(header.step)) {
+        throw std::runtime_error{"Field name or step too long for " + path.string()};
+    }
+    std::memcpy(header.magic, column_magic, column_magic_size);
+    header.version = column_version;
+    header.dtype = static_cast<uint32_t>(column_dtype::float32);
+    header.rank = static_cast<uint32_t>(info.shape.size());
+    std::copy(info.shape.begin(), info.shape.end(), header.shape);
+    std::copy(info.field_name.begin(), info.field_name.end(), header.field_name);
+    std::copy(info.step.begin(), info.step.end(), header.step);
+    const auto row_count = info.shape.front();
+    const auto row_size = row_count > 0 ? data.size() / row_count : 0;
+    std::vector<tostf::Column_range> chunk_ranges;
+    if (info.chunk_rows > 0) {
+        header.chunk_rows = info.chunk_rows;
+        header.chunk_count = (row_count + info.chunk_rows - 1) / info.chunk_rows;
+        chunk_ranges.resize(header.chunk_count);
+#pragma omp parallel for
+        for (int c = 0; c < static_cast<int>(chunk_ranges.size()); ++c) {
+            auto min = std::numeric_limits<float>::max();
+            auto max = std::numeric_limits<float>::lowest();
+            const auto first = c * info.chunk_rows * row_size;
+            const auto last = std::min((c + 1) * info.chunk_rows, row_count) * row_size;
+            for (auto i = first; i < last; ++i) {
+                if (std::isfinite(data.at(i))) {
+                    min = std::min(min, data.at(i));
+                    max = std::max(max, data.at(i));
+                }
+            }
+            if (min > max) {
+                min = std::numeric_limits<float>::quiet_NaN();
+                max = min;
+            }
+            chunk_ranges.at(c) = {min, max};
+        }
+    }
+    const auto ranges_size = chunk_ranges.size() * sizeof(Column_range);
+    header.data_offset = (sizeof(Column_file_header) + ranges_size + column_alignment - 1) / column_alignment
+                         * column_alignment;
+    std::vector<char> front(header.data_offset, 0);
+    std::memcpy(front.data(), &header, sizeof(Column_file_header));
+    std::memcpy(front.data() + sizeof(Column_file_header), chunk_ranges.data(), ranges_size);
+    std::ofstream out;
+    out.exceptions(std::ofstream::badbit);
+    out.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error{"Error saving file to " + path.string()};
+    }
+    out.write(front.data(), static_cast<std::streamsize>(front.size()));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)));
+    out.close();
+}
+
+tostf::Column_file::Column_file(const std::filesystem::path& path)
+    : _file(path) {
+    Column_file_header header{};
+    if (_file.size() < sizeof(Column_file_header)) {
+        throw std::runtime_error{"File at " + path.string() + " is no column file."};
+    }
+    std::memcpy(&header, _file.data(), sizeof(Column_file_header));
+    if (std::memcmp(header.magic, column_magic, column_magic_size) != 0) {
+        throw std::runtime_error{"File at " + path.string() + " is no column file."};
+    }
+    if (header.version != column_version || header.dtype != static_cast<uint32_t>(column_dtype::float32)
+        || header.rank == 0 || header.rank > column_max_rank) {
+        throw std::runtime_error{"Unsupported version, data type or rank in " + path.string()};
+    }
+    _info.field_name = read_column_str(header.field_name, sizeof(header.field_name));
+    _info.step = read_column_str(header.step, sizeof(header.step));
+    _info.shape.assign(header.shape, header.shape + header.rank);
+    _info.chunk_rows = header.chunk_rows;
+    _data_offset = header.data_offset;
+    const auto ranges_end = sizeof(Column_file_header) + header.chunk_count * sizeof(Column_range);
+    if (ranges_end > _data_offset || _data_offset + size() * sizeof(float) > _file.size()) {
+        throw std::runtime_error{"File at " + path.string() + " is incomplete."};
+    }
+    _info.chunk_ranges.resize(header.chunk_count);
+    std::memcpy(_info.chunk_ranges.data(), _file.data() + sizeof(Column_file_header),
+                header.chunk_count * sizeof(Column_range));
+}
+
+const tostf::Column_info& tostf::Column_file::info() const {
+    return _info;
+}
+
+const float* tostf::Column_file::data() const {
+    return reinterpret_cast<const float*>(_file.data() + _data_offset);
+}
+
+size_t tostf::Column_file::size() const {
+    return std::accumulate(_info.shape.begin(), _info.shape.end(), size_t{1}, std::multiplies<>());
+}
+
+size_t tostf::Column_file::row_size() const {
+    return std::accumulate(_info.shape.begin() + 1, _info.shape.end(), size_t{1}, std::multiplies<>());
+}
@@ -0,0 +1,62 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace tostf
+{
+    enum class column_dtype : uint32_t {
+        float32 = 0
+    };
+
+    struct Column_range {
+        float min;
+        float max;
+    };
+
+    // Description of one field of one time step. The first dimension counts the rows, e.g. cells and boundary faces,
+    // the others hold the components of a row.
+    struct Column_info {
+        std::string field_name;
+        std::string step;
+        std::vector<uint64_t> shape;
+        column_dtype dtype = column_dtype::float32;
+        // Rows per chunk of the min/max ranges, 0 stores no ranges.
+        uint64_t chunk_rows = 0;
+        // Range of the finite values of every chunk, NaN if a chunk has none.
+        std::vector<Column_range> chunk_ranges;
+    };
+
+    // Column files (.tcol) store the payload behind a fixed little endian header:
+    //   char magic[8] "TOSTFCOL", uint32 version, uint32 dtype, uint64 data_offset, uint32 rank, uint32 reserved,
+    //   uint64 shape[4], uint64 chunk_rows, uint64 chunk_count, char field_name[64], char step[32],
+    //   followed by chunk_count float pairs min, max.
+    // The payload starts at data_offset, a multiple of 64, in C order. It can be memory mapped directly, e.g. with
+    // numpy.memmap(path, dtype="<f4", mode="r", offset=data_offset, shape=shape[:rank]).
+    // The chunk ranges are computed from the data, so only name, step, shape and chunk_rows of info are used.
+    void export_column(const std::filesystem::path& path, const Column_info& info, const std::vector<float>& data);
+
+    // Memory mapped column file, the chunk ranges allow to skip chunks without touching their pages.
+    class Column_file {
+    public:
+        explicit Column_file(const std::filesystem::path& path);
+        const Column_info& info() const;
+        const float* data() const;
+        size_t size() const;
+        size_t row_size() const;
+    private:
+        Mapped_file _file;
+        Column_info _info;
+        size_t _data_offset = 0;
+    };
+}
@@ -0,0 +1,120 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "mapped_file.hpp"
+#include "file_handling.hpp"
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+tostf::Mapped_file::Mapped_file(const std::filesystem::path& path)
+    : _path(path) {
+    check_file_validity(path);
+    _size = file_size(path);
+    // Empty files cannot be mapped, they are represented without data.
+    if (_size == 0) {
+        return;
+    }
+#if defined(_WIN32)
+    _file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file_handle == INVALID_HANDLE_VALUE) {
+        _file_handle = nullptr;
+        throw std::runtime_error{"Error opening file " + path.string()};
+    }
+    _mapping_handle = CreateFileMappingW(_file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping_handle != nullptr) {
+        _data = static_cast<const char*>(MapViewOfFile(_mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (_data == nullptr) {
+        unmap();
+        throw std::runtime_error{"Error mapping file " + path.string()};
+    }
+#else
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error{"Error opening file " + path.string()};
+    }
+    auto mapping = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error{"Error mapping file " + path.string()};
+    }
+    _data = static_cast<const char*>(mapping);
+#endif
+}
+
+tostf::Mapped_file::Mapped_file(Mapped_file&& other) noexcept
+    : _path(std::move(other._path)), _data(std::exchange(other._data, nullptr)),
+      _size(std::exchange(other._size, 0)) {
+#if defined(_WIN32)
+    _file_handle = std::exchange(other._file_handle, nullptr);
+    _mapping_handle = std::exchange(other._mapping_handle, nullptr);
+#endif
+}
+
+tostf::Mapped_file& tostf::Mapped_file::operator=(Mapped_file&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        _path = std::move(other._path);
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+#if defined(_WIN32)
+        _file_handle = std::exchange(other._file_handle, nullptr);
+        _mapping_handle = std::exchange(other._mapping_handle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+tostf::Mapped_file::~Mapped_file() {
+    unmap();
+}
+
+const char* tostf::Mapped_file::data() const {
+    return _data;
+}
+
+size_t tostf::Mapped_file::size() const {
+    return _size;
+}
+
+const std::filesystem::path& tostf::Mapped_file::path() const {
+    return _path;
+}
+
+void tostf::Mapped_file::unmap() {
+#if defined(_WIN32)
+    if (_data != nullptr) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping_handle != nullptr) {
+        CloseHandle(_mapping_handle);
+    }
+    if (_file_handle != nullptr) {
+        CloseHandle(_file_handle);
+    }
+    _file_handle = nullptr;
+    _mapping_handle = nullptr;
+#else
+    if (_data != nullptr) {
+        munmap(const_cast<char*>(_data), _size);
+    }
+#endif
+    _data = nullptr;
+    _size = 0;
+}
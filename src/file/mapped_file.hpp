@@ -0,0 +1,37 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <filesystem>
+
+namespace tostf
+{
+    // Read only memory mapping of a whole file. The pages are loaded by the operating system on access,
+    // so only the parts of large result files that are actually read take up memory.
+    class Mapped_file {
+    public:
+        explicit Mapped_file(const std::filesystem::path& path);
+        Mapped_file(const Mapped_file&) = delete;
+        Mapped_file& operator=(const Mapped_file&) = delete;
+        Mapped_file(Mapped_file&& other) noexcept;
+        Mapped_file& operator=(Mapped_file&& other) noexcept;
+        ~Mapped_file();
+        const char* data() const;
+        size_t size() const;
+        const std::filesystem::path& path() const;
+    private:
+        void unmap();
+        std::filesystem::path _path;
+        const char* _data = nullptr;
+        size_t _size = 0;
+#if defined(_WIN32)
+        void* _file_handle = nullptr;
+        void* _mapping_handle = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,131 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "npy_io.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+constexpr char npy_magic[] = "\x93NUMPY";
+constexpr size_t npy_magic_size = 6;
+// Magic string, version and header length.
+constexpr size_t npy_preamble_size = npy_magic_size + 2 + sizeof(uint16_t);
+constexpr size_t npy_alignment = 64;
+
+std::string gen_npy_shape_str(const std::vector<size_t>& shape) {
+    std::string shape_str = "(";
+    for (const auto s : shape) {
+        shape_str += std::to_string(s) + ", ";
+    }
+    // One dimensional shapes keep the trailing comma of a Python tuple.
+    if (shape.size() > 1) {
+        shape_str.erase(shape_str.size() - 2);
+    }
+    else if (!shape.empty()) {
+        shape_str.pop_back();
+    }
+    return shape_str + ")";
+}
+
+void tostf::export_npy(const std::filesystem::path& path, const std::vector<float>& data,
+                       const std::vector<size_t>& shape) {
+    const auto element_count = std::accumulate(shape.begin(), shape.end(), size_t{1}, std::multiplies<>());
+    if (element_count != data.size()) {
+        throw std::runtime_error{"Shape " + gen_npy_shape_str(shape) + " does not fit " + std::to_string(data.size())
+                                 + " values for " + path.string()};
+    }
+    std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': " + gen_npy_shape_str(shape) + ", }";
+    // The payload starts aligned, the header is padded with spaces and terminated by a newline.
+    const auto padded_size = (npy_preamble_size + header.size() + 1 + npy_alignment - 1) / npy_alignment
+                             * npy_alignment;
+    header.resize(padded_size - npy_preamble_size - 1, ' ');
+    header.push_back('\n');
+    const auto header_size = static_cast<uint16_t>(header.size());
+    std::ofstream out;
+    out.exceptions(std::ofstream::badbit);
+    out.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error{"Error saving file to " + path.string()};
+    }
+    out.write(npy_magic, npy_magic_size);
+    out.put(1);
+    out.put(0);
+    out.write(reinterpret_cast<const char*>(&header_size), sizeof(uint16_t));
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)));
+    out.close();
+}
+
+tostf::Npy_file::Npy_file(const std::filesystem::path& path)
+    : _file(path) {
+    if (_file.size() < npy_preamble_size || std::memcmp(_file.data(), npy_magic, npy_magic_size) != 0) {
+        throw std::runtime_error{"File at " + path.string() + " is no .npy file."};
+    }
+    const auto major_version = static_cast<uint8_t>(_file.data()[npy_magic_size]);
+    // Version 2.0 and 3.0 only differ by a 32 bit header length.
+    size_t header_size = 0;
+    size_t header_start = npy_preamble_size;
+    if (major_version == 1) {
+        uint16_t size = 0;
+        std::memcpy(&size, _file.data() + npy_magic_size + 2, sizeof(uint16_t));
+        header_size = size;
+    }
+    else {
+        uint32_t size = 0;
+        header_start += sizeof(uint32_t) - sizeof(uint16_t);
+        if (_file.size() < header_start) {
+            throw std::runtime_error{"Header of " + path.string() + " is incomplete."};
+        }
+        std::memcpy(&size, _file.data() + npy_magic_size + 2, sizeof(uint32_t));
+        header_size = size;
+    }
+    _data_offset = header_start + header_size;
+    if (_file.size() < _data_offset) {
+        throw std::runtime_error{"Header of " + path.string() + " is incomplete."};
+    }
+    const std::string header(_file.data() + header_start, header_size);
+    if (header.find("'descr': '<f4'") == std::string::npos) {
+        throw std::runtime_error{"Only little endian float32 data is supported, " + path.string() + " has " + header};
+    }
+    if (header.find("'fortran_order': False") == std::string::npos) {
+        throw std::runtime_error{"Only C order is supported, " + path.string() + " has " + header};
+    }
+    const auto shape_begin = header.find('(', header.find("'shape'"));
+    const auto shape_end = header.find(')', shape_begin);
+    if (shape_begin == std::string::npos || shape_end == std::string::npos) {
+        throw std::runtime_error{"No shape in header of " + path.string()};
+    }
+    auto pos = shape_begin + 1;
+    while (pos < shape_end) {
+        const auto next = std::min(header.find(',', pos), shape_end);
+        const auto dim = header.substr(pos, next - pos);
+        if (dim.find_first_not_of(' ') != std::string::npos) {
+            _shape.push_back(std::stoull(dim));
+        }
+        pos = next + 1;
+    }
+    if (_data_offset + size() * sizeof(float) > _file.size()) {
+        throw std::runtime_error{"Data of " + path.string() + " is incomplete."};
+    }
+}
+
+const std::vector<size_t>& tostf::Npy_file::shape() const {
+    return _shape;
+}
+
+const float* tostf::Npy_file::data() const {
+    return reinterpret_cast<const float*>(_file.data() + _data_offset);
+}
+
+size_t tostf::Npy_file::size() const {
+    return std::accumulate(_shape.begin(), _shape.end(), size_t{1}, std::multiplies<>());
+}
@@ -0,0 +1,33 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "mapped_file.hpp"
+#include <filesystem>
+#include <vector>
+
+namespace tostf
+{
+    // Writes little endian float32 data in C order as NumPy .npy file (format version 1.0),
+    // so it can be read with numpy.load or memory mapped with numpy.load(path, mmap_mode="r").
+    void export_npy(const std::filesystem::path& path, const std::vector<float>& data,
+                    const std::vector<size_t>& shape);
+
+    // Memory mapped .npy file written by export_npy or NumPy. Only little endian float32 data in C order is supported.
+    class Npy_file {
+    public:
+        explicit Npy_file(const std::filesystem::path& path);
+        const std::vector<size_t>& shape() const;
+        const float* data() const;
+        size_t size() const;
+    private:
+        Mapped_file _file;
+        std::vector<size_t> _shape;
+        size_t _data_offset = 0;
+    };
+}
@@ -0,0 +1,169 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "obj_writer.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+
+constexpr size_t chunk_bytes = 1u << 20u;
+constexpr size_t chunks_per_batch = 16;
+constexpr size_t max_index_length = 20;
+
+// Fixed notation of the largest float has 39 digits in front of the decimal point.
+size_t calc_max_float_length(const int precision) {
+    return 41 + static_cast<size_t>(precision);
+}
+
+char* write_float(char* pos, const float value, const size_t max_length, const int precision) {
+    return std::to_chars(pos, pos + max_length, value, std::chars_format::fixed, precision).ptr;
+}
+
+char* write_face_vertex(char* pos, const uint64_t id, const bool with_normals, const bool with_uv_coords) {
+    pos = std::to_chars(pos, pos + max_index_length, id).ptr;
+    if (with_normals || with_uv_coords) {
+        *pos++ = '/';
+        if (with_uv_coords) {
+            pos = std::to_chars(pos, pos + max_index_length, id).ptr;
+        }
+        if (with_normals) {
+            *pos++ = '/';
+            pos = std::to_chars(pos, pos + max_index_length, id).ptr;
+        }
+    }
+    return pos;
+}
+
+tostf::Obj_writer::Obj_writer(const std::filesystem::path& path, const int precision)
+    : _path(path), _precision(precision) {
+    _out.exceptions(std::ofstream::badbit);
+    _out.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!_out.is_open()) {
+        throw std::runtime_error{"Error saving file to " + path.string()};
+    }
+}
+
+tostf::Obj_writer::~Obj_writer() {
+    if (_pending.valid()) {
+        _pending.wait();
+    }
+}
+
+template <typename F>
+void tostf::Obj_writer::write_lines(const size_t line_count, const size_t max_line_length, F format_line) {
+    const auto lines_per_chunk = std::max(chunk_bytes / max_line_length, size_t{1});
+    const auto chunk_count = (line_count + lines_per_chunk - 1) / lines_per_chunk;
+    for (size_t batch_start = 0; batch_start < chunk_count; batch_start += chunks_per_batch) {
+        auto& chunks = _chunks.at(_active_batch);
+        auto& chunk_sizes = _chunk_sizes.at(_active_batch);
+        chunks.resize(chunks_per_batch);
+        chunk_sizes.resize(chunks_per_batch);
+        const auto batch_size = static_cast<int>(std::min(chunks_per_batch, chunk_count - batch_start));
+#pragma omp parallel for
+        for (int c = 0; c < batch_size; ++c) {
+            auto& chunk = chunks.at(c);
+            // Buffers only grow, so they are allocated once per writer.
+            if (chunk.size() < lines_per_chunk * max_line_length) {
+                chunk.resize(lines_per_chunk * max_line_length);
+            }
+            const auto first = (batch_start + c) * lines_per_chunk;
+            const auto last = std::min(first + lines_per_chunk, line_count);
+            auto pos = chunk.data();
+            for (auto i = first; i < last; ++i) {
+                pos = format_line(pos, i);
+            }
+            chunk_sizes.at(c) = static_cast<size_t>(pos - chunk.data());
+        }
+        // The previous batch has to be written before this one, afterwards its buffers are free for the next batch.
+        wait_for_pending();
+        _pending = std::async(std::launch::async, [this, &chunks, &chunk_sizes, batch_size]() {
+            for (int c = 0; c < batch_size; ++c) {
+                _out.write(chunks.at(c).data(), static_cast<std::streamsize>(chunk_sizes.at(c)));
+            }
+        });
+        _active_batch = 1 - _active_batch;
+    }
+}
+
+void tostf::Obj_writer::write_vertices(const std::vector<glm::vec4>& vertices) {
+    const auto float_length = calc_max_float_length(_precision);
+    write_lines(vertices.size(), 2 + 3 * (float_length + 1), [&](char* pos, const size_t i) {
+        const auto& v = vertices.at(i);
+        *pos++ = 'v';
+        for (int j = 0; j < 3; ++j) {
+            *pos++ = ' ';
+            pos = write_float(pos, v[j], float_length, _precision);
+        }
+        *pos++ = '\n';
+        return pos;
+    });
+}
+
+void tostf::Obj_writer::write_normals(const std::vector<glm::vec4>& normals) {
+    const auto float_length = calc_max_float_length(_precision);
+    write_lines(normals.size(), 3 + 3 * (float_length + 1), [&](char* pos, const size_t i) {
+        const auto& n = normals.at(i);
+        *pos++ = 'v';
+        *pos++ = 'n';
+        for (int j = 0; j < 3; ++j) {
+            *pos++ = ' ';
+            pos = write_float(pos, n[j], float_length, _precision);
+        }
+        *pos++ = '\n';
+        return pos;
+    });
+}
+
+void tostf::Obj_writer::write_uv_coords(const std::vector<glm::vec2>& uv_coords) {
+    const auto float_length = calc_max_float_length(_precision);
+    write_lines(uv_coords.size(), 3 + 2 * (float_length + 1), [&](char* pos, const size_t i) {
+        const auto& uv = uv_coords.at(i);
+        *pos++ = 'v';
+        *pos++ = 't';
+        for (int j = 0; j < 2; ++j) {
+            *pos++ = ' ';
+            pos = write_float(pos, uv[j], float_length, _precision);
+        }
+        *pos++ = '\n';
+        return pos;
+    });
+}
+
+void tostf::Obj_writer::write_group(const std::string& name) {
+    wait_for_pending();
+    _out << "g " << name << "\n";
+}
+
+void tostf::Obj_writer::write_faces(const std::vector<unsigned>& indices, const bool with_normals,
+                                    const bool with_uv_coords, const unsigned index_offset) {
+    // OBJ indices start at 1.
+    const auto first_id = static_cast<uint64_t>(index_offset) + 1;
+    write_lines(indices.size() / 3, 2 + 3 * (3 * (max_index_length + 1)), [&](char* pos, const size_t i) {
+        *pos++ = 'f';
+        for (size_t j = 0; j < 3; ++j) {
+            *pos++ = ' ';
+            pos = write_face_vertex(pos, first_id + indices.at(i * 3 + j), with_normals, with_uv_coords);
+        }
+        *pos++ = '\n';
+        return pos;
+    });
+}
+
+void tostf::Obj_writer::close() {
+    wait_for_pending();
+    _out.close();
+    if (_out.fail()) {
+        throw std::runtime_error{"Error saving file to " + _path.string()};
+    }
+}
+
+void tostf::Obj_writer::wait_for_pending() {
+    if (_pending.valid()) {
+        _pending.get();
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "math/glm_helper.hpp"
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <vector>
+
+namespace tostf
+{
+    // Streams indexed OBJ files. Lines are formatted with to_chars in parallel chunks into preallocated buffers.
+    // While one batch of chunks is written to the file in order, the next batch is formatted.
+    class Obj_writer {
+    public:
+        explicit Obj_writer(const std::filesystem::path& path, int precision = 7);
+        Obj_writer(const Obj_writer&) = delete;
+        Obj_writer& operator=(const Obj_writer&) = delete;
+        ~Obj_writer();
+        void write_vertices(const std::vector<glm::vec4>& vertices);
+        void write_normals(const std::vector<glm::vec4>& normals);
+        void write_uv_coords(const std::vector<glm::vec2>& uv_coords);
+        void write_group(const std::string& name);
+        // Face indices refer to the vertices, normals and uv coordinates written before with the same ids.
+        void write_faces(const std::vector<unsigned>& indices, bool with_normals, bool with_uv_coords,
+                         unsigned index_offset = 0);
+        // Waits for the pending writes and throws if the file could not be written completely.
+        void close();
+    private:
+        template <typename F>
+        void write_lines(size_t line_count, size_t max_line_length, F format_line);
+        void wait_for_pending();
+        std::filesystem::path _path;
+        std::ofstream _out;
+        int _precision;
+        std::array<std::vector<std::vector<char>>, 2> _chunks;
+        std::array<std::vector<size_t>, 2> _chunk_sizes;
+        int _active_batch = 0;
+        std::future<void> _pending;
+    };
+}
@@ -0,0 +1,160 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "stl_io.hpp"
+#include "file_handling.hpp"
+#include "math/vector_math.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+constexpr size_t stl_header_size = 80;
+// Normal and three corners as floats followed by the 16 bit attribute.
+constexpr size_t stl_triangle_size = 12 * sizeof(float) + sizeof(uint16_t);
+
+void write_stl_vec3(char* pos, const glm::vec3& v) {
+    std::memcpy(pos, &v.x, sizeof(float));
+    std::memcpy(pos + sizeof(float), &v.y, sizeof(float));
+    std::memcpy(pos + 2 * sizeof(float), &v.z, sizeof(float));
+}
+
+glm::vec3 read_stl_vec3(const char* pos) {
+    glm::vec3 v;
+    std::memcpy(&v.x, pos, sizeof(float));
+    std::memcpy(&v.y, pos + sizeof(float), sizeof(float));
+    std::memcpy(&v.z, pos + 2 * sizeof(float), sizeof(float));
+    return v;
+}
+
+void tostf::export_binary_stl(const std::filesystem::path& path, const std::vector<glm::vec4>& vertices,
+                              const std::vector<Stl_solid>& solids) {
+    if (solids.size() > std::numeric_limits<uint16_t>::max() + size_t{1}) {
+        throw std::runtime_error{"Binary STL supports at most 65536 solids."};
+    }
+    std::vector<size_t> solid_offsets(solids.size() + 1, 0);
+    for (size_t s = 0; s < solids.size(); ++s) {
+        solid_offsets.at(s + 1) = solid_offsets.at(s) + solids.at(s).indices.size() / 3;
+    }
+    const auto triangle_count = solid_offsets.back();
+    if (triangle_count > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error{"Too many triangles for binary STL."};
+    }
+    // Headers starting with "solid" are mistaken for ASCII STL by many readers.
+    std::string header = "tostf binary STL, solids:";
+    for (const auto& solid : solids) {
+        header += " " + solid.name;
+    }
+    header.resize(stl_header_size, ' ');
+    std::vector<char> buffer(stl_header_size + sizeof(uint32_t) + triangle_count * stl_triangle_size);
+    std::memcpy(buffer.data(), header.data(), stl_header_size);
+    const auto count = static_cast<uint32_t>(triangle_count);
+    std::memcpy(buffer.data() + stl_header_size, &count, sizeof(uint32_t));
+    for (size_t s = 0; s < solids.size(); ++s) {
+        const auto& indices = solids.at(s).indices;
+        const auto solid_id = static_cast<uint16_t>(s);
+        auto solid_data = buffer.data() + stl_header_size + sizeof(uint32_t) + solid_offsets.at(s) * stl_triangle_size;
+#pragma omp parallel for
+        for (int t = 0; t < static_cast<int>(indices.size() / 3); ++t) {
+            const auto& a = vertices.at(indices.at(t * 3));
+            const auto& b = vertices.at(indices.at(t * 3 + 1));
+            const auto& c = vertices.at(indices.at(t * 3 + 2));
+            const auto normal = math::calc_normal(a, b, c);
+            const auto normal_length = length(normal);
+            auto pos = solid_data + t * stl_triangle_size;
+            write_stl_vec3(pos, normal_length > 0.0f ? normal / normal_length : glm::vec3(0.0f));
+            write_stl_vec3(pos + 3 * sizeof(float), glm::vec3(a));
+            write_stl_vec3(pos + 6 * sizeof(float), glm::vec3(b));
+            write_stl_vec3(pos + 9 * sizeof(float), glm::vec3(c));
+            std::memcpy(pos + 12 * sizeof(float), &solid_id, sizeof(uint16_t));
+        }
+    }
+    std::ofstream out;
+    out.exceptions(std::ofstream::badbit);
+    out.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error{"Error saving file to " + path.string()};
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.close();
+}
+
+tostf::Stl_data tostf::load_binary_stl(const std::filesystem::path& path) {
+    check_file_validity(path);
+    const auto size = file_size(path);
+    std::vector<char> buffer(size);
+    std::ifstream in;
+    in.exceptions(std::ifstream::badbit);
+    in.open(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error{"Error loading file from " + path.string()};
+    }
+    in.read(buffer.data(), static_cast<std::streamsize>(size));
+    in.close();
+    uint32_t triangle_count = 0;
+    if (size >= stl_header_size + sizeof(uint32_t)) {
+        std::memcpy(&triangle_count, buffer.data() + stl_header_size, sizeof(uint32_t));
+    }
+    if (size != stl_header_size + sizeof(uint32_t) + triangle_count * stl_triangle_size) {
+        throw std::runtime_error{"File at " + path.string() + " is no binary STL."};
+    }
+    Stl_data data;
+    data.header = std::string(buffer.data(), stl_header_size);
+    data.header.erase(data.header.find_last_not_of(std::string(" \0", 2)) + 1);
+    const auto corner_count = static_cast<int>(triangle_count * 3);
+    std::vector<glm::vec3> corners(corner_count);
+    data.solid_ids.resize(triangle_count);
+    const auto triangle_data = buffer.data() + stl_header_size + sizeof(uint32_t);
+#pragma omp parallel for
+    for (int t = 0; t < static_cast<int>(triangle_count); ++t) {
+        const auto pos = triangle_data + t * stl_triangle_size;
+        for (int i = 0; i < 3; ++i) {
+            corners.at(t * 3 + i) = read_stl_vec3(pos + (i + 1) * 3 * sizeof(float));
+        }
+        std::memcpy(&data.solid_ids.at(t), pos + 12 * sizeof(float), sizeof(uint16_t));
+    }
+    // Sorting the position bits groups equal corners, ties are broken by the corner id,
+    // so the first corner of a group is its first occurrence in the file.
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t, int>> corner_keys(corner_count);
+#pragma omp parallel for
+    for (int c = 0; c < corner_count; ++c) {
+        std::array<uint32_t, 3> bits{};
+        std::memcpy(bits.data(), &corners.at(c).x, sizeof(float));
+        std::memcpy(bits.data() + 1, &corners.at(c).y, sizeof(float));
+        std::memcpy(bits.data() + 2, &corners.at(c).z, sizeof(float));
+        corner_keys.at(c) = {bits.at(0), bits.at(1), bits.at(2), c};
+    }
+    std::sort(std::execution::par, corner_keys.begin(), corner_keys.end());
+    std::vector<int> first_corner(corner_count);
+    int group_start = 0;
+    for (int i = 0; i < corner_count; ++i) {
+        if (i > 0 && std::get<0>(corner_keys.at(i)) == std::get<0>(corner_keys.at(i - 1))
+            && std::get<1>(corner_keys.at(i)) == std::get<1>(corner_keys.at(i - 1))
+            && std::get<2>(corner_keys.at(i)) == std::get<2>(corner_keys.at(i - 1))) {
+            first_corner.at(std::get<3>(corner_keys.at(i))) = std::get<3>(corner_keys.at(group_start));
+        }
+        else {
+            group_start = i;
+            first_corner.at(std::get<3>(corner_keys.at(i))) = std::get<3>(corner_keys.at(i));
+        }
+    }
+    // Vertices are numbered in the order of their first occurrence.
+    std::vector<unsigned> vertex_ids(corner_count);
+    data.indices.resize(corner_count);
+    for (int c = 0; c < corner_count; ++c) {
+        if (first_corner.at(c) == c) {
+            vertex_ids.at(c) = static_cast<unsigned>(data.vertices.size());
+            data.vertices.emplace_back(corners.at(c), 1.0f);
+        }
+        data.indices.at(c) = vertex_ids.at(first_corner.at(c));
+    }
+    return data;
+}
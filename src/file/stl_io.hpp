@@ -0,0 +1,38 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "math/glm_helper.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace tostf
+{
+    // Triangles of one region, the indices refer to the vertices shared by all solids of a file.
+    struct Stl_solid {
+        std::string name;
+        std::vector<unsigned> indices;
+    };
+
+    // Binary STL has no solid names. The 16 bit attribute of every triangle stores the id of its solid, which
+    // OpenFOAM reads as region patch<id>. The names are only kept in the header for reference.
+    void export_binary_stl(const std::filesystem::path& path, const std::vector<glm::vec4>& vertices,
+                           const std::vector<Stl_solid>& solids);
+
+    struct Stl_data {
+        std::string header;
+        std::vector<glm::vec4> vertices;
+        std::vector<unsigned> indices;
+        std::vector<uint16_t> solid_ids;
+    };
+
+    // Triangle corners with bitwise equal positions are joined, so exported meshes are read back indexed.
+    Stl_data load_binary_stl(const std::filesystem::path& path);
+}
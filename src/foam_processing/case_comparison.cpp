@@ -0,0 +1,446 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "case_comparison.hpp"
+#include "derived_fields.hpp"
+#include "file/mapped_file.hpp"
+#include "glm/gtx/component_wise.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+constexpr char correspondence_magic[] = "TOSTFMAP";
+constexpr size_t correspondence_magic_size = 8;
+constexpr uint32_t correspondence_version = 1;
+constexpr size_t interpolated_neighbor_count = 8;
+const std::string difference_suffix = "_diff";
+const std::string relative_difference_suffix = "_rel_diff";
+
+struct Correspondence_file_header {
+    char magic[correspondence_magic_size];
+    uint32_t version;
+    uint32_t mode;
+    uint64_t reference_fingerprint;
+    uint64_t comparing_fingerprint;
+    uint64_t row_count;
+    uint64_t entry_count;
+};
+
+static_assert(sizeof(Correspondence_file_header) == 48, "The correspondence file header has to be packed.");
+
+struct Comparison_region {
+    std::string name;
+    size_t offset;
+    const std::vector<glm::vec4>* points;
+};
+
+std::vector<Comparison_region> gen_comparison_regions(const tostf::foam::Poly_mesh& mesh) {
+    std::vector<Comparison_region> regions{{"internal", 0, &mesh.cell_centers}};
+    for (const auto& b : mesh.boundaries) {
+        regions.push_back({b.name, regions.back().offset + regions.back().points->size(), &b.points});
+    }
+    return regions;
+}
+
+size_t calc_row_count(const std::vector<Comparison_region>& regions) {
+    return regions.back().offset + regions.back().points->size();
+}
+
+// Uniform grid over a point set with the point ids of every grid cell in CSR layout.
+struct Point_grid {
+    glm::vec3 bb_min{0.0f};
+    float cell_size = 1.0f;
+    glm::ivec3 cell_count{1};
+    std::vector<int> cell_offsets;
+    std::vector<int> point_ids;
+};
+
+glm::ivec3 calc_grid_cell(const Point_grid& grid, const glm::vec4& pos) {
+    return clamp(glm::ivec3(floor((glm::vec3(pos) - grid.bb_min) / grid.cell_size)), glm::ivec3(0),
+                 grid.cell_count - glm::ivec3(1));
+}
+
+int calc_grid_cell_id(const Point_grid& grid, const glm::ivec3& cell) {
+    return (cell.z * grid.cell_count.y + cell.y) * grid.cell_count.x + cell.x;
+}
+
+// The cell count along the longest side grows with the cube root of the point count.
+Point_grid build_point_grid(const std::vector<glm::vec4>& points) {
+    Point_grid grid;
+    if (points.empty()) {
+        grid.cell_offsets.assign(2, 0);
+        return grid;
+    }
+    grid.bb_min = glm::vec3(points.front());
+    auto bb_max = grid.bb_min;
+    for (const auto& p : points) {
+        grid.bb_min = min(grid.bb_min, glm::vec3(p));
+        bb_max = max(bb_max, glm::vec3(p));
+    }
+    const auto extent = compMax(bb_max - grid.bb_min);
+    const auto cells_per_side = std::max(1.0f, std::round(std::cbrt(static_cast<float>(points.size()))));
+    grid.cell_size = extent > 0.0f ? extent / cells_per_side : 1.0f;
+    grid.cell_count = max(glm::ivec3(1), glm::ivec3(ceil((bb_max - grid.bb_min) / grid.cell_size)));
+    const auto total_cells = static_cast<size_t>(grid.cell_count.x) * grid.cell_count.y * grid.cell_count.z;
+    std::vector<int> point_cells(points.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        point_cells.at(i) = calc_grid_cell_id(grid, calc_grid_cell(grid, points.at(i)));
+    }
+    grid.cell_offsets.assign(total_cells + 1, 0);
+    for (const auto c : point_cells) {
+        ++grid.cell_offsets.at(c + 1);
+    }
+    std::partial_sum(grid.cell_offsets.begin(), grid.cell_offsets.end(), grid.cell_offsets.begin());
+    grid.point_ids.resize(points.size());
+    auto fill_pos = grid.cell_offsets;
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        grid.point_ids.at(fill_pos.at(point_cells.at(i))++) = i;
+    }
+    return grid;
+}
+
+// Up to k nearest points sorted by squared distance. The grid cells are searched in growing shells around the
+// position until no unvisited cell can hold a closer point.
+void find_nearest_points(const Point_grid& grid, const std::vector<glm::vec4>& points, const glm::vec4& pos,
+                         const size_t k, std::vector<std::pair<float, int>>& nearest) {
+    nearest.clear();
+    const auto count = std::min(k, points.size());
+    if (count == 0) {
+        return;
+    }
+    const auto center = calc_grid_cell(grid, pos);
+    const auto max_shell = compMax(grid.cell_count);
+    for (int r = 0; r <= max_shell; ++r) {
+        const auto shell_min = max(center - glm::ivec3(r), glm::ivec3(0));
+        const auto shell_max = min(center + glm::ivec3(r), grid.cell_count - glm::ivec3(1));
+        for (int z = shell_min.z; z <= shell_max.z; ++z) {
+            for (int y = shell_min.y; y <= shell_max.y; ++y) {
+                for (int x = shell_min.x; x <= shell_max.x; ++x) {
+                    const glm::ivec3 cell(x, y, z);
+                    if (compMax(abs(cell - center)) != r) {
+                        continue;
+                    }
+                    const auto cell_id = calc_grid_cell_id(grid, cell);
+                    for (int i = grid.cell_offsets.at(cell_id); i < grid.cell_offsets.at(cell_id + 1); ++i) {
+                        const auto p_id = grid.point_ids.at(i);
+                        const auto diff = glm::vec3(points.at(p_id) - pos);
+                        const std::pair<float, int> candidate{dot(diff, diff), p_id};
+                        if (nearest.size() < count || candidate < nearest.back()) {
+                            nearest.insert(std::upper_bound(nearest.begin(), nearest.end(), candidate), candidate);
+                            if (nearest.size() > count) {
+                                nearest.pop_back();
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        const auto searched_dist = static_cast<float>(r) * grid.cell_size;
+        if (nearest.size() == count && nearest.back().first <= searched_dist * searched_dist) {
+            break;
+        }
+    }
+}
+
+void hash_bytes(uint64_t& hash, const void* data, const size_t size) {
+    const auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+// Values of a field per datapoint with components values per row, regions without values are NaN.
+std::vector<float> load_field_rows(const tostf::foam::Poly_mesh& mesh, const std::string& step,
+                                   const std::string& field_name, const bool is_vector) {
+    const auto regions = gen_comparison_regions(mesh);
+    const auto components = is_vector ? 3 : 1;
+    std::vector<float> rows(calc_row_count(regions) * components, std::numeric_limits<float>::quiet_NaN());
+    const auto copy_region = [&rows, components](const auto& data, const Comparison_region& region) {
+        if (data.size() != region.points->size()) {
+            return;
+        }
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(data.size()); ++i) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(data.at(0))>, float>) {
+                rows.at(region.offset + i) = data.at(i);
+            }
+            else {
+                for (int c = 0; c < components; ++c) {
+                    rows.at((region.offset + i) * components + c) = data.at(i)[c];
+                }
+            }
+        }
+    };
+    const auto copy_field = [&regions, &copy_region](const auto& field) {
+        copy_region(field.internal_data, regions.at(0));
+        for (size_t b_id = 0; b_id < field.boundaries_data.size(); ++b_id) {
+            copy_region(field.boundaries_data.at(b_id), regions.at(b_id + 1));
+        }
+    };
+    if (is_vector) {
+        copy_field(tostf::foam::load_step_vector_field(mesh, step, field_name));
+    }
+    else {
+        copy_field(tostf::foam::load_step_scalar_field(mesh, step, field_name));
+    }
+    return rows;
+}
+
+// Regions holding a NaN are left empty, like regions without values in the loaded fields.
+tostf::foam::Field<float> gen_region_field(const std::vector<Comparison_region>& regions,
+                                           const std::vector<float>& rows) {
+    tostf::foam::Field<float> field;
+    field.boundaries_data.resize(regions.size() - 1);
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t r_id = 0; r_id < regions.size(); ++r_id) {
+        const auto first = rows.begin() + regions.at(r_id).offset;
+        const auto last = first + regions.at(r_id).points->size();
+        if (std::any_of(first, last, [](const float v) { return std::isnan(v); })) {
+            continue;
+        }
+        auto& data = r_id == 0 ? field.internal_data : field.boundaries_data.at(r_id - 1);
+        data.assign(first, last);
+        for (const auto v : data) {
+            field.min = std::min(field.min, v);
+            field.max = std::max(field.max, v);
+            sum += v;
+        }
+        count += data.size();
+    }
+    if (count > 0) {
+        field.avg = static_cast<float>(sum / static_cast<double>(count));
+    }
+    return field;
+}
+
+uint64_t tostf::foam::calc_mesh_fingerprint(const Poly_mesh& mesh) {
+    // FNV-1a over the positions of the datapoints and the names and sizes of the boundaries.
+    uint64_t hash = 14695981039346656037ull;
+    const auto hash_points = [&hash](const std::vector<glm::vec4>& points) {
+        for (const auto& p : points) {
+            const glm::vec3 xyz(p);
+            hash_bytes(hash, &xyz, sizeof(glm::vec3));
+        }
+    };
+    hash_points(mesh.cell_centers);
+    for (const auto& b : mesh.boundaries) {
+        hash_bytes(hash, b.name.data(), b.name.size());
+        const auto size = static_cast<uint64_t>(b.points.size());
+        hash_bytes(hash, &size, sizeof(uint64_t));
+        hash_points(b.points);
+    }
+    return hash;
+}
+
+tostf::foam::Mesh_correspondence tostf::foam::build_mesh_correspondence(const Poly_mesh& reference,
+                                                                        const Poly_mesh& comparing,
+                                                                        const correspondence_mode mode) {
+    const auto k = mode == correspondence_mode::nearest ? size_t{1} : interpolated_neighbor_count;
+    const auto reference_regions = gen_comparison_regions(reference);
+    const auto comparing_regions = gen_comparison_regions(comparing);
+    std::vector<Point_grid> grids(reference_regions.size());
+    for (size_t r_id = 0; r_id < reference_regions.size(); ++r_id) {
+        grids.at(r_id) = build_point_grid(*reference_regions.at(r_id).points);
+    }
+    // Reference region of every comparing region, boundaries without a counterpart map to the cells.
+    std::vector<size_t> source_regions(comparing_regions.size(), 0);
+    for (size_t r_id = 1; r_id < comparing_regions.size(); ++r_id) {
+        const auto source_it = std::find_if(reference_regions.begin() + 1, reference_regions.end(),
+                                            [&](const Comparison_region& r) {
+                                                return r.name == comparing_regions.at(r_id).name;
+                                            });
+        if (source_it != reference_regions.end()) {
+            source_regions.at(r_id) = static_cast<size_t>(std::distance(reference_regions.begin(), source_it));
+        }
+    }
+    const auto row_count = calc_row_count(comparing_regions);
+    std::vector<size_t> row_regions(row_count);
+    for (size_t r_id = 0; r_id < comparing_regions.size(); ++r_id) {
+        const auto first = row_regions.begin() + comparing_regions.at(r_id).offset;
+        std::fill(first, first + comparing_regions.at(r_id).points->size(), r_id);
+    }
+    Mesh_correspondence correspondence;
+    correspondence.mode = mode;
+    correspondence.reference_fingerprint = calc_mesh_fingerprint(reference);
+    correspondence.comparing_fingerprint = calc_mesh_fingerprint(comparing);
+    correspondence.offsets.assign(row_count + 1, 0);
+    for (size_t i = 0; i < row_count; ++i) {
+        const auto source_size = reference_regions.at(source_regions.at(row_regions.at(i))).points->size();
+        correspondence.offsets.at(i + 1) = correspondence.offsets.at(i) + static_cast<int>(std::min(k, source_size));
+    }
+    correspondence.ids.resize(correspondence.offsets.back());
+    correspondence.weights.resize(correspondence.offsets.back());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < static_cast<int>(row_count); ++i) {
+        const auto& region = comparing_regions.at(row_regions.at(i));
+        const auto source_id = source_regions.at(row_regions.at(i));
+        const auto& source = reference_regions.at(source_id);
+        std::vector<std::pair<float, int>> nearest;
+        nearest.reserve(k + 1);
+        find_nearest_points(grids.at(source_id), *source.points, region.points->at(i - region.offset), k, nearest);
+        float weight_sum = 0.0f;
+        for (size_t n = 0; n < nearest.size(); ++n) {
+            // An exact hit takes the whole weight, otherwise the weights fall off with the squared distance.
+            const auto weight = nearest.front().first <= 0.0f ? (n == 0 ? 1.0f : 0.0f) : 1.0f / nearest.at(n).first;
+            correspondence.ids.at(correspondence.offsets.at(i) + n) = static_cast<int>(source.offset)
+                                                                       + nearest.at(n).second;
+            correspondence.weights.at(correspondence.offsets.at(i) + n) = weight;
+            weight_sum += weight;
+        }
+        for (int e = correspondence.offsets.at(i); e < correspondence.offsets.at(i + 1); ++e) {
+            correspondence.weights.at(e) /= weight_sum;
+        }
+    }
+    return correspondence;
+}
+
+void tostf::foam::save_mesh_correspondence(const std::filesystem::path& path,
+                                           const Mesh_correspondence& correspondence) {
+    Correspondence_file_header header{};
+    std::memcpy(header.magic, correspondence_magic, correspondence_magic_size);
+    header.version = correspondence_version;
+    header.mode = static_cast<uint32_t>(correspondence.mode);
+    header.reference_fingerprint = correspondence.reference_fingerprint;
+    header.comparing_fingerprint = correspondence.comparing_fingerprint;
+    header.row_count = correspondence.offsets.empty() ? 0 : correspondence.offsets.size() - 1;
+    header.entry_count = correspondence.ids.size();
+    std::ofstream out;
+    out.exceptions(std::ofstream::badbit);
+    out.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error{"Error saving file to " + path.string()};
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Correspondence_file_header));
+    out.write(reinterpret_cast<const char*>(correspondence.offsets.data()),
+              static_cast<std::streamsize>(correspondence.offsets.size() * sizeof(int)));
+    out.write(reinterpret_cast<const char*>(correspondence.ids.data()),
+              static_cast<std::streamsize>(correspondence.ids.size() * sizeof(int)));
+    out.write(reinterpret_cast<const char*>(correspondence.weights.data()),
+              static_cast<std::streamsize>(correspondence.weights.size() * sizeof(float)));
+    out.close();
+}
+
+tostf::foam::Mesh_correspondence tostf::foam::load_mesh_correspondence(const std::filesystem::path& path) {
+    const Mapped_file file(path);
+    Correspondence_file_header header{};
+    if (file.size() < sizeof(Correspondence_file_header)) {
+        throw std::runtime_error{"File at " + path.string() + " is no mesh correspondence."};
+    }
+    std::memcpy(&header, file.data(), sizeof(Correspondence_file_header));
+    if (std::memcmp(header.magic, correspondence_magic, correspondence_magic_size) != 0
+        || header.version != correspondence_version) {
+        throw std::runtime_error{"File at " + path.string() + " is no mesh correspondence of version "
+                                 + std::to_string(correspondence_version) + "."};
+    }
+    const auto offsets_size = (header.row_count + 1) * sizeof(int);
+    const auto entries_size = header.entry_count * (sizeof(int) + sizeof(float));
+    if (sizeof(Correspondence_file_header) + offsets_size + entries_size > file.size()) {
+        throw std::runtime_error{"File at " + path.string() + " is incomplete."};
+    }
+    Mesh_correspondence correspondence;
+    correspondence.mode = static_cast<correspondence_mode>(header.mode);
+    correspondence.reference_fingerprint = header.reference_fingerprint;
+    correspondence.comparing_fingerprint = header.comparing_fingerprint;
+    correspondence.offsets.resize(header.row_count + 1);
+    correspondence.ids.resize(header.entry_count);
+    correspondence.weights.resize(header.entry_count);
+    auto pos = file.data() + sizeof(Correspondence_file_header);
+    std::memcpy(correspondence.offsets.data(), pos, offsets_size);
+    pos += offsets_size;
+    std::memcpy(correspondence.ids.data(), pos, header.entry_count * sizeof(int));
+    pos += header.entry_count * sizeof(int);
+    std::memcpy(correspondence.weights.data(), pos, header.entry_count * sizeof(float));
+    return correspondence;
+}
+
+tostf::foam::Mesh_correspondence tostf::foam::load_or_build_mesh_correspondence(
+    const Poly_mesh& reference, const Poly_mesh& comparing, const correspondence_mode mode,
+    const std::filesystem::path& cache_path) {
+    if (exists(cache_path)) {
+        try {
+            auto correspondence = load_mesh_correspondence(cache_path);
+            if (correspondence.mode == mode
+                && correspondence.reference_fingerprint == calc_mesh_fingerprint(reference)
+                && correspondence.comparing_fingerprint == calc_mesh_fingerprint(comparing)) {
+                return correspondence;
+            }
+        }
+        catch (const std::runtime_error&) {
+            // Outdated or broken caches are rebuilt.
+        }
+    }
+    auto correspondence = build_mesh_correspondence(reference, comparing, mode);
+    save_mesh_correspondence(cache_path, correspondence);
+    return correspondence;
+}
+
+tostf::foam::Field_difference tostf::foam::calc_field_difference(const Mesh_correspondence& correspondence,
+                                                                 const Poly_mesh& reference,
+                                                                 const std::string& reference_step,
+                                                                 const Poly_mesh& comparing,
+                                                                 const std::string& comparing_step,
+                                                                 const std::string& field_name) {
+    const auto comparing_regions = gen_comparison_regions(comparing);
+    const auto row_count = calc_row_count(comparing_regions);
+    const auto reference_row_count = calc_row_count(gen_comparison_regions(reference));
+    const auto is_invalid_id = [reference_row_count](const int id) {
+        return id < 0 || static_cast<size_t>(id) >= reference_row_count;
+    };
+    if (correspondence.offsets.size() != row_count + 1
+        || std::any_of(correspondence.ids.begin(), correspondence.ids.end(), is_invalid_id)) {
+        throw std::runtime_error{"The mesh correspondence does not belong to the compared meshes."};
+    }
+    const auto is_vector = is_step_vector_field(comparing, comparing_step, field_name);
+    const auto components = is_vector ? 3 : 1;
+    const auto reference_rows = load_field_rows(reference, reference_step, field_name, is_vector);
+    const auto comparing_rows = load_field_rows(comparing, comparing_step, field_name, is_vector);
+    std::vector<float> difference(row_count);
+    std::vector<float> relative_difference(row_count);
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(row_count); ++i) {
+        glm::vec3 reference_value(0.0f);
+        glm::vec3 comparing_value(0.0f);
+        for (int e = correspondence.offsets.at(i); e < correspondence.offsets.at(i + 1); ++e) {
+            for (int c = 0; c < components; ++c) {
+                reference_value[c] += correspondence.weights.at(e)
+                                      * reference_rows.at(correspondence.ids.at(e) * components + c);
+            }
+        }
+        if (correspondence.offsets.at(i) == correspondence.offsets.at(i + 1)) {
+            reference_value = glm::vec3(std::numeric_limits<float>::quiet_NaN());
+        }
+        for (int c = 0; c < components; ++c) {
+            comparing_value[c] = comparing_rows.at(i * components + c);
+        }
+        const auto diff = is_vector ? length(comparing_value - reference_value) : comparing_value.x - reference_value.x;
+        const auto reference_mag = is_vector ? length(reference_value) : std::abs(reference_value.x);
+        difference.at(i) = diff;
+        relative_difference.at(i) = reference_mag > 0.0f || std::isnan(reference_mag) ? diff / reference_mag : 0.0f;
+    }
+    return {gen_region_field(comparing_regions, difference), gen_region_field(comparing_regions, relative_difference)};
+}
+
+std::string tostf::foam::gen_difference_field_name(const std::string& field_name, const bool relative) {
+    return field_name + (relative ? relative_difference_suffix : difference_suffix);
+}
+
+std::optional<std::pair<std::string, bool>> tostf::foam::parse_difference_field_name(const std::string& name) {
+    for (const auto relative : {true, false}) {
+        const auto& suffix = relative ? relative_difference_suffix : difference_suffix;
+        if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            return std::make_pair(name.substr(0, name.size() - suffix.size()), relative);
+        }
+    }
+    return std::nullopt;
+}
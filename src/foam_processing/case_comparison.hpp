@@ -0,0 +1,75 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "foam_loader.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tostf
+{
+    namespace foam
+    {
+        enum class correspondence_mode : int {
+            // Value of the nearest reference datapoint.
+            nearest = 0,
+            // Inverse distance weighted value of the eight nearest reference datapoints.
+            interpolated = 1
+        };
+
+        // Maps every datapoint of the comparing mesh, cells followed by boundary faces, to datapoints of the reference
+        // mesh in the same order. Cells map to cells, boundary faces to the faces of the reference boundary with the
+        // same name or to cells if the reference has no such boundary. The sources of datapoint i are ids from
+        // offsets[i] to offsets[i + 1] with weights summing up to 1.
+        struct Mesh_correspondence {
+            correspondence_mode mode = correspondence_mode::nearest;
+            uint64_t reference_fingerprint = 0;
+            uint64_t comparing_fingerprint = 0;
+            std::vector<int> offsets;
+            std::vector<int> ids;
+            std::vector<float> weights;
+        };
+
+        // Hash of the datapoints and boundaries of a mesh, used to validate cached correspondences.
+        uint64_t calc_mesh_fingerprint(const Poly_mesh& mesh);
+
+        // The nearest datapoints are found with a uniform grid over the reference datapoints, in parallel over the
+        // comparing datapoints.
+        Mesh_correspondence build_mesh_correspondence(const Poly_mesh& reference, const Poly_mesh& comparing,
+                                                      correspondence_mode mode);
+        void save_mesh_correspondence(const std::filesystem::path& path, const Mesh_correspondence& correspondence);
+        Mesh_correspondence load_mesh_correspondence(const std::filesystem::path& path);
+        // Loads the correspondence cached at cache_path if it was built for these meshes and mode, otherwise it is
+        // built and cached.
+        Mesh_correspondence load_or_build_mesh_correspondence(const Poly_mesh& reference, const Poly_mesh& comparing,
+                                                              correspondence_mode mode,
+                                                              const std::filesystem::path& cache_path);
+
+        struct Field_difference {
+            Field<float> difference;
+            Field<float> relative_difference;
+        };
+
+        // Differences of a field between a step of the comparing and of the reference case on the comparing mesh.
+        // Scalar fields give comparing - reference, vector fields the magnitude of the difference vector. The
+        // relative difference divides by the magnitude of the reference value and is 0 where it is 0. Regions
+        // without values in either case are left empty.
+        Field_difference calc_field_difference(const Mesh_correspondence& correspondence, const Poly_mesh& reference,
+                                               const std::string& reference_step, const Poly_mesh& comparing,
+                                               const std::string& comparing_step, const std::string& field_name);
+
+        // Virtual field names of the differences, e.g. p_diff and p_rel_diff.
+        std::string gen_difference_field_name(const std::string& field_name, bool relative);
+        // Field name and whether the difference is relative, if the name is one of a difference field.
+        std::optional<std::pair<std::string, bool>> parse_difference_field_name(const std::string& name);
+    }
+}
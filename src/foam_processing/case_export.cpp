@@ -0,0 +1,521 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "case_export.hpp"
+#include "case_comparison.hpp"
+#include "foam_loader.hpp"
+#include "derived_fields.hpp"
+#include "temporal_statistics.hpp"
+#include "volume_grid.hpp"
+#include "file/file_handling.hpp"
+#include "file/column_io.hpp"
+#include "file/npy_io.hpp"
+#include "glm/gtx/component_wise.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <execution>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+constexpr int export_blocks = 64;
+constexpr uint64_t export_chunk_rows = 1u << 16u;
+// The shortest representation of a float has at most 15 characters.
+constexpr size_t max_csv_value_length = 16;
+constexpr float missing_value = std::numeric_limits<float>::quiet_NaN();
+
+struct Export_region {
+    std::string name;
+    size_t offset;
+    size_t count;
+};
+
+std::vector<Export_region> gen_export_regions(const tostf::foam::Poly_mesh& mesh) {
+    std::vector<Export_region> regions{{"internal", 0, mesh.cell_centers.size()}};
+    for (const auto& b : mesh.boundaries) {
+        regions.push_back({b.name, regions.back().offset + regions.back().count, b.points.size()});
+    }
+    return regions;
+}
+
+// Rows are formatted in blocks in parallel and written in order.
+void export_csv(const std::filesystem::path& path, const std::vector<float>& values,
+                const std::vector<std::string>& columns) {
+    const auto column_count = columns.size();
+    const auto row_count = values.size() / column_count;
+    std::vector<std::string> blocks(export_blocks);
+#pragma omp parallel for
+    for (int b = 0; b < export_blocks; ++b) {
+        const auto first = row_count * b / export_blocks;
+        const auto last = row_count * (b + 1) / export_blocks;
+        auto& block = blocks.at(b);
+        block.resize((last - first) * column_count * max_csv_value_length);
+        auto pos = block.data();
+        for (auto row = first; row < last; ++row) {
+            for (size_t c = 0; c < column_count; ++c) {
+                pos = std::to_chars(pos, pos + max_csv_value_length, values.at(row * column_count + c)).ptr;
+                *pos++ = c + 1 < column_count ? ',' : '\n';
+            }
+        }
+        block.resize(static_cast<size_t>(pos - block.data()));
+    }
+    std::string header;
+    for (size_t c = 0; c < column_count; ++c) {
+        header += columns.at(c) + (c + 1 < column_count ? "," : "\n");
+    }
+    std::ofstream out;
+    out.exceptions(std::ofstream::badbit);
+    out.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error{"Error saving file to " + path.string()};
+    }
+    out << header;
+    for (const auto& block : blocks) {
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    out.close();
+}
+
+struct Export_table {
+    std::string field_name;
+    std::string step;
+    std::vector<size_t> shape;
+    std::vector<std::string> columns;
+};
+
+// Values are compared bitwise, so NaN entries of missing boundary values have to match as well.
+bool equals_exported_values(const float* data, const size_t size, const std::vector<float>& values) {
+    return size == values.size() && std::memcmp(data, values.data(), size * sizeof(float)) == 0;
+}
+
+void verify_npy(const std::filesystem::path& path, const std::vector<float>& values, const Export_table& table) {
+    const tostf::Npy_file file(path);
+    if (file.shape() != table.shape || !equals_exported_values(file.data(), file.size(), values)) {
+        throw std::runtime_error{"Reading " + path.string() + " back does not match the exported values."};
+    }
+}
+
+void verify_column(const std::filesystem::path& path, const std::vector<float>& values,
+                   const tostf::Column_info& info) {
+    const tostf::Column_file file(path);
+    const auto& read_info = file.info();
+    const auto chunk_count = (info.shape.front() + info.chunk_rows - 1) / info.chunk_rows;
+    if (read_info.field_name != info.field_name || read_info.step != info.step || read_info.shape != info.shape
+        || read_info.chunk_rows != info.chunk_rows || read_info.chunk_ranges.size() != chunk_count
+        || !equals_exported_values(file.data(), file.size(), values)) {
+        throw std::runtime_error{"Reading " + path.string() + " back does not match the exported values."};
+    }
+}
+
+// The shape of binary tables is kept in their header, CSV tables have one row per value of the first dimension.
+// With verify binary tables are read back through the memory mapped readers and compared to the values.
+void export_table(const std::filesystem::path& path_stem, const std::vector<float>& values, const Export_table& table,
+                  const tostf::foam::export_format format, const bool verify = false) {
+    if (format == tostf::foam::export_format::npy) {
+        const auto path = path_stem.string() + ".npy";
+        tostf::export_npy(path, values, table.shape);
+        if (verify) {
+            verify_npy(path, values, table);
+        }
+    }
+    else if (format == tostf::foam::export_format::columns) {
+        tostf::Column_info info;
+        info.field_name = table.field_name;
+        info.step = table.step;
+        info.shape.assign(table.shape.begin(), table.shape.end());
+        info.chunk_rows = export_chunk_rows;
+        const auto path = path_stem.string() + ".tcol";
+        tostf::export_column(path, info, values);
+        if (verify) {
+            verify_column(path, values, info);
+        }
+    }
+    else {
+        export_csv(path_stem.string() + ".csv", values, table.columns);
+    }
+}
+
+std::vector<float> gather_field_rows(const tostf::foam::Poly_mesh& mesh, const std::vector<Export_region>& regions,
+                                     const std::string& step, const std::string& field_name, const bool is_vector) {
+    const auto components = is_vector ? 3 : 1;
+    std::vector<float> rows((regions.back().offset + regions.back().count) * components, missing_value);
+    const auto copy_region = [&rows, components](const auto& data, const Export_region& region) {
+        if (data.size() != region.count) {
+            return;
+        }
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(region.count); ++i) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(data.at(0))>, float>) {
+                rows.at(region.offset + i) = data.at(i);
+            }
+            else {
+                for (int c = 0; c < components; ++c) {
+                    rows.at((region.offset + i) * components + c) = data.at(i)[c];
+                }
+            }
+        }
+    };
+    if (is_vector) {
+        const auto field = tostf::foam::load_step_vector_field(mesh, step, field_name);
+        copy_region(field.internal_data, regions.at(0));
+        for (size_t b_id = 0; b_id < field.boundaries_data.size(); ++b_id) {
+            copy_region(field.boundaries_data.at(b_id), regions.at(b_id + 1));
+        }
+    }
+    else {
+        const auto field = tostf::foam::load_step_scalar_field(mesh, step, field_name);
+        copy_region(field.internal_data, regions.at(0));
+        for (size_t b_id = 0; b_id < field.boundaries_data.size(); ++b_id) {
+            copy_region(field.boundaries_data.at(b_id), regions.at(b_id + 1));
+        }
+    }
+    return rows;
+}
+
+// Rows of a field that does not belong to a step, e.g. temporal statistics or differences.
+std::vector<float> gather_scalar_rows(const std::vector<Export_region>& regions,
+                                      const tostf::foam::Field<float>& field) {
+    std::vector<float> rows(regions.back().offset + regions.back().count, missing_value);
+    // Regions without data keep missing values, data of another size belongs to a different mesh.
+    const auto copy_region = [&rows](const std::vector<float>& data, const Export_region& region) {
+        if (data.empty()) {
+            return;
+        }
+        if (data.size() != region.count) {
+            throw std::runtime_error{"Region " + region.name + " has " + std::to_string(region.count)
+                                     + " rows, but the field holds " + std::to_string(data.size()) + " values."};
+        }
+        std::copy(data.begin(), data.end(), rows.begin() + region.offset);
+    };
+    copy_region(field.internal_data, regions.at(0));
+    for (size_t b_id = 0; b_id < field.boundaries_data.size(); ++b_id) {
+        copy_region(field.boundaries_data.at(b_id), regions.at(b_id + 1));
+    }
+    return rows;
+}
+
+struct Region_stats {
+    size_t count = 0;
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    double sum = 0.0;
+    double sum_sq = 0.0;
+};
+
+// The values are reduced per fixed row range and the partial sums are merged in block order.
+Region_stats calc_region_stats(const std::vector<float>& rows, const int components, const Export_region& region) {
+    std::vector<Region_stats> block_stats(export_blocks);
+#pragma omp parallel for
+    for (int b = 0; b < export_blocks; ++b) {
+        auto& s = block_stats.at(b);
+        const auto first = region.offset + region.count * b / export_blocks;
+        const auto last = region.offset + region.count * (b + 1) / export_blocks;
+        for (auto row = first; row < last; ++row) {
+            float v = rows.at(row * components);
+            if (components > 1) {
+                v = length(glm::vec3(rows.at(row * components), rows.at(row * components + 1),
+                                     rows.at(row * components + 2)));
+            }
+            if (std::isfinite(v)) {
+                ++s.count;
+                s.min = std::min(s.min, v);
+                s.max = std::max(s.max, v);
+                s.sum += v;
+                s.sum_sq += static_cast<double>(v) * v;
+            }
+        }
+    }
+    Region_stats stats;
+    for (const auto& s : block_stats) {
+        stats.count += s.count;
+        stats.min = std::min(stats.min, s.min);
+        stats.max = std::max(stats.max, s.max);
+        stats.sum += s.sum;
+        stats.sum_sq += s.sum_sq;
+    }
+    return stats;
+}
+
+std::string gen_stats_line(const std::string& step, const std::string& field_name, const std::string& region_name,
+                           const Region_stats& stats) {
+    std::string line = step + "," + field_name + "," + region_name + "," + std::to_string(stats.count);
+    if (stats.count == 0) {
+        return line + ",nan,nan,nan,nan\n";
+    }
+    const auto mean = stats.sum / stats.count;
+    const auto variance = std::max(0.0, stats.sum_sq / stats.count - mean * mean);
+    std::array<char, 4 * 32> buffer{};
+    auto pos = buffer.data();
+    for (const auto v : {static_cast<double>(stats.min), static_cast<double>(stats.max), mean, std::sqrt(variance)}) {
+        *pos++ = ',';
+        pos = std::to_chars(pos, buffer.data() + buffer.size(), v).ptr;
+    }
+    return line + std::string(buffer.data(), pos) + "\n";
+}
+
+// Cells are assigned to every voxel their bounding cube touches, the same cells the visualizer splats a cell into.
+struct Voxel_map {
+    glm::vec4 bb_min{};
+    float voxel_size = 0.0f;
+    glm::ivec3 voxel_count{};
+    std::vector<size_t> offsets;
+    std::vector<int> cell_ids;
+};
+
+Voxel_map build_voxel_map(const tostf::foam::Poly_mesh& mesh, const int resolution) {
+    Voxel_map map;
+    map.voxel_size = glm::compMax(glm::vec3(mesh.mesh_bb.max - mesh.mesh_bb.min)) / static_cast<float>(resolution);
+    const auto padding = glm::vec4(glm::vec3(map.voxel_size * 1.5f), 0.0f);
+    const tostf::foam::Volume_grid grid({mesh.mesh_bb.min - padding, mesh.mesh_bb.max + padding}, map.voxel_size);
+    map.bb_min = grid.bb.min;
+    map.voxel_count = grid.cell_count;
+    const auto cell_count = static_cast<int>(mesh.cell_centers.size());
+    std::vector<size_t> pair_offsets(cell_count + 1, 0);
+#pragma omp parallel for
+    for (int c = 0; c < cell_count; ++c) {
+        const auto r = glm::vec4(glm::vec3(mesh.cell_radii.at(c)), 0.0f);
+        const auto extent = grid.calc_bound_cell_index_3d(mesh.cell_centers.at(c) + r)
+                            - grid.calc_bound_cell_index_3d(mesh.cell_centers.at(c) - r) + 1;
+        pair_offsets.at(c + 1) = static_cast<size_t>(extent.x) * extent.y * extent.z;
+    }
+    std::inclusive_scan(pair_offsets.begin(), pair_offsets.end(), pair_offsets.begin());
+    std::vector<std::pair<int, int>> pairs(pair_offsets.back());
+#pragma omp parallel for
+    for (int c = 0; c < cell_count; ++c) {
+        const auto r = glm::vec4(glm::vec3(mesh.cell_radii.at(c)), 0.0f);
+        const auto min_id = grid.calc_bound_cell_index_3d(mesh.cell_centers.at(c) - r);
+        const auto max_id = grid.calc_bound_cell_index_3d(mesh.cell_centers.at(c) + r);
+        auto pair_id = pair_offsets.at(c);
+        for (auto k = min_id.z; k <= max_id.z; ++k) {
+            for (auto j = min_id.y; j <= max_id.y; ++j) {
+                for (auto i = min_id.x; i <= max_id.x; ++i) {
+                    pairs.at(pair_id++) = {grid.convert_3d_index_to_1d({i, j, k}), c};
+                }
+            }
+        }
+    }
+    std::sort(std::execution::par, pairs.begin(), pairs.end());
+    map.offsets.resize(static_cast<size_t>(grid.total_cell_count) + 1, 0);
+    map.cell_ids.resize(pairs.size());
+    for (size_t p = 0; p < pairs.size(); ++p) {
+        ++map.offsets.at(pairs.at(p).first + 1);
+        map.cell_ids.at(p) = pairs.at(p).second;
+    }
+    std::inclusive_scan(map.offsets.begin(), map.offsets.end(), map.offsets.begin());
+    return map;
+}
+
+std::vector<float> average_into_voxels(const Voxel_map& map, const std::vector<float>& rows, const int components) {
+    const auto voxel_count = static_cast<int>(map.offsets.size() - 1);
+    std::vector<float> voxels(static_cast<size_t>(voxel_count) * components, missing_value);
+#pragma omp parallel for
+    for (int v = 0; v < voxel_count; ++v) {
+        for (int c = 0; c < components; ++c) {
+            double sum = 0.0;
+            int count = 0;
+            for (auto i = map.offsets.at(v); i < map.offsets.at(v + 1); ++i) {
+                const auto value = rows.at(static_cast<size_t>(map.cell_ids.at(i)) * components + c);
+                if (std::isfinite(value)) {
+                    sum += value;
+                    ++count;
+                }
+            }
+            if (count > 0) {
+                voxels.at(static_cast<size_t>(v) * components + c) = static_cast<float>(sum / count);
+            }
+        }
+    }
+    return voxels;
+}
+
+Export_table gen_field_table(const std::string& field_name, const std::string& step, std::vector<size_t> shape,
+                             const bool is_vector) {
+    if (is_vector) {
+        shape.push_back(3);
+        return {field_name, step, std::move(shape), {"x", "y", "z"}};
+    }
+    return {field_name, step, std::move(shape), {"value"}};
+}
+
+void export_regions(const std::vector<Export_region>& regions, const std::filesystem::path& export_path) {
+    std::string regions_str("name,offset,count\n");
+    for (const auto& r : regions) {
+        regions_str += r.name + "," + std::to_string(r.offset) + "," + std::to_string(r.count) + "\n";
+    }
+    tostf::save_str_to_file(export_path / "regions.csv", regions_str);
+}
+
+void export_datapoint_table(const tostf::foam::Poly_mesh& mesh, const std::filesystem::path& export_path,
+                            const tostf::foam::export_format format, const bool verify = false) {
+    const auto points = mesh.gen_datapoints();
+    std::vector<float> datapoints(points.size() * 3);
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            datapoints.at(i * 3 + c) = points.at(i)[c];
+        }
+    }
+    export_table(export_path / "datapoints", datapoints, {"datapoints", "", {points.size(), 3}, {"x", "y", "z"}},
+                 format, verify);
+}
+
+void tostf::foam::export_datapoints(const Poly_mesh& mesh, const std::filesystem::path& export_path,
+                                    const export_format format) {
+    std::filesystem::create_directories(export_path);
+    export_regions(gen_export_regions(mesh), export_path);
+    export_datapoint_table(mesh, export_path, format);
+}
+
+void tostf::foam::export_step_fields(const Poly_mesh& mesh, const std::string& step,
+                                     const std::vector<std::string>& field_names,
+                                     const std::filesystem::path& export_path, const export_format format) {
+    std::filesystem::create_directories(export_path);
+    const auto regions = gen_export_regions(mesh);
+    const auto row_count = regions.back().offset + regions.back().count;
+    for (const auto& field_name : field_names) {
+        const auto is_vector = is_step_vector_field(mesh, step, field_name);
+        const auto rows = gather_field_rows(mesh, regions, step, field_name, is_vector);
+        export_table(export_path / (field_name + "_" + step), rows,
+                     gen_field_table(field_name, step, {row_count}, is_vector), format);
+    }
+}
+
+void tostf::foam::export_case(const std::filesystem::path& case_path, const std::filesystem::path& export_path,
+                              const Case_export_settings& settings) {
+    Poly_mesh mesh;
+    mesh.load(case_path);
+    const auto steps = find_time_steps(case_path, settings.skip_first);
+    if (steps.empty()) {
+        throw std::runtime_error{"No time steps found in " + case_path.string()};
+    }
+    auto field_names = settings.fields;
+    if (field_names.empty()) {
+        for (auto& f : std::filesystem::directory_iterator(case_path / steps.at(0))) {
+            if (f.is_regular_file()) {
+                field_names.push_back(f.path().filename().string());
+            }
+        }
+        std::sort(field_names.begin(), field_names.end());
+    }
+    std::vector<bool> vector_fields;
+    for (const auto& f : field_names) {
+        if (!has_step_field(mesh, steps.at(0), f)) {
+            throw std::runtime_error{"Field " + f + " does not exist in " + (case_path / steps.at(0)).string()};
+        }
+        vector_fields.push_back(is_step_vector_field(mesh, steps.at(0), f));
+    }
+    std::filesystem::create_directories(export_path);
+    const auto regions = gen_export_regions(mesh);
+    const auto row_count = regions.back().offset + regions.back().count;
+    export_regions(regions, export_path);
+    if (settings.datapoints) {
+        export_datapoint_table(mesh, export_path, settings.format, settings.verify);
+    }
+    Voxel_map voxel_map;
+    if (settings.volume_resolution > 0) {
+        voxel_map = build_voxel_map(mesh, settings.volume_resolution);
+        std::string grid_str("min_x,min_y,min_z,voxel_size,count_x,count_y,count_z\n");
+        grid_str += std::to_string(voxel_map.bb_min.x) + "," + std::to_string(voxel_map.bb_min.y) + ","
+            + std::to_string(voxel_map.bb_min.z) + "," + std::to_string(voxel_map.voxel_size) + ","
+            + std::to_string(voxel_map.voxel_count.x) + "," + std::to_string(voxel_map.voxel_count.y) + ","
+            + std::to_string(voxel_map.voxel_count.z) + "\n";
+        save_str_to_file(export_path / "volume_grid.csv", grid_str);
+    }
+    Poly_mesh reference_mesh;
+    Mesh_correspondence correspondence;
+    std::vector<std::string> reference_steps;
+    if (!settings.reference_case.empty()) {
+        reference_mesh.load(settings.reference_case);
+        // The cache is kept with the exported files, so exporting never writes into the input case.
+        correspondence = load_or_build_mesh_correspondence(reference_mesh, mesh, settings.correspondence,
+                                                           export_path / "correspondence.tmap");
+        reference_steps = find_time_steps(settings.reference_case, settings.skip_first);
+    }
+    std::vector<std::string> step_stats(steps.size());
+    std::exception_ptr export_error = nullptr;
+    // Every thread holds the fields of one step, which bounds the memory to the thread count.
+#pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < static_cast<int>(steps.size()); ++s) {
+        try {
+            const auto& step = steps.at(s);
+            for (size_t f_id = 0; f_id < field_names.size(); ++f_id) {
+                const auto& field_name = field_names.at(f_id);
+                const auto is_vector = vector_fields.at(f_id);
+                const auto components = is_vector ? 3 : 1;
+                const auto rows = gather_field_rows(mesh, regions, step, field_name, is_vector);
+                export_table(export_path / (field_name + "_" + step), rows,
+                             gen_field_table(field_name, step, {row_count}, is_vector),
+                             settings.format, settings.verify);
+                if (settings.volume_resolution > 0) {
+                    // C order with x varying fastest, as the voxels are numbered by the volume grid.
+                    const std::vector<size_t> volume_shape{
+                        static_cast<size_t>(voxel_map.voxel_count.z), static_cast<size_t>(voxel_map.voxel_count.y),
+                        static_cast<size_t>(voxel_map.voxel_count.x)
+                    };
+                    export_table(export_path / (field_name + "_" + step + "_volume"),
+                                 average_into_voxels(voxel_map, rows, components),
+                                 gen_field_table(field_name, step, volume_shape, is_vector),
+                                 settings.format, settings.verify);
+                }
+                if (settings.statistics) {
+                    for (const auto& region : regions) {
+                        step_stats.at(s) += gen_stats_line(step, field_name, region.name,
+                                                           calc_region_stats(rows, components, region));
+                    }
+                }
+                if (std::find(reference_steps.begin(), reference_steps.end(), step) == reference_steps.end()) {
+                    continue;
+                }
+                const auto difference = calc_field_difference(correspondence, reference_mesh, step, mesh, step,
+                                                              field_name);
+                for (const auto relative : {false, true}) {
+                    const auto difference_name = gen_difference_field_name(field_name, relative);
+                    const auto difference_rows = gather_scalar_rows(
+                        regions, relative ? difference.relative_difference : difference.difference);
+                    export_table(export_path / (difference_name + "_" + step), difference_rows,
+                                 gen_field_table(difference_name, step, {row_count}, false),
+                                 settings.format, settings.verify);
+                    if (settings.statistics) {
+                        for (const auto& region : regions) {
+                            step_stats.at(s) += gen_stats_line(step, difference_name, region.name,
+                                                               calc_region_stats(difference_rows, 1, region));
+                        }
+                    }
+                }
+            }
+        }
+        catch (...) {
+#pragma omp critical
+            if (!export_error) {
+                export_error = std::current_exception();
+            }
+        }
+    }
+    if (export_error) {
+        std::rethrow_exception(export_error);
+    }
+    if (settings.statistics) {
+        std::string stats_str("step,field,region,count,min,max,mean,sd\n");
+        for (const auto& s : step_stats) {
+            stats_str += s;
+        }
+        save_str_to_file(export_path / "statistics.csv", stats_str);
+    }
+    for (const auto& field_name : settings.temporal_fields) {
+        for (const auto& t : calc_temporal_statistics(mesh, steps, field_name)) {
+            export_table(export_path / t.first, gather_scalar_rows(regions, t.second),
+                         gen_field_table(t.first, "", {row_count}, false), settings.format, settings.verify);
+        }
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "case_comparison.hpp"
+#include "foam_loader.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace tostf
+{
+    namespace foam
+    {
+        enum class export_format : int {
+            // float32 .npy files for NumPy.
+            npy = 0,
+            // float32 column files with field name, step and chunk ranges in the header, see column_io.hpp.
+            columns = 1,
+            csv = 2
+        };
+
+        struct Case_export_settings {
+            // Fields of the first time step are exported if no field is selected. Derived fields like Q are
+            // computed from U if the case does not hold them, see derived_fields.hpp.
+            std::vector<std::string> fields;
+            export_format format = export_format::npy;
+            bool skip_first = false;
+            bool datapoints = true;
+            bool statistics = true;
+            // Voxels along the longest side of the mesh, 0 disables the volume export.
+            int volume_resolution = 0;
+            // Fields reduced over all steps, see temporal_statistics.hpp.
+            std::vector<std::string> temporal_fields;
+            // Case whose steps of the same name the exported fields are differenced to, see case_comparison.hpp.
+            std::filesystem::path reference_case;
+            correspondence_mode correspondence = correspondence_mode::nearest;
+            // Reads every binary table back through Npy_file or Column_file and compares it to the exported values.
+            bool verify = false;
+        };
+
+        // Exports the selected fields of every time step to export_path, the steps are processed in parallel.
+        // Per step and field <field>_<step> holds one row per cell followed by one row per boundary face, in the
+        // order of datapoints and regions.csv. Vector fields have three columns, missing boundary values are NaN.
+        // Binary output is written as float32 .npy or .tcol column files, CSV output as one text row per value.
+        // With a volume resolution the cell values are averaged into <field>_<step>_volume on the grid described
+        // in volume_grid.csv, like the volume rendering of the visualizer. Empty voxels are NaN.
+        // statistics.csv holds count, min, max, mean and standard deviation per step, field and region, vector
+        // fields are evaluated by magnitude. Temporal statistics are written per statistic, e.g. TAWSS and OSI.
+        // With a reference case <field>_diff_<step> and <field>_rel_diff_<step> hold the differences of the steps
+        // the reference case holds too, the mesh correspondence is cached as correspondence.tmap in export_path.
+        void export_case(const std::filesystem::path& case_path, const std::filesystem::path& export_path,
+                         const Case_export_settings& settings);
+
+        // Writes the cell centers and boundary face centers as datapoints and their ranges to regions.csv.
+        void export_datapoints(const Poly_mesh& mesh, const std::filesystem::path& export_path,
+                               export_format format);
+        // Writes the fields of one step as <field>_<step> in the row order of the datapoints.
+        void export_step_fields(const Poly_mesh& mesh, const std::string& step,
+                                const std::vector<std::string>& field_names,
+                                const std::filesystem::path& export_path, export_format format);
+    }
+}
@@ -0,0 +1,238 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "derived_fields.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+float derived_magnitude(const float v) {
+    return v;
+}
+
+float derived_magnitude(const glm::vec4& v) {
+    return v.w;
+}
+
+// Boundary faces take the value of their owner cell.
+template <typename T>
+tostf::foam::Field<T> gen_cell_field(const tostf::foam::Poly_mesh& mesh, std::vector<T> cell_values) {
+    tostf::foam::Field<T> field;
+    field.internal_data = std::move(cell_values);
+    field.boundaries_data.resize(mesh.boundaries.size());
+    for (size_t b_id = 0; b_id < mesh.boundaries.size(); ++b_id) {
+        const auto& cell_refs = mesh.boundaries.at(b_id).cell_refs;
+        auto& boundary_data = field.boundaries_data.at(b_id);
+        boundary_data.resize(cell_refs.size());
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(cell_refs.size()); ++i) {
+            boundary_data.at(i) = field.internal_data.at(cell_refs.at(i));
+        }
+    }
+    size_t count = 0;
+    double sum = 0.0;
+    const auto update_range = [&field, &count, &sum](const std::vector<T>& values) {
+        for (const auto& v : values) {
+            const auto mag = derived_magnitude(v);
+            field.min = std::min(field.min, mag);
+            field.max = std::max(field.max, mag);
+            sum += mag;
+        }
+        count += values.size();
+    };
+    update_range(field.internal_data);
+    for (const auto& b : field.boundaries_data) {
+        update_range(b);
+    }
+    if (count > 0) {
+        field.avg = static_cast<float>(sum / static_cast<double>(count));
+    }
+    return field;
+}
+
+// Closed form eigenvalues of a symmetric 3x3 matrix (Smith 1961), the second one is returned.
+double calc_middle_eigenvalue(const glm::dmat3& m) {
+    const auto q = (m[0][0] + m[1][1] + m[2][2]) / 3.0;
+    const glm::dvec3 diag(m[0][0] - q, m[1][1] - q, m[2][2] - q);
+    const glm::dvec3 off_diag(m[1][0], m[2][0], m[2][1]);
+    const auto p = glm::sqrt((dot(diag, diag) + 2.0 * dot(off_diag, off_diag)) / 6.0);
+    if (p <= 0.0) {
+        return q;
+    }
+    const auto b = (m - glm::dmat3(q)) / p;
+    const auto r = glm::clamp(glm::determinant(b) / 2.0, -1.0, 1.0);
+    const auto phi = glm::acos(r) / 3.0;
+    const auto largest = q + 2.0 * p * glm::cos(phi);
+    const auto smallest = q + 2.0 * p * glm::cos(phi + 2.0 * glm::pi<double>() / 3.0);
+    return 3.0 * q - largest - smallest;
+}
+
+const std::vector<std::string>& tostf::foam::get_derived_field_names() {
+    static const std::vector<std::string> names{"Lambda2", "Q", "vorticity"};
+    return names;
+}
+
+bool tostf::foam::is_derived_field(const std::string& field_name) {
+    const auto& names = get_derived_field_names();
+    return std::find(names.begin(), names.end(), field_name) != names.end();
+}
+
+bool tostf::foam::is_derived_vector_field(const std::string& field_name) {
+    return field_name == "vorticity";
+}
+
+std::vector<glm::mat3> tostf::foam::calc_gradient(const Poly_mesh& mesh, const Field<glm::vec4>& field) {
+    const auto& faces = mesh.faces;
+    if (field.internal_data.size() != mesh.cell_centers.size()) {
+        throw std::runtime_error{"The gradient needs one value per cell, got "
+                                 + std::to_string(field.internal_data.size()) + " for "
+                                 + std::to_string(mesh.cell_centers.size()) + " cells."};
+    }
+    std::vector<glm::vec3> face_values(faces.areas.size());
+#pragma omp parallel for
+    for (int face_id = 0; face_id < static_cast<int>(faces.neighbor.size()); ++face_id) {
+        const auto w = faces.owner_weights.at(face_id);
+        face_values.at(face_id) = glm::vec3(w * field.internal_data.at(faces.owner.at(face_id))
+                                            + (1.0f - w) * field.internal_data.at(faces.neighbor.at(face_id)));
+    }
+    for (size_t b_id = 0; b_id < mesh.boundaries.size(); ++b_id) {
+        const auto& boundary = mesh.boundaries.at(b_id);
+        const auto has_values = b_id < field.boundaries_data.size() && !field.boundaries_data.at(b_id).empty();
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(boundary.cell_refs.size()); ++i) {
+            const auto& value = has_values ? field.boundaries_data.at(b_id).at(i)
+                                           : field.internal_data.at(boundary.cell_refs.at(i));
+            face_values.at(boundary.start_face + i) = glm::vec3(value);
+        }
+    }
+    std::vector<glm::mat3> gradient(mesh.cell_centers.size(), glm::mat3(0.0f));
+#pragma omp parallel for
+    for (int c_id = 0; c_id < static_cast<int>(gradient.size()); ++c_id) {
+        const auto volume = mesh.cell_volumes.at(c_id);
+        if (volume <= 0.0f) {
+            continue;
+        }
+        glm::mat3 sum(0.0f);
+        for (int i = faces.cell_offsets.at(c_id); i < faces.cell_offsets.at(c_id + 1); ++i) {
+            const auto face_id = faces.cell_faces.at(i);
+            const auto flux = outerProduct(face_values.at(face_id), glm::vec3(faces.areas.at(face_id)));
+            if (faces.owner.at(face_id) == c_id) {
+                sum += flux;
+            }
+            else {
+                sum -= flux;
+            }
+        }
+        gradient.at(c_id) = sum / volume;
+    }
+    return gradient;
+}
+
+tostf::foam::Field<glm::vec4> tostf::foam::calc_vorticity(const Poly_mesh& mesh,
+                                                          const std::vector<glm::mat3>& velocity_gradient) {
+    std::vector<glm::vec4> vorticity(velocity_gradient.size());
+#pragma omp parallel for
+    for (int c_id = 0; c_id < static_cast<int>(vorticity.size()); ++c_id) {
+        const auto& g = velocity_gradient.at(c_id);
+        const glm::vec3 curl(g[1][2] - g[2][1], g[2][0] - g[0][2], g[0][1] - g[1][0]);
+        vorticity.at(c_id) = glm::vec4(curl, length(curl));
+    }
+    return gen_cell_field(mesh, std::move(vorticity));
+}
+
+tostf::foam::Field<float> tostf::foam::calc_q_criterion(const Poly_mesh& mesh,
+                                                        const std::vector<glm::mat3>& velocity_gradient) {
+    std::vector<float> q(velocity_gradient.size());
+#pragma omp parallel for
+    for (int c_id = 0; c_id < static_cast<int>(q.size()); ++c_id) {
+        const auto& g = velocity_gradient.at(c_id);
+        const auto g_sq = g * g;
+        const auto trace = g[0][0] + g[1][1] + g[2][2];
+        q.at(c_id) = 0.5f * (trace * trace - (g_sq[0][0] + g_sq[1][1] + g_sq[2][2]));
+    }
+    return gen_cell_field(mesh, std::move(q));
+}
+
+tostf::foam::Field<float> tostf::foam::calc_lambda2(const Poly_mesh& mesh,
+                                                    const std::vector<glm::mat3>& velocity_gradient) {
+    std::vector<float> lambda2(velocity_gradient.size());
+#pragma omp parallel for
+    for (int c_id = 0; c_id < static_cast<int>(lambda2.size()); ++c_id) {
+        const glm::dmat3 g(velocity_gradient.at(c_id));
+        const auto strain = 0.5 * (g + transpose(g));
+        const auto spin = 0.5 * (g - transpose(g));
+        lambda2.at(c_id) = static_cast<float>(-calc_middle_eigenvalue(strain * strain + spin * spin));
+    }
+    return gen_cell_field(mesh, std::move(lambda2));
+}
+
+tostf::foam::Field<float> tostf::foam::load_derived_scalar_field(const Poly_mesh& mesh, const std::string& step_path,
+                                                                 const std::string& field_name) {
+    if (is_derived_vector_field(field_name)) {
+        const auto field = load_derived_vector_field(mesh, step_path, field_name);
+        Field<float> result;
+        result.min = field.min;
+        result.max = field.max;
+        result.avg = field.avg;
+        const auto to_magnitude = [](const std::vector<glm::vec4>& values) {
+            std::vector<float> magnitudes(values.size());
+            std::transform(values.begin(), values.end(), magnitudes.begin(), [](const glm::vec4& v) { return v.w; });
+            return magnitudes;
+        };
+        result.internal_data = to_magnitude(field.internal_data);
+        for (const auto& b : field.boundaries_data) {
+            result.boundaries_data.push_back(to_magnitude(b));
+        }
+        return result;
+    }
+    const auto gradient = calc_gradient(mesh, mesh.load_vector_field_from_file(step_path, "U"));
+    if (field_name == "Q") {
+        return calc_q_criterion(mesh, gradient);
+    }
+    if (field_name == "Lambda2") {
+        return calc_lambda2(mesh, gradient);
+    }
+    throw std::runtime_error{"No derived scalar field " + field_name};
+}
+
+tostf::foam::Field<glm::vec4> tostf::foam::load_derived_vector_field(const Poly_mesh& mesh,
+                                                                     const std::string& step_path,
+                                                                     const std::string& field_name) {
+    if (field_name != "vorticity") {
+        throw std::runtime_error{"No derived vector field " + field_name};
+    }
+    return calc_vorticity(mesh, calc_gradient(mesh, mesh.load_vector_field_from_file(step_path, "U")));
+}
+
+bool tostf::foam::has_step_field(const Poly_mesh& mesh, const std::string& step_path, const std::string& field_name) {
+    return exists(mesh.case_path / step_path / field_name)
+           || (is_derived_field(field_name) && exists(mesh.case_path / step_path / "U"));
+}
+
+bool tostf::foam::is_step_vector_field(const Poly_mesh& mesh, const std::string& step_path,
+                                       const std::string& field_name) {
+    const auto field_path = mesh.case_path / step_path / field_name;
+    if (!exists(field_path) && is_derived_field(field_name)) {
+        return is_derived_vector_field(field_name);
+    }
+    return is_vector_field_file(field_path);
+}
+
+tostf::foam::Field<float> tostf::foam::load_step_scalar_field(const Poly_mesh& mesh, const std::string& step_path,
+                                                              const std::string& field_name) {
+    if (!exists(mesh.case_path / step_path / field_name) && is_derived_field(field_name)) {
+        return load_derived_scalar_field(mesh, step_path, field_name);
+    }
+    return mesh.load_scalar_field_from_file(step_path, field_name);
+}
+
+tostf::foam::Field<glm::vec4> tostf::foam::load_step_vector_field(const Poly_mesh& mesh, const std::string& step_path,
+                                                                  const std::string& field_name) {
+    if (!exists(mesh.case_path / step_path / field_name) && is_derived_field(field_name)) {
+        return load_derived_vector_field(mesh, step_path, field_name);
+    }
+    return mesh.load_vector_field_from_file(step_path, field_name);
+}
@@ -0,0 +1,50 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "foam_loader.hpp"
+#include <string>
+#include <vector>
+
+namespace tostf
+{
+    namespace foam
+    {
+        // Fields computed from the velocity U of a step instead of being read from the case.
+        const std::vector<std::string>& get_derived_field_names();
+        bool is_derived_field(const std::string& field_name);
+        bool is_derived_vector_field(const std::string& field_name);
+
+        // Green-Gauss gradient per cell, column j holds the derivative along axis j, i.e. grad[j][i] = du_i/dx_j.
+        // Face values are interpolated linearly between owner and neighbor. Boundary faces use the boundary values
+        // of the field and fall back to the owner cell value, i.e. zero gradient, if a boundary has none.
+        std::vector<glm::mat3> calc_gradient(const Poly_mesh& mesh, const Field<glm::vec4>& field);
+
+        // Boundary faces take the value of their owner cell, w of the vorticity holds its magnitude.
+        Field<glm::vec4> calc_vorticity(const Poly_mesh& mesh, const std::vector<glm::mat3>& velocity_gradient);
+        // Q = 0.5 * (tr(grad U)^2 - tr(grad U & grad U)), like the Q function object of OpenFOAM.
+        Field<float> calc_q_criterion(const Poly_mesh& mesh, const std::vector<glm::mat3>& velocity_gradient);
+        // Negated second eigenvalue of S^2 + W^2, like the Lambda2 function object of OpenFOAM, so vortex cores are
+        // positive.
+        Field<float> calc_lambda2(const Poly_mesh& mesh, const std::vector<glm::mat3>& velocity_gradient);
+
+        // Loads U of the step and computes the derived field, vector fields are returned by magnitude.
+        Field<float> load_derived_scalar_field(const Poly_mesh& mesh, const std::string& step_path,
+                                               const std::string& field_name);
+        Field<glm::vec4> load_derived_vector_field(const Poly_mesh& mesh, const std::string& step_path,
+                                                   const std::string& field_name);
+
+        // Fields of a step, derived fields are computed if the step does not hold them, e.g. from a postProcess run.
+        bool has_step_field(const Poly_mesh& mesh, const std::string& step_path, const std::string& field_name);
+        bool is_step_vector_field(const Poly_mesh& mesh, const std::string& step_path, const std::string& field_name);
+        Field<float> load_step_scalar_field(const Poly_mesh& mesh, const std::string& step_path,
+                                            const std::string& field_name);
+        Field<glm::vec4> load_step_vector_field(const Poly_mesh& mesh, const std::string& step_path,
+                                                const std::string& field_name);
+    }
+}
@@ -11,7 +11,9 @@
 #include <utility>
 #include "preprocessing/inlet_detection.hpp"
 #include "utility/vector.hpp"
-#include <sstream>
+#include "utility/str_conversion.hpp"
+#include <algorithm>
+#include <numeric>
 
 int digits_to_int(const std::vector<int>& digits) {
     auto exponent = pow(10, static_cast<int>(digits.size()) - 1);
@@ -188,6 +190,82 @@ std::vector<tostf::foam::Foam_boundary> tostf::foam::load_boundaries_from_file(c
 }
 
 
+// Area vectors and centroids of the faces are summed over a triangle fan around the mean of the face points.
+void load_face_geometry(tostf::foam::Poly_mesh& mesh, const std::vector<glm::vec4>& points,
+                        const tostf::foam::Foam_face_handler& foam_faces, const tostf::foam::Foam_owner& foam_owner) {
+    auto& faces = mesh.faces;
+    const auto& cell_centers = mesh.cell_centers;
+    const auto face_count = static_cast<int>(foam_faces.face_it_refs.size());
+    faces.areas.resize(face_count);
+    faces.owner = foam_owner.owner;
+    faces.neighbor = foam_owner.neighbor;
+    std::vector<glm::vec4> face_centers(face_count);
+#pragma omp parallel for
+    for (int face_id = 0; face_id < face_count; ++face_id) {
+        const auto& face_its = foam_faces.face_it_refs.at(face_id);
+        glm::vec3 point_mean(0.0f);
+        for (auto face_it = face_its.begin; face_it < face_its.end; ++face_it) {
+            point_mean += glm::vec3(points.at(*face_it));
+        }
+        point_mean /= static_cast<float>(face_its.end - face_its.begin);
+        glm::vec3 area(0.0f);
+        glm::vec3 centroid(0.0f);
+        float area_sum = 0.0f;
+        for (auto face_it = face_its.begin; face_it < face_its.end; ++face_it) {
+            const auto next_it = face_it + 1 < face_its.end ? face_it + 1 : face_its.begin;
+            const glm::vec3 a(points.at(*face_it));
+            const glm::vec3 b(points.at(*next_it));
+            const auto tri_area = 0.5f * cross(a - point_mean, b - point_mean);
+            const auto tri_area_mag = length(tri_area);
+            area += tri_area;
+            centroid += tri_area_mag * (a + b + point_mean) / 3.0f;
+            area_sum += tri_area_mag;
+        }
+        faces.areas.at(face_id) = glm::vec4(area, 0.0f);
+        face_centers.at(face_id) = glm::vec4(area_sum > 0.0f ? centroid / area_sum : point_mean, 1.0f);
+    }
+    faces.owner_weights.resize(faces.neighbor.size());
+#pragma omp parallel for
+    for (int face_id = 0; face_id < static_cast<int>(faces.neighbor.size()); ++face_id) {
+        const auto& area = faces.areas.at(face_id);
+        const auto owner_dist = glm::abs(dot(area, face_centers.at(face_id)
+                                                   - cell_centers.at(faces.owner.at(face_id))));
+        const auto neighbor_dist = glm::abs(dot(area, cell_centers.at(faces.neighbor.at(face_id))
+                                                      - face_centers.at(face_id)));
+        faces.owner_weights.at(face_id) = owner_dist + neighbor_dist > 0.0f
+                                              ? neighbor_dist / (owner_dist + neighbor_dist)
+                                              : 0.5f;
+    }
+    faces.cell_offsets.assign(cell_centers.size() + 1, 0);
+    for (int face_id = 0; face_id < face_count; ++face_id) {
+        ++faces.cell_offsets.at(faces.owner.at(face_id) + 1);
+        if (face_id < static_cast<int>(faces.neighbor.size())) {
+            ++faces.cell_offsets.at(faces.neighbor.at(face_id) + 1);
+        }
+    }
+    std::partial_sum(faces.cell_offsets.begin(), faces.cell_offsets.end(), faces.cell_offsets.begin());
+    faces.cell_faces.resize(faces.cell_offsets.back());
+    auto fill_pos = faces.cell_offsets;
+    for (int face_id = 0; face_id < face_count; ++face_id) {
+        faces.cell_faces.at(fill_pos.at(faces.owner.at(face_id))++) = face_id;
+        if (face_id < static_cast<int>(faces.neighbor.size())) {
+            faces.cell_faces.at(fill_pos.at(faces.neighbor.at(face_id))++) = face_id;
+        }
+    }
+    // Divergence theorem relative to the cell center, area vectors point into the cell at its neighbor faces.
+    mesh.cell_volumes.resize(cell_centers.size());
+#pragma omp parallel for
+    for (int c_id = 0; c_id < static_cast<int>(cell_centers.size()); ++c_id) {
+        float volume = 0.0f;
+        for (int i = faces.cell_offsets.at(c_id); i < faces.cell_offsets.at(c_id + 1); ++i) {
+            const auto face_id = faces.cell_faces.at(i);
+            const auto flux = dot(faces.areas.at(face_id), face_centers.at(face_id) - cell_centers.at(c_id));
+            volume += faces.owner.at(face_id) == c_id ? flux : -flux;
+        }
+        mesh.cell_volumes.at(c_id) = volume / 3.0f;
+    }
+}
+
 void tostf::foam::Poly_mesh::load(std::filesystem::path p) {
     boundaries.clear();
     cell_radii.clear();
@@ -252,9 +330,8 @@ void tostf::foam::Poly_mesh::load(std::filesystem::path p) {
             boundaries.at(b_id).cell_refs.at(face_id - foam_boundaries.at(b_id).start_id) =
                 foam_owner.owner.at(face_id);
         }
+        boundaries.at(b_id).start_face = foam_boundaries.at(b_id).start_id;
     }
-    foam_faces.point_refs.clear();
-    foam_faces.face_it_refs.clear();
     cell_radii.resize(cell_centers.size());
 #pragma omp parallel for
     for (int c_id = 0; c_id < foam_owner.cell_count; ++c_id) {
@@ -262,19 +339,16 @@ void tostf::foam::Poly_mesh::load(std::filesystem::path p) {
         cell_radii.at(c_id) = length(cell_bounding_boxes.at(c_id).max
                                      - cell_bounding_boxes.at(c_id).min) / 2.0f;
     }
+    load_face_geometry(*this, points, foam_faces, foam_owner);
 }
 
-std::string tostf::foam::Poly_mesh::gen_datapoint_str() {
-    std::stringstream internal_str;
-    for (auto c : cell_centers) {
-        internal_str << c.x << ", " << c.y << ", " << c.z << "\n";
-    }
-    for (const auto& b_s : boundaries) {
-        for (auto b : b_s.points) {
-            internal_str << b.x << ", " << b.y << ", " << b.z << "\n";
-        }
+
+std::vector<glm::vec4> tostf::foam::Poly_mesh::gen_datapoints() const {
+    auto datapoints = cell_centers;
+    for (const auto& b : boundaries) {
+        datapoints.insert(datapoints.end(), b.points.begin(), b.points.end());
     }
-    return internal_str.str();
+    return datapoints;
 }
 
 tostf::foam::Field<float> tostf::foam::Poly_mesh::load_scalar_field_from_file(const std::string& step_path,
@@ -520,3 +594,19 @@ bool tostf::foam::is_vector_field_file(const std::filesystem::path& file_path) {
     const auto file = load_file_str(file_path);
     return parse_alnum(file, skip_whitespace(file, find_in_str(file, "class", 0).end)).first == "volVectorField";
 }
+
+std::vector<std::string> tostf::foam::find_time_steps(const std::filesystem::path& case_path, const bool skip_first) {
+    std::vector<std::string> steps;
+    for (auto& p : std::filesystem::directory_iterator(case_path)) {
+        if (p.is_directory() && is_str_float(p.path().filename().string())) {
+            steps.push_back(p.path().filename().string());
+        }
+    }
+    std::sort(steps.begin(), steps.end(), [](const std::string& a, const std::string& b) {
+        return std::stof(a) < std::stof(b);
+    });
+    if (skip_first && !steps.empty()) {
+        steps.erase(steps.begin());
+    }
+    return steps;
+}
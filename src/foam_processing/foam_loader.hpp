@@ -59,6 +59,21 @@ namespace tostf
             std::vector<glm::vec4> points;
             std::vector<float> radii;
             std::vector<int> cell_refs;
+            // Id of the first face of the boundary in Poly_mesh_faces.
+            int start_face{};
+        };
+
+        // Face connectivity and geometry of a Poly_mesh, indexed like the faces of the polyMesh, internal faces first.
+        struct Poly_mesh_faces {
+            // Area vectors pointing out of the owner cell.
+            std::vector<glm::vec4> areas;
+            std::vector<int> owner;
+            // Neighbor cell and linear interpolation weight of the owner cell for every internal face.
+            std::vector<int> neighbor;
+            std::vector<float> owner_weights;
+            // Faces of every cell in CSR layout, cell_faces from cell_offsets[c] to cell_offsets[c + 1].
+            std::vector<int> cell_offsets;
+            std::vector<int> cell_faces;
         };
 
         template <typename T>
@@ -77,13 +92,18 @@ namespace tostf
             std::vector<glm::vec4> cell_centers;
             std::vector<float> cell_radii;
             std::vector<Poly_mesh_boundary> boundaries;
-            std::string gen_datapoint_str();
+            Poly_mesh_faces faces;
+            std::vector<float> cell_volumes;
+            // Cell centers followed by the face centers of every boundary.
+            std::vector<glm::vec4> gen_datapoints() const;
             Field<float> load_scalar_field_from_file(const std::string& step_path, const std::string& field_name) const;
             Field<glm::vec4> load_vector_field_from_file(const std::string& step_path,
                                                          const std::string& field_name) const;
         };
 
         bool is_vector_field_file(const std::filesystem::path& file_path);
+        // Time step directories of the case sorted by time. skip_first drops the earliest step, e.g. the initial 0.
+        std::vector<std::string> find_time_steps(const std::filesystem::path& case_path, bool skip_first);
         std::vector<glm::vec4> load_points_from_file(const std::filesystem::path& path);
         std::vector<Foam_boundary> load_boundaries_from_file(const std::filesystem::path& path);
     }
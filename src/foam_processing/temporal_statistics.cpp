@@ -0,0 +1,234 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "temporal_statistics.hpp"
+#include "derived_fields.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+struct Temporal_accumulator {
+    double weight_sum = 0.0;
+    std::vector<double> sum;
+    std::vector<double> sum_sq;
+    std::vector<float> min;
+    std::vector<float> max;
+    std::vector<glm::dvec3> vector_sum;
+};
+
+Temporal_accumulator init_accumulator(const size_t size, const bool is_vector) {
+    Temporal_accumulator acc;
+    acc.sum.resize(size, 0.0);
+    acc.sum_sq.resize(size, 0.0);
+    acc.min.resize(size, std::numeric_limits<float>::max());
+    acc.max.resize(size, std::numeric_limits<float>::lowest());
+    if (is_vector) {
+        acc.vector_sum.resize(size, glm::dvec3(0.0));
+    }
+    return acc;
+}
+
+// Vector fields are evaluated by magnitude. The w component is not used, as uniform boundary values leave it 0.
+float temporal_value(const float v) {
+    return v;
+}
+
+float temporal_value(const glm::vec4& v) {
+    return length(glm::vec3(v));
+}
+
+template <typename T>
+void accumulate_region(Temporal_accumulator& acc, const std::vector<T>& values, const double weight) {
+    if (values.empty()) {
+        return;
+    }
+    if (values.size() != acc.sum.size()) {
+        throw std::runtime_error{"Field values do not match the mesh: " + std::to_string(values.size()) + " instead of "
+                                 + std::to_string(acc.sum.size())};
+    }
+    acc.weight_sum += weight;
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+        const auto v = temporal_value(values.at(i));
+        acc.sum.at(i) += weight * v;
+        acc.sum_sq.at(i) += weight * v * v;
+        acc.min.at(i) = std::min(acc.min.at(i), v);
+        acc.max.at(i) = std::max(acc.max.at(i), v);
+        if constexpr (std::is_same_v<T, glm::vec4>) {
+            acc.vector_sum.at(i) += weight * glm::dvec3(values.at(i));
+        }
+    }
+}
+
+template <typename T>
+void accumulate_field(std::vector<Temporal_accumulator>& regions, const tostf::foam::Field<T>& field,
+                      const double weight) {
+    accumulate_region(regions.at(0), field.internal_data, weight);
+    for (size_t b_id = 0; b_id < field.boundaries_data.size(); ++b_id) {
+        accumulate_region(regions.at(b_id + 1), field.boundaries_data.at(b_id), weight);
+    }
+}
+
+std::vector<float> calc_region_statistic(const Temporal_accumulator& acc,
+                                         const tostf::foam::temporal_statistic statistic) {
+    if (acc.weight_sum <= 0.0) {
+        return {};
+    }
+    std::vector<float> values(acc.sum.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+        switch (statistic) {
+            case tostf::foam::temporal_statistic::mean:
+                values.at(i) = static_cast<float>(acc.sum.at(i) / acc.weight_sum);
+                break;
+            case tostf::foam::temporal_statistic::rms:
+                values.at(i) = static_cast<float>(std::sqrt(acc.sum_sq.at(i) / acc.weight_sum));
+                break;
+            case tostf::foam::temporal_statistic::min:
+                values.at(i) = acc.min.at(i);
+                break;
+            case tostf::foam::temporal_statistic::max:
+                values.at(i) = acc.max.at(i);
+                break;
+            default: {
+                // The weight sum cancels out of the ratio of the mean vector and the mean magnitude.
+                const auto mean_mag = acc.sum.at(i);
+                const auto osi = mean_mag > 0.0 ? 0.5 * (1.0 - length(acc.vector_sum.at(i)) / mean_mag) : 0.0;
+                values.at(i) = static_cast<float>(std::clamp(osi, 0.0, 0.5));
+            }
+        }
+    }
+    return values;
+}
+
+void update_field_range(tostf::foam::Field<float>& field, const std::vector<float>& values, double& sum,
+                        size_t& count) {
+    for (const auto v : values) {
+        field.min = std::min(field.min, v);
+        field.max = std::max(field.max, v);
+        sum += v;
+    }
+    count += values.size();
+}
+
+tostf::foam::Field<float> gen_statistic_field(const std::vector<Temporal_accumulator>& regions,
+                                              const tostf::foam::temporal_statistic statistic) {
+    tostf::foam::Field<float> field;
+    double sum = 0.0;
+    size_t count = 0;
+    field.internal_data = calc_region_statistic(regions.at(0), statistic);
+    update_field_range(field, field.internal_data, sum, count);
+    field.boundaries_data.resize(regions.size() - 1);
+    for (size_t b_id = 0; b_id < field.boundaries_data.size(); ++b_id) {
+        field.boundaries_data.at(b_id) = calc_region_statistic(regions.at(b_id + 1), statistic);
+        update_field_range(field, field.boundaries_data.at(b_id), sum, count);
+    }
+    if (count > 0) {
+        field.avg = static_cast<float>(sum / static_cast<double>(count));
+    }
+    return field;
+}
+
+std::string tostf::foam::gen_temporal_field_name(const std::string& field_name, const temporal_statistic statistic) {
+    if (field_name == "wallShearStress") {
+        if (statistic == temporal_statistic::mean) {
+            return "TAWSS";
+        }
+        if (statistic == temporal_statistic::osi) {
+            return "OSI";
+        }
+    }
+    const std::array<std::string, static_cast<size_t>(temporal_statistic::count)> suffixes{
+        "mean", "rms", "min", "max", "osi"
+    };
+    return field_name + "_" + suffixes.at(static_cast<size_t>(statistic));
+}
+
+std::vector<double> tostf::foam::calc_step_weights(const std::vector<std::string>& steps) {
+    const auto step_count = steps.size();
+    std::vector<double> weights(step_count, step_count > 0 ? 1.0 / static_cast<double>(step_count) : 0.0);
+    if (step_count < 2) {
+        return weights;
+    }
+    std::vector<double> times(step_count);
+    std::transform(steps.begin(), steps.end(), times.begin(), [](const std::string& s) { return std::stod(s); });
+    const auto duration = times.back() - times.front();
+    if (duration <= 0.0) {
+        return weights;
+    }
+    for (size_t s = 0; s < step_count; ++s) {
+        const auto prev = times.at(s > 0 ? s - 1 : s);
+        const auto next = times.at(s + 1 < step_count ? s + 1 : s);
+        weights.at(s) = (next - prev) / (2.0 * duration);
+    }
+    return weights;
+}
+
+std::map<std::string, tostf::foam::Field<float>> tostf::foam::calc_temporal_statistics(
+    const Poly_mesh& mesh, const std::vector<std::string>& steps, const std::string& field_name,
+    const int max_loaded_steps) {
+    if (steps.empty()) {
+        throw std::runtime_error{"No time steps to compute statistics of " + field_name};
+    }
+    const auto is_vector = is_step_vector_field(mesh, steps.front(), field_name);
+    const auto weights = calc_step_weights(steps);
+    std::vector<Temporal_accumulator> regions;
+    regions.reserve(mesh.boundaries.size() + 1);
+    regions.push_back(init_accumulator(mesh.cell_centers.size(), is_vector));
+    for (const auto& b : mesh.boundaries) {
+        regions.push_back(init_accumulator(b.points.size(), is_vector));
+    }
+    const auto batch_size = static_cast<size_t>(std::max(max_loaded_steps, 1));
+    for (size_t first = 0; first < steps.size(); first += batch_size) {
+        const auto loaded_count = std::min(batch_size, steps.size() - first);
+        std::vector<Field<float>> scalar_fields(is_vector ? 0 : loaded_count);
+        std::vector<Field<glm::vec4>> vector_fields(is_vector ? loaded_count : 0);
+        std::exception_ptr load_error = nullptr;
+#pragma omp parallel for num_threads(static_cast<int>(loaded_count))
+        for (int i = 0; i < static_cast<int>(loaded_count); ++i) {
+            try {
+                if (is_vector) {
+                    vector_fields.at(i) = load_step_vector_field(mesh, steps.at(first + i), field_name);
+                }
+                else {
+                    scalar_fields.at(i) = load_step_scalar_field(mesh, steps.at(first + i), field_name);
+                }
+            }
+            catch (...) {
+#pragma omp critical
+                if (!load_error) {
+                    load_error = std::current_exception();
+                }
+            }
+        }
+        if (load_error) {
+            std::rethrow_exception(load_error);
+        }
+        // Accumulated in step order, so the sums do not depend on which thread loaded a step.
+        for (size_t i = 0; i < loaded_count; ++i) {
+            if (is_vector) {
+                accumulate_field(regions, vector_fields.at(i), weights.at(first + i));
+            }
+            else {
+                accumulate_field(regions, scalar_fields.at(i), weights.at(first + i));
+            }
+        }
+    }
+    std::map<std::string, Field<float>> result;
+    for (int s = 0; s < static_cast<int>(temporal_statistic::count); ++s) {
+        const auto statistic = static_cast<temporal_statistic>(s);
+        if (statistic == temporal_statistic::osi && !is_vector) {
+            continue;
+        }
+        result.emplace(gen_temporal_field_name(field_name, statistic), gen_statistic_field(regions, statistic));
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "foam_loader.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace tostf
+{
+    namespace foam
+    {
+        enum class temporal_statistic : int {
+            mean = 0,
+            rms = 1,
+            min = 2,
+            max = 3,
+            // Oscillatory shear index, only computed for vector fields.
+            osi = 4,
+            count = 5
+        };
+
+        // Name of the virtual field holding a statistic, e.g. p_mean. For wallShearStress the mean and the
+        // oscillatory shear index are called TAWSS and OSI.
+        std::string gen_temporal_field_name(const std::string& field_name, temporal_statistic statistic);
+
+        // Weights of the steps for time averages, i.e. the trapezoidal rule over the step times normalized to 1.
+        // Equal weights are used if the steps do not span any time.
+        std::vector<double> calc_step_weights(const std::vector<std::string>& steps);
+
+        // Reduces a field over all steps in one pass and returns the statistics per cell and boundary face as
+        // virtual fields named by gen_temporal_field_name. Vector fields are evaluated by magnitude, their OSI is
+        // 0.5 * (1 - |mean vector| / mean magnitude).
+        // Up to max_loaded_steps steps are loaded in parallel, the memory needed is bounded by these steps and the
+        // accumulators, independent of the step count. Regions are averaged over the steps holding values for them,
+        // regions without any values are left empty.
+        std::map<std::string, Field<float>> calc_temporal_statistics(const Poly_mesh& mesh,
+                                                                      const std::vector<std::string>& steps,
+                                                                      const std::string& field_name,
+                                                                      int max_loaded_steps = 4);
+    }
+}
@@ -9,6 +9,7 @@
 #include "utility/utility.hpp"
 #include <execution>
 #include <utility>
+#include <algorithm>
 
 tostf::Bounding_box tostf::calculate_bounding_box(const std::vector<glm::dvec4>& vertices) {
     // https://twitter.com/flx_schroeder/status/993097873322659840
@@ -38,6 +39,120 @@ tostf::Bounding_box tostf::calculate_bounding_box(const std::vector<glm::vec4>&
     return {bb[0], bb[1]};
 }
 
+struct Kahan_sum {
+    void add(const double value) {
+        const auto y = value - compensation;
+        const auto t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+    double sum = 0.0;
+    double compensation = 0.0;
+};
+
+struct Face_stats_block {
+    Kahan_sum area;
+    Kahan_sum edge_length;
+    Kahan_sum volume;
+    float min_area = FLT_MAX;
+    float max_area = 0.0f;
+    float min_edge_length = FLT_MAX;
+    float max_edge_length = 0.0f;
+};
+
+// Values are partially sorted in place to find the quantiles.
+tostf::Value_distribution calc_value_distribution(std::vector<float>& values, const float min, const float max,
+                                                  const int bin_count) {
+    tostf::Value_distribution distribution;
+    distribution.bins.resize(bin_count, 0.0f);
+    const auto scale = max > min ? static_cast<float>(bin_count) / (max - min) : 0.0f;
+    std::vector<unsigned> counts(bin_count, 0);
+#pragma omp parallel
+    {
+        std::vector<unsigned> local_counts(bin_count, 0);
+#pragma omp for nowait
+        for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+            ++local_counts.at(glm::clamp(static_cast<int>((values.at(i) - min) * scale), 0, bin_count - 1));
+        }
+#pragma omp critical
+        for (int b = 0; b < bin_count; ++b) {
+            counts.at(b) += local_counts.at(b);
+        }
+    }
+    for (int b = 0; b < bin_count; ++b) {
+        distribution.bins.at(b) = static_cast<float>(counts.at(b)) / static_cast<float>(values.size());
+    }
+    auto begin = values.begin();
+    for (size_t q = 0; q < distribution.quantiles.size(); ++q) {
+        const auto nth = values.begin() + static_cast<std::ptrdiff_t>(
+                             tostf::Value_distribution::quantile_levels.at(q) * static_cast<float>(values.size() - 1));
+        std::nth_element(std::execution::par, begin, nth, values.end());
+        distribution.quantiles.at(q) = *nth;
+        begin = nth;
+    }
+    return distribution;
+}
+
+tostf::Mesh_stats tostf::calculate_mesh_stats(const std::vector<glm::vec4>& vertices,
+                                              const std::vector<unsigned>& indices, const int bin_count) {
+    Mesh_stats stats{};
+    const auto face_count = static_cast<int>(indices.size() / 3);
+    if (face_count == 0) {
+        return stats;
+    }
+    std::vector<float> areas(face_count);
+    std::vector<float> edge_lengths(indices.size());
+    // Faces are split into a fixed number of blocks which are combined in order, so the sums are reproducible.
+    constexpr int block_count = 64;
+    std::vector<Face_stats_block> blocks(block_count);
+#pragma omp parallel for
+    for (int b = 0; b < block_count; ++b) {
+        auto& block = blocks.at(b);
+        const auto end = static_cast<int>(static_cast<int64_t>(face_count) * (b + 1) / block_count);
+        for (auto f = static_cast<int>(static_cast<int64_t>(face_count) * b / block_count); f < end; ++f) {
+            const auto p0 = glm::vec3(vertices.at(indices.at(3 * f)));
+            const auto p1 = glm::vec3(vertices.at(indices.at(3 * f + 1)));
+            const auto p2 = glm::vec3(vertices.at(indices.at(3 * f + 2)));
+            const auto e0 = p1 - p0;
+            const auto e1 = p2 - p1;
+            const auto e2 = p0 - p2;
+            const auto area = 0.5f * length(cross(e0, -e2));
+            const glm::vec3 lengths(length(e0), length(e1), length(e2));
+            // Signed volume of the tetrahedron spanned by the face and the origin.
+            block.volume.add(static_cast<double>(dot(p0, cross(p1, p2))) / 6.0);
+            block.area.add(static_cast<double>(area));
+            block.edge_length.add(static_cast<double>(lengths.x + lengths.y + lengths.z));
+            block.min_area = glm::min(block.min_area, area);
+            block.max_area = glm::max(block.max_area, area);
+            block.min_edge_length = glm::min(block.min_edge_length, glm::min(lengths.x, glm::min(lengths.y, lengths.z)));
+            block.max_edge_length = glm::max(block.max_edge_length, glm::max(lengths.x, glm::max(lengths.y, lengths.z)));
+            areas.at(f) = area;
+            edge_lengths.at(3 * f) = lengths.x;
+            edge_lengths.at(3 * f + 1) = lengths.y;
+            edge_lengths.at(3 * f + 2) = lengths.z;
+        }
+    }
+    Kahan_sum area;
+    Kahan_sum edge_length;
+    Kahan_sum volume;
+    for (const auto& block : blocks) {
+        area.add(block.area.sum);
+        edge_length.add(block.edge_length.sum);
+        volume.add(block.volume.sum);
+        stats.area.min = glm::min(stats.area.min, block.min_area);
+        stats.area.max = glm::max(stats.area.max, block.max_area);
+        stats.edge_length.min = glm::min(stats.edge_length.min, block.min_edge_length);
+        stats.edge_length.max = glm::max(stats.edge_length.max, block.max_edge_length);
+    }
+    stats.area.avg = static_cast<float>(area.sum / face_count);
+    stats.edge_length.avg = static_cast<float>(edge_length.sum / (3.0 * face_count));
+    stats.volume = static_cast<float>(volume.sum);
+    stats.area_distribution = calc_value_distribution(areas, stats.area.min, stats.area.max, bin_count);
+    stats.edge_length_distribution = calc_value_distribution(edge_lengths, stats.edge_length.min,
+                                                             stats.edge_length.max, bin_count);
+    return stats;
+}
+
 bool tostf::Geometry::has_vertices() const {
     return !vertices.empty();
 }
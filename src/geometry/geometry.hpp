@@ -9,6 +9,7 @@
 
 #include "math/glm_helper.hpp"
 #include <vector>
+#include <array>
 #include <optional>
 #include <memory>
 
@@ -21,9 +22,18 @@ namespace tostf
         T max = T(std::numeric_limits<T>::lowest());
     };
 
+    // Fraction of the values in equally wide bins between min and max and quantiles at the given levels.
+    struct Value_distribution {
+        static constexpr std::array<float, 5> quantile_levels{0.05f, 0.25f, 0.5f, 0.75f, 0.95f};
+        std::vector<float> bins;
+        std::array<float, 5> quantiles{};
+    };
+
     struct Mesh_stats {
         Geometric_stats<float> area{};
         Geometric_stats<float> edge_length{};
+        Value_distribution area_distribution{};
+        Value_distribution edge_length_distribution{};
         float volume = 0.0f;
     };
 
@@ -34,6 +44,9 @@ namespace tostf
 
     Bounding_box calculate_bounding_box(const std::vector<glm::dvec4>& vertices);
     Bounding_box calculate_bounding_box(const std::vector<glm::vec4>& vertices);
+    // Triangle areas, edge lengths per face and the enclosed volume of consecutive index triples.
+    Mesh_stats calculate_mesh_stats(const std::vector<glm::vec4>& vertices, const std::vector<unsigned>& indices,
+                                    int bin_count = 64);
 
     struct Faces_info {
         std::vector<glm::vec4> face_normals;
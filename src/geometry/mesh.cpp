@@ -7,25 +7,143 @@
 
 #include "mesh.hpp"
 #include <glm/gtx/hash.hpp>
+#include <glm/gtx/component_wise.hpp>
 #include <vector>
 #include <random>
 #include "math/vector_math.hpp"
 #include <map>
+#include <algorithm>
+#include <execution>
+#include <numeric>
 
-void tostf::Mesh::join_vertices() {
-    std::unordered_map<glm::vec4, unsigned> joined_vertex_map;
-    for (int i = 0; i < static_cast<int>(vertices.size()); ++i) {
-        joined_vertex_map.emplace(vertices.at(i), joined_vertex_map.size());
+// Cell coordinates are packed into 21 bits per axis.
+constexpr uint64_t weld_cell_bits = 21;
+constexpr uint64_t weld_cell_mask = (1ull << weld_cell_bits) - 1;
+
+uint64_t pack_weld_cell(const glm::ivec3& cell) {
+    return static_cast<uint64_t>(cell.x) << (2 * weld_cell_bits) | static_cast<uint64_t>(cell.y) << weld_cell_bits
+           | static_cast<uint64_t>(cell.z);
+}
+
+void tostf::Mesh::join_vertices(const float epsilon) {
+    const auto vertex_count = static_cast<int>(vertices.size());
+    if (vertex_count == 0) {
+        return;
     }
+    const auto bb = calculate_bounding_box(vertices);
+    const auto extent = glm::vec3(bb.max - bb.min);
+    // Cells are at least epsilon wide, so every vertex within epsilon lies in one of the 27 surrounding cells.
+    const auto cell_size = glm::max(glm::max(epsilon, glm::compMax(extent) / static_cast<float>(weld_cell_mask - 2)),
+                                    FLT_MIN);
+    std::vector<glm::ivec3> cells(vertex_count);
+    std::vector<std::pair<uint64_t, unsigned>> keys(vertex_count);
 #pragma omp parallel for
-    for (int i = 0; i < static_cast<int>(indices.size()); i++) {
-        indices.at(i) = joined_vertex_map.at(vertices.at(indices.at(i)));
+    for (int i = 0; i < vertex_count; ++i) {
+        cells.at(i) = glm::ivec3((glm::vec3(vertices.at(i)) - glm::vec3(bb.min)) / cell_size) + 1;
+        keys.at(i) = {pack_weld_cell(cells.at(i)), static_cast<unsigned>(i)};
+    }
+    std::sort(std::execution::par, keys.begin(), keys.end());
+    std::vector<uint64_t> cell_keys;
+    std::vector<unsigned> cell_offsets;
+    for (int i = 0; i < vertex_count; ++i) {
+        if (i == 0 || keys.at(i).first != keys.at(i - 1).first) {
+            cell_keys.push_back(keys.at(i).first);
+            cell_offsets.push_back(static_cast<unsigned>(i));
+        }
+    }
+    cell_offsets.push_back(static_cast<unsigned>(vertex_count));
+
+    // Vertices within epsilon of each other are united, so chains of close vertices end up in one cluster even if
+    // their ends are further apart. Every cluster is represented by its lowest id, independent of the thread schedule.
+    const auto sq_epsilon = epsilon * epsilon;
+    // Identical vertices always share a cell, so only welding has to look at the neighboring cells.
+    const auto reach = epsilon > 0.0f ? 1 : 0;
+    std::vector<std::vector<std::pair<unsigned, unsigned>>> cell_pairs(cell_keys.size());
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int c = 0; c < static_cast<int>(cell_keys.size()); ++c) {
+        const auto cell = cells.at(keys.at(cell_offsets.at(c)).second);
+        std::vector<unsigned> neighbor_cells;
+        for (int z = -reach; z <= reach; ++z) {
+            for (int y = -reach; y <= reach; ++y) {
+                for (int x = -reach; x <= reach; ++x) {
+                    const auto key = pack_weld_cell(cell + glm::ivec3(x, y, z));
+                    const auto it = std::lower_bound(cell_keys.begin(), cell_keys.end(), key);
+                    if (it != cell_keys.end() && *it == key) {
+                        neighbor_cells.push_back(static_cast<unsigned>(std::distance(cell_keys.begin(), it)));
+                    }
+                }
+            }
+        }
+        for (auto i = cell_offsets.at(c); i < cell_offsets.at(c + 1); ++i) {
+            const auto v = keys.at(i).second;
+            for (const auto n : neighbor_cells) {
+                for (auto j = cell_offsets.at(n); j < cell_offsets.at(n + 1); ++j) {
+                    const auto other = keys.at(j).second;
+                    if (other >= v) {
+                        // Vertices of a cell are sorted by id, every pair is found from its higher id.
+                        break;
+                    }
+                    const auto diff = glm::vec3(vertices.at(v) - vertices.at(other));
+                    if (dot(diff, diff) <= sq_epsilon) {
+                        cell_pairs.at(c).emplace_back(v, other);
+                    }
+                }
+            }
+        }
+    }
+    // Union-find where the higher root is always linked to the lower one.
+    std::vector<unsigned> root(vertex_count);
+    std::iota(root.begin(), root.end(), 0u);
+    const auto find_root = [&root](unsigned v) {
+        while (root.at(v) != v) {
+            root.at(v) = root.at(root.at(v));
+            v = root.at(v);
+        }
+        return v;
+    };
+    for (const auto& pairs : cell_pairs) {
+        for (const auto& p : pairs) {
+            const auto a = find_root(p.first);
+            const auto b = find_root(p.second);
+            if (a != b) {
+                root.at(glm::max(a, b)) = glm::min(a, b);
+            }
+        }
+    }
+    // Roots have lower ids than their members, so in id order the root of the parent is already final.
+    for (int i = 0; i < vertex_count; ++i) {
+        root.at(i) = root.at(root.at(i));
+    }
+    std::vector<unsigned> new_ids(vertex_count);
+    unsigned joined_count = 0;
+    for (int i = 0; i < vertex_count; ++i) {
+        if (root.at(i) == static_cast<unsigned>(i)) {
+            new_ids.at(i) = joined_count++;
+        }
+    }
+    std::vector<glm::vec4> new_vertices(joined_count);
+    std::vector<glm::vec4> new_normals(has_normals() ? joined_count : 0);
+    std::vector<glm::vec2> new_uv_coords(has_uv_coords() ? joined_count : 0);
+#pragma omp parallel for
+    for (int i = 0; i < vertex_count; ++i) {
+        if (root.at(i) != static_cast<unsigned>(i)) {
+            continue;
+        }
+        new_vertices.at(new_ids.at(i)) = vertices.at(i);
+        if (!new_normals.empty()) {
+            new_normals.at(new_ids.at(i)) = normals.at(i);
+        }
+        if (!new_uv_coords.empty()) {
+            new_uv_coords.at(new_ids.at(i)) = uv_coords.at(i);
+        }
     }
-    std::vector<glm::vec4> new_vertices(joined_vertex_map.size());
-    for (auto& v : joined_vertex_map) {
-        new_vertices.at(v.second) = v.first;
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(indices.size()); i++) {
+        indices.at(i) = new_ids.at(root.at(indices.at(i)));
     }
-    vertices = new_vertices;
+    vertices = std::move(new_vertices);
+    normals = std::move(new_normals);
+    uv_coords = std::move(new_uv_coords);
 }
 
 void tostf::Mesh::remove_indices(const std::vector<unsigned>& ids) {
@@ -37,7 +155,7 @@ void tostf::Mesh::remove_indices(const std::vector<unsigned>& ids) {
 glm::vec4 tostf::Mesh::find_random_point_in_mesh(const float offset) {
     std::random_device rd;
     std::mt19937 rng(rd());
-    const std::uniform_int_distribution<unsigned> uni_id(0, static_cast<unsigned>(vertices.size()));
+    const std::uniform_int_distribution<unsigned> uni_id(0, static_cast<unsigned>(vertices.size() - 1));
     const auto id = uni_id(rng);
     const auto random_point = vertices.at(id);
     auto normal = glm::vec4(0);
@@ -14,7 +14,10 @@ namespace tostf
 {
     // Mesh_data is used to store data which is commonly part of a mesh definition.
     struct Mesh : Geometry {
-        void join_vertices();
+        // Welds every cluster of vertices connected by distances up to epsilon into its lowest id vertex, so the
+        // result does not depend on the vertex order. Normals and uv coordinates of the remaining vertices are kept.
+        // An epsilon of 0 only joins identical vertices.
+        void join_vertices(float epsilon = 0.0f);
         void remove_indices(const std::vector<unsigned>& ids);
         glm::vec4 find_random_point_in_mesh(float offset = 1.192092896e-07F);
         bool is_inside(glm::vec4 p);
@@ -9,9 +9,8 @@
 #include "mesh_handling.hpp"
 #include "utility/logging.hpp"
 #include "file/file_handling.hpp"
+#include "file/obj_writer.hpp"
 #include <stdexcept>
-#include <thread>
-#include <sstream>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -139,183 +138,58 @@ std::map<std::string, std::shared_ptr<tostf::Mesh>> tostf::load_named_meshes(con
     return meshes;
 }
 
-std::string tostf::gen_geom_indices_export_str(const std::shared_ptr<Geometry>& geometry, const unsigned index_offset) {
-    std::stringstream face_str;
-    if (geometry->has_uv_coords() && geometry->has_normals()) {
-        for (int i = 0; i < static_cast<int>(geometry->indices.size()) / 3; i++) {
-            const int index_a = index_offset + geometry->indices.at(i * 3 + 0) + 1;
-            const int index_b = index_offset + geometry->indices.at(i * 3 + 1) + 1;
-            const int index_c = index_offset + geometry->indices.at(i * 3 + 2) + 1;
-            face_str << "f " << index_a << "/" << index_a << "/" << index_a
-                << " " << index_b << "/" << index_b << "/" << index_b
-                << " " << index_c << "/" << index_c << "/" << index_c << "\n";
-        }
-    }
-    else if (geometry->has_uv_coords() && !geometry->has_normals()) {
-        for (int i = 0; i < static_cast<int>(geometry->indices.size()) / 3; i++) {
-            const int index_a = index_offset + geometry->indices.at(i * 3 + 0) + 1;
-            const int index_b = index_offset + geometry->indices.at(i * 3 + 1) + 1;
-            const int index_c = index_offset + geometry->indices.at(i * 3 + 2) + 1;
-            face_str << "f " << index_a << "/" << index_a
-                << " " << index_b << "/" << index_b
-                << " " << index_c << "/" << index_c << "\n";
-        }
-    }
-    else if (!geometry->has_uv_coords() && geometry->has_normals()) {
-        for (int i = 0; i < static_cast<int>(geometry->indices.size()) / 3; i++) {
-            const int index_a = index_offset + geometry->indices.at(i * 3 + 0) + 1;
-            const int index_b = index_offset + geometry->indices.at(i * 3 + 1) + 1;
-            const int index_c = index_offset + geometry->indices.at(i * 3 + 2) + 1;
-            face_str << "f " << index_a << "/" << "/" << index_a
-                << " " << index_b << "/" << "/" << index_b
-                << " " << index_c << "/" << "/" << index_c << "\n";
-        }
+void tostf::export_geom_as_obj(const std::shared_ptr<Geometry>& geometry, const std::filesystem::path& path,
+                               const int precision) {
+    Obj_writer writer(path, precision);
+    writer.write_vertices(geometry->vertices);
+    if (geometry->has_normals()) {
+        writer.write_normals(geometry->normals);
     }
-    else {
-        for (int i = 0; i < static_cast<int>(geometry->indices.size()) / 3; i++) {
-            const int index_a = index_offset + geometry->indices.at(i * 3 + 0) + 1;
-            const int index_b = index_offset + geometry->indices.at(i * 3 + 1) + 1;
-            const int index_c = index_offset + geometry->indices.at(i * 3 + 2) + 1;
-            face_str << "f " << index_a << " " << index_b << " " << index_c << "\n";
-        }
+    if (geometry->has_uv_coords()) {
+        writer.write_uv_coords(geometry->uv_coords);
     }
-    return face_str.str();
+    writer.write_faces(geometry->indices, geometry->has_normals(), geometry->has_uv_coords());
+    writer.close();
 }
 
-std::string tostf::gen_geom_data_export_str(const std::shared_ptr<Geometry>& geometry, const int precision) {
-    std::stringstream vert_str;
-    std::stringstream normal_str;
-    std::stringstream uv_str;
-    vert_str.setf(std::ios::fixed, std::ios::floatfield);
-    normal_str.setf(std::ios::fixed, std::ios::floatfield);
-    uv_str.setf(std::ios::fixed, std::ios::floatfield);
-    vert_str.precision(precision);
-    normal_str.precision(precision);
-    uv_str.precision(precision);
-    std::thread vert_thread([&vert_str, geometry]() {
-        for (const auto& v : geometry->vertices) {
-            vert_str << "v " << v.x << " " << v.y << " " << v.z << "\n";
-        }
-    });
-    std::thread normal_thread([&normal_str, geometry]() {
+void tostf::export_geom_view_as_obj(const Geometry_view& view, const std::filesystem::path& path,
+                                    const unsigned index_offset, const int precision) {
+    // Only the vertices referenced by the view are written, in the order of their first use.
+    std::vector<int> view_ids(view.geometry->vertices.size(), -1);
+    std::vector<unsigned> used_vertices;
+    std::vector<unsigned> indices(view.indices.size());
+    for (size_t i = 0; i < view.indices.size(); ++i) {
+        auto& id = view_ids.at(view.indices.at(i));
+        if (id < 0) {
+            id = static_cast<int>(used_vertices.size());
+            used_vertices.push_back(view.indices.at(i));
+        }
+        indices.at(i) = static_cast<unsigned>(id);
+    }
+    const auto& geometry = view.geometry;
+    Geometry part;
+    part.vertices.resize(used_vertices.size());
+    part.normals.resize(geometry->has_normals() ? used_vertices.size() : 0);
+    part.uv_coords.resize(geometry->has_uv_coords() ? used_vertices.size() : 0);
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(used_vertices.size()); ++i) {
+        const auto v = used_vertices.at(i);
+        part.vertices.at(i) = geometry->vertices.at(v);
         if (geometry->has_normals()) {
-            for (const auto& n : geometry->normals) {
-                normal_str << "vn " << n.x << " " << n.y << " " << n.z << "\n";
-            }
+            part.normals.at(i) = geometry->normals.at(v);
         }
-    });
-    std::thread uv_thread([&uv_str, geometry]() {
         if (geometry->has_uv_coords()) {
-            for (const auto& uv : geometry->uv_coords) {
-                uv_str << "vt " << uv.x << " " << uv.y << "\n";
-            }
-        }
-    });
-    vert_thread.join();
-    normal_thread.join();
-    uv_thread.join();
-    vert_str << normal_str.str() << uv_str.str();
-    return vert_str.str();
-}
-
-void tostf::export_geom_as_obj(const std::shared_ptr<Geometry>& geometry, const std::filesystem::path& path,
-                               const int precision) {
-    save_str_to_file(path, gen_geom_data_export_str(geometry, precision));
-    save_str_to_file(path, gen_geom_indices_export_str(geometry, 0), std::ios::out | std::ios::app);
-}
-
-std::string tostf::gen_geom_view_data_export_str(const Geometry_view& view, const int precision) {
-    std::stringstream vert_str;
-    std::stringstream normal_str;
-    std::stringstream uv_str;
-    vert_str.setf(std::ios::fixed, std::ios::floatfield);
-    normal_str.setf(std::ios::fixed, std::ios::floatfield);
-    uv_str.setf(std::ios::fixed, std::ios::floatfield);
-    vert_str.precision(precision);
-    normal_str.precision(precision);
-    uv_str.precision(precision);
-    std::thread vert_thread([&vert_str, &view]() {
-        for (int i = 0; i < static_cast<int>(view.indices.size()); i++) {
-            auto& v = view.geometry->vertices.at(view.indices.at(i));
-            vert_str << "v " << v.x << " " << v.y << " " << v.z << "\n";
-        }
-    });
-    std::thread normal_thread([&normal_str, &view]() {
-        if (view.geometry->has_normals()) {
-            for (int i = 0; i < static_cast<int>(view.indices.size()); i++) {
-                auto& n = view.geometry->normals.at(view.indices.at(i));
-                normal_str << "vn " << n.x << " " << n.y << " " << n.z << "\n";
-            }
-        }
-    });
-    std::thread uv_thread([&uv_str, &view]() {
-        if (view.geometry->has_uv_coords()) {
-            for (int i = 0; i < static_cast<int>(view.indices.size()); i++) {
-                auto& uv = view.geometry->uv_coords.at(view.indices.at(i));
-                uv_str << "vt " << uv.x << " " << uv.y << "\n";
-            }
-        }
-    });
-    vert_thread.join();
-    normal_thread.join();
-    uv_thread.join();
-    vert_str << normal_str.str() << uv_str.str();
-    return vert_str.str();
-}
-
-std::string tostf::gen_geom_view_indices_export_str(const Geometry_view& view,
-                                                    const unsigned index_offset) {
-    std::stringstream face_str;
-    if (view.geometry->has_uv_coords() && view.geometry->has_normals()) {
-        for (int i = 0; i < static_cast<int>(view.indices.size()) / 3; i++) {
-            const int index_a = index_offset + i * 3 + 0 + 1;
-            const int index_b = index_offset + i * 3 + 1 + 1;
-            const int index_c = index_offset + i * 3 + 2 + 1;
-            face_str << "f " << index_a << "/" << index_a << "/" << index_a
-                << " " << index_b << "/" << index_b << "/" << index_b
-                << " " << index_c << "/" << index_c << "/" << index_c << "\n";
-        }
-    }
-    else if (view.geometry->has_uv_coords() && !view.geometry->has_normals()) {
-        for (int i = 0; i < static_cast<int>(view.indices.size()) / 3; i++) {
-            const int index_a = index_offset + i * 3 + 0 + 1;
-            const int index_b = index_offset + i * 3 + 1 + 1;
-            const int index_c = index_offset + i * 3 + 2 + 1;
-            face_str << "f " << index_a << "/" << index_a
-                << " " << index_b << "/" << index_b
-                << " " << index_c << "/" << index_c << "\n";
+            part.uv_coords.at(i) = geometry->uv_coords.at(v);
         }
     }
-    else if (!view.geometry->has_uv_coords() && view.geometry->has_normals()) {
-        for (int i = 0; i < static_cast<int>(view.indices.size()) / 3; i++) {
-            const int index_a = index_offset + i * 3 + 0 + 1;
-            const int index_b = index_offset + i * 3 + 1 + 1;
-            const int index_c = index_offset + i * 3 + 2 + 1;
-            face_str << "f " << index_a << "/" << "/" << index_a
-                << " " << index_b << "/" << "/" << index_b
-                << " " << index_c << "/" << "/" << index_c << "\n";
-        }
+    Obj_writer writer(path, precision);
+    writer.write_vertices(part.vertices);
+    if (geometry->has_normals()) {
+        writer.write_normals(part.normals);
     }
-    else {
-        for (int i = 0; i < static_cast<int>(view.indices.size()) / 3; i++) {
-            const int index_a = index_offset + i * 3 + 0 + 1;
-            const int index_b = index_offset + i * 3 + 1 + 1;
-            const int index_c = index_offset + i * 3 + 2 + 1;
-            face_str << "f " << index_a << " " << index_b << " " << index_c << "\n";
-        }
+    if (geometry->has_uv_coords()) {
+        writer.write_uv_coords(part.uv_coords);
     }
-    return face_str.str();
-}
-
-std::string tostf::gen_geom_view_export_str(const Geometry_view& view, const unsigned index_offset,
-                                            const int precision) {
-    std::stringstream view_exp_str;
-    view_exp_str << gen_geom_view_data_export_str(view, precision);
-    view_exp_str << gen_geom_view_indices_export_str(view, index_offset);
-    return view_exp_str.str();
-}
-
-void tostf::export_geom_view_as_obj(const Geometry_view& view, const std::filesystem::path& path,
-                                    const unsigned index_offset, const int precision) {
-    save_str_to_file(path, gen_geom_view_export_str(view, index_offset, precision));
+    writer.write_faces(indices, geometry->has_normals(), geometry->has_uv_coords(), index_offset);
+    writer.close();
 }
@@ -40,18 +40,10 @@ namespace tostf
                                                                    bool move_to_center = false, unsigned ai_pflags = 0,
                                                                    mesh_flag mesh_load_flags = mesh_flag::all);
 
-    std::string gen_geom_indices_export_str(const std::shared_ptr<Geometry>& geometry, unsigned index_offset);
-    std::string gen_geom_data_export_str(const std::shared_ptr<Geometry>& geometry, int precision = 7);
-
+    // Both exports write indexed OBJ files through an Obj_writer.
     void export_geom_as_obj(const std::shared_ptr<Geometry>& geometry, const std::filesystem::path& path,
                             int precision = 7);
-
-    std::string gen_geom_view_data_export_str(const Geometry_view& view, int precision = 7);
-    std::string gen_geom_view_scaled_data_export_str(const Geometry_view& view, float scale, int precision = 7);
-    std::string gen_geom_view_indices_export_str(const Geometry_view& view, unsigned index_offset = 0);
-    std::string gen_geom_view_export_str(const Geometry_view& view, unsigned index_offset = 0, int precision = 7);
-    std::string gen_geom_view_scaled_export_str(const Geometry_view& view, float scale, unsigned index_offset = 0,
-                                                int precision = 7);
+    // Only the vertices referenced by the view are written, index_offset is added to every face index.
     void export_geom_view_as_obj(const Geometry_view& view, const std::filesystem::path& path,
                                  unsigned index_offset = 0, int precision = 7);
 }
@@ -0,0 +1,104 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "lanczos.hpp"
+#include <Eigen/Eigenvalues>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+tostf::math::Eigenpairs tostf::math::lanczos_largest_eigenpairs(const Sparse_matrix& m, const int count,
+                                                                int iterations, const unsigned seed) {
+    const auto n = static_cast<int>(m.rows());
+    if (m.rows() != m.cols()) {
+        throw std::runtime_error{"Lanczos method requires a square matrix."};
+    }
+    if (count < 1 || count > n) {
+        throw std::runtime_error{"Cannot compute more eigenpairs than the matrix has rows."};
+    }
+    if (iterations <= 0) {
+        iterations = std::max(2 * count + 20, 4 * count);
+    }
+    iterations = std::min(iterations, n);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    // Found eigenvectors are locked and deflated from every following Krylov basis. A single start
+    // vector only finds one vector per distinct eigenvalue, e.g. disconnected graphs have 1 multiple times.
+    Eigen::MatrixXf locked(n, count);
+    Eigen::VectorXf locked_values(count);
+    int locked_count = 0;
+    Eigen::MatrixXf basis(n, iterations);
+    Eigen::VectorXf alpha(iterations);
+    Eigen::VectorXf beta(iterations);
+    const auto orthogonalize = [&](Eigen::VectorXf& w, const int basis_size) {
+        for (int pass = 0; pass < 2; ++pass) {
+            if (locked_count > 0) {
+                const Eigen::VectorXf projection = locked.leftCols(locked_count).transpose() * w;
+                w.noalias() -= locked.leftCols(locked_count) * projection;
+            }
+            const Eigen::VectorXf projection = basis.leftCols(basis_size).transpose() * w;
+            w.noalias() -= basis.leftCols(basis_size) * projection;
+        }
+    };
+    while (locked_count < count) {
+        const auto steps = std::min(iterations, n - locked_count);
+        Eigen::VectorXf w(n);
+        for (int i = 0; i < n; ++i) {
+            w(i) = uni(rng);
+        }
+        orthogonalize(w, 0);
+        basis.col(0) = w.normalized();
+        for (int j = 0; j < steps; ++j) {
+            w = m * basis.col(j);
+            alpha(j) = basis.col(j).dot(w);
+            orthogonalize(w, j + 1);
+            beta(j) = w.norm();
+            if (j + 1 == steps) {
+                break;
+            }
+            if (beta(j) < 1e-6f) {
+                // Invariant subspace found, continue with a new random direction. The tridiagonal matrix decouples.
+                beta(j) = 0.0f;
+                for (int i = 0; i < n; ++i) {
+                    w(i) = uni(rng);
+                }
+                orthogonalize(w, j + 1);
+                basis.col(j + 1) = w.normalized();
+            }
+            else {
+                basis.col(j + 1) = w / beta(j);
+            }
+        }
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXf> tridiagonal_solver;
+        const Eigen::VectorXf diag = alpha.head(steps);
+        const Eigen::VectorXf sub_diag = beta.head(steps - 1);
+        tridiagonal_solver.computeFromTridiagonal(diag, sub_diag, Eigen::ComputeEigenvectors);
+        const auto& ritz_values = tridiagonal_solver.eigenvalues();
+        const auto& ritz_vectors = tridiagonal_solver.eigenvectors();
+        // Only the largest Ritz pair is locked per restart, a converged smaller Ritz value can still hide
+        // a missing copy of a larger eigenvalue.
+        locked_values(locked_count) = ritz_values(steps - 1);
+        locked.col(locked_count) = (basis.leftCols(steps) * ritz_vectors.col(steps - 1)).normalized();
+        ++locked_count;
+    }
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&locked_values](const int a, const int b) {
+        return locked_values(a) > locked_values(b);
+    });
+    Eigenpairs res;
+    res.values.resize(count);
+    res.vectors.resize(n, count);
+    for (int i = 0; i < count; ++i) {
+        res.values(i) = locked_values(order.at(i));
+        res.vectors.col(i) = locked.col(order.at(i));
+    }
+    return res;
+}
@@ -0,0 +1,31 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+namespace tostf
+{
+    namespace math
+    {
+        using Sparse_matrix = Eigen::SparseMatrix<float, Eigen::RowMajor>;
+
+        struct Eigenpairs {
+            // Sorted in descending order, eigenvectors are stored column-wise.
+            Eigen::VectorXf values;
+            Eigen::MatrixXf vectors;
+        };
+
+        // Computes the count largest eigenpairs of a symmetric sparse matrix with the Lanczos method using full
+        // reorthogonalization. The method is restarted for every eigenpair and deflates the ones already found,
+        // iterations is the size of the Krylov basis (rows x iterations) per restart.
+        Eigenpairs lanczos_largest_eigenpairs(const Sparse_matrix& m, int count, int iterations = 0,
+                                              unsigned seed = 0);
+    }
+}
@@ -8,11 +8,49 @@
 #pragma once
 #include <numeric>
 #include <execution>
+#include <cfloat>
 
 namespace tostf
 {
     namespace math
     {
+        // Welford's running mean and variance together with min and max.
+        // Stats of separate ranges can be merged, the variance is the population variance like variance_seq.
+        struct Running_stats {
+            void add(const float value) {
+                ++count;
+                const auto delta = static_cast<double>(value) - mean;
+                mean += delta / static_cast<double>(count);
+                m2 += delta * (static_cast<double>(value) - mean);
+                min = value < min ? value : min;
+                max = value > max ? value : max;
+            }
+
+            void merge(const Running_stats& other) {
+                if (other.count == 0) {
+                    return;
+                }
+                const auto total = count + other.count;
+                const auto delta = other.mean - mean;
+                mean += delta * static_cast<double>(other.count) / static_cast<double>(total);
+                m2 += other.m2 + delta * delta * static_cast<double>(count) * static_cast<double>(other.count)
+                                 / static_cast<double>(total);
+                count = total;
+                min = other.min < min ? other.min : min;
+                max = other.max > max ? other.max : max;
+            }
+
+            double variance() const {
+                return count > 0 ? m2 / static_cast<double>(count) : 0.0;
+            }
+
+            size_t count = 0;
+            double mean = 0.0;
+            double m2 = 0.0;
+            float min = FLT_MAX;
+            float max = -FLT_MAX;
+        };
+
         template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
         T mean_seq(const std::vector<T>& values) {
             T res(0);
@@ -0,0 +1,25 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace tostf
+{
+    // The smaller vertex id is stored in the upper 32 bits, so both directions of an edge map to the same key
+    // and sorting the keys groups all faces sharing an edge.
+    inline uint64_t undirected_edge_key(const unsigned a, const unsigned b) {
+        return static_cast<uint64_t>(std::min(a, b)) << 32u | std::max(a, b);
+    }
+
+    inline std::pair<unsigned, unsigned> edge_key_vertices(const uint64_t key) {
+        return {static_cast<unsigned>(key >> 32u), static_cast<unsigned>(key)};
+    }
+}
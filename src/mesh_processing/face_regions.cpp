@@ -0,0 +1,99 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "face_regions.hpp"
+#include "edge_key.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+tostf::Disjoint_sets::Disjoint_sets(const unsigned count) : _parents(count) {
+    std::iota(_parents.begin(), _parents.end(), 0u);
+}
+
+unsigned tostf::Disjoint_sets::find(unsigned id) {
+    // Path halving keeps the trees flat without a second pass.
+    while (_parents.at(id) != id) {
+        _parents.at(id) = _parents.at(_parents.at(id));
+        id = _parents.at(id);
+    }
+    return id;
+}
+
+void tostf::Disjoint_sets::unite(const unsigned a, const unsigned b) {
+    const auto root_a = find(a);
+    const auto root_b = find(b);
+    if (root_a < root_b) {
+        _parents.at(root_b) = root_a;
+    }
+    else if (root_b < root_a) {
+        _parents.at(root_a) = root_b;
+    }
+}
+
+void tostf::Disjoint_sets::flatten() {
+    // Parents always have smaller ids, so they are already flattened when their children are visited.
+    for (unsigned i = 0; i < _parents.size(); ++i) {
+        _parents.at(i) = _parents.at(_parents.at(i));
+    }
+}
+
+const std::vector<unsigned>& tostf::Disjoint_sets::get_roots() const {
+    return _parents;
+}
+
+std::vector<int> tostf::label_face_regions(const std::vector<std::array<unsigned, 3>>& faces,
+                                           const std::vector<int>& face_classes) {
+    if (faces.size() != face_classes.size()) {
+        throw std::runtime_error{"Face classes do not match the faces."};
+    }
+    std::vector<unsigned> classified;
+    for (unsigned f = 0; f < faces.size(); ++f) {
+        if (face_classes.at(f) >= 0) {
+            classified.push_back(f);
+        }
+    }
+    const auto edge_count = static_cast<int>(classified.size() * 3);
+    std::vector<std::pair<uint64_t, unsigned>> edge_keys(edge_count);
+#pragma omp parallel for
+    for (int i = 0; i < edge_count; ++i) {
+        const auto f = classified.at(i / 3);
+        const auto a = faces.at(f).at(i % 3);
+        const auto b = faces.at(f).at((i + 1) % 3);
+        edge_keys.at(i) = {undirected_edge_key(a, b), f};
+    }
+    std::sort(std::execution::par, edge_keys.begin(), edge_keys.end());
+    Disjoint_sets regions(static_cast<unsigned>(faces.size()));
+    int run_start = 0;
+    for (int i = 1; i <= edge_count; ++i) {
+        if (i < edge_count && edge_keys.at(i).first == edge_keys.at(run_start).first) {
+            continue;
+        }
+        // Non-manifold edges connect all of their faces of the same class.
+        for (int j = run_start + 1; j < i; ++j) {
+            const auto face_class = face_classes.at(edge_keys.at(j).second);
+            for (int k = run_start; k < j; ++k) {
+                if (face_classes.at(edge_keys.at(k).second) == face_class) {
+                    regions.unite(edge_keys.at(k).second, edge_keys.at(j).second);
+                    break;
+                }
+            }
+        }
+        run_start = i;
+    }
+    regions.flatten();
+    const auto& roots = regions.get_roots();
+    std::vector<int> labels(faces.size());
+#pragma omp parallel for
+    for (int f = 0; f < static_cast<int>(faces.size()); ++f) {
+        labels.at(f) = face_classes.at(f) < 0 ? -1 : static_cast<int>(roots.at(f));
+    }
+    return labels;
+}
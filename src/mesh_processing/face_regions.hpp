@@ -0,0 +1,34 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+namespace tostf
+{
+    // Union-find over consecutive ids. The root of a set is always its smallest id,
+    // so the labels do not depend on the order of the unions.
+    class Disjoint_sets {
+    public:
+        explicit Disjoint_sets(unsigned count);
+        unsigned find(unsigned id);
+        void unite(unsigned a, unsigned b);
+        // Points every id directly to its root, afterwards find is a single lookup.
+        void flatten();
+        const std::vector<unsigned>& get_roots() const;
+    private:
+        std::vector<unsigned> _parents;
+    };
+
+    // Connected components of faces that share an edge and belong to the same class.
+    // Faces with a negative class are skipped and labeled -1, every other face is labeled with the smallest face id
+    // of its component. Only edges of classified faces are sorted, so sparse classes are cheap on large meshes.
+    std::vector<int> label_face_regions(const std::vector<std::array<unsigned, 3>>& faces,
+                                        const std::vector<int>& face_classes);
+}
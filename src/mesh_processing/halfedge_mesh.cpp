@@ -6,37 +6,100 @@
 //
 
 #include "halfedge_mesh.hpp"
+#include "edge_key.hpp"
 #include "math/vector_math.hpp"
+#include "utility/logging.hpp"
 #include <utility>
 #include <algorithm>
-#include <set>
+#include <execution>
+#include <numeric>
 
 tostf::Halfedge_mesh::Halfedge_mesh(std::shared_ptr<Geometry> geometry) : _geometry(std::move(geometry)) {
     build();
 }
 
 void tostf::Halfedge_mesh::build() {
-    _halfedges.resize(_geometry->indices.size());
-    const auto vertex_count = _geometry->vertices.size();
-    _vertices.resize(vertex_count);
-    _halfedge_map.resize(vertex_count);
-    const auto face_count = static_cast<int>(_halfedges.size());
-    for (int i = 0; i < face_count; i++) {
-        const int a = _geometry->indices.at(i);
-        const int next_i = 3 * (i / 3) + (i + 1) % 3;
-        const int b = _geometry->indices.at(next_i);
-        _halfedge_map.at(a).push_back(i);
-        _halfedges.at(i).id = i;
+    const auto halfedge_count = static_cast<int>(_geometry->indices.size());
+    const auto vertex_count = static_cast<int>(_geometry->vertices.size());
+    _halfedges.assign(halfedge_count, Halfedge{});
+    _vertices.assign(vertex_count, Halfedge_vertex{});
+    _non_manifold_edges.clear();
+    _boundaries.reset();
+    std::vector<std::pair<uint64_t, unsigned>> edge_keys(halfedge_count);
+#pragma omp parallel for
+    for (int i = 0; i < halfedge_count; i++) {
+        const auto a = _geometry->indices.at(i);
+        const auto b = _geometry->indices.at(3 * (i / 3) + (i + 1) % 3);
+        _halfedges.at(i).id = static_cast<unsigned>(i);
         _halfedges.at(i).vertex_ref = b;
+        edge_keys.at(i) = {undirected_edge_key(a, b), static_cast<unsigned>(i)};
+    }
+    std::sort(std::execution::par, edge_keys.begin(), edge_keys.end());
+    std::vector<unsigned char> non_manifold(halfedge_count, 0);
+#pragma omp parallel for
+    for (int i = 0; i < halfedge_count; i++) {
+        if (i > 0 && edge_keys.at(i - 1).first == edge_keys.at(i).first) {
+            continue;
+        }
+        int run_end = i + 1;
+        while (run_end < halfedge_count && edge_keys.at(run_end).first == edge_keys.at(i).first) {
+            ++run_end;
+        }
+        if (run_end - i == 1) {
+            continue;
+        }
+        const auto he_a = edge_keys.at(i).second;
+        const auto he_b = edge_keys.at(i + 1).second;
+        if (run_end - i == 2 && _halfedges.at(he_a).vertex_ref != _halfedges.at(he_b).vertex_ref) {
+            _halfedges.at(he_a).opposite = static_cast<int>(he_b);
+            _halfedges.at(he_b).opposite = static_cast<int>(he_a);
+        }
+        else {
+            non_manifold.at(i) = 1;
+        }
+    }
+    for (int i = 0; i < halfedge_count; i++) {
+        if (non_manifold.at(i) != 0) {
+            _non_manifold_edges.push_back(edge_key_vertices(edge_keys.at(i).first));
+        }
+    }
+    if (!_non_manifold_edges.empty()) {
+        log_warning() << "Mesh contains " << _non_manifold_edges.size()
+            << " non-manifold edges, their halfedges are treated as boundary.";
+    }
+    // Counting sort of the halfedges by their source vertex keeps them ordered by id per vertex.
+    _outgoing_offsets.assign(vertex_count + 1, 0);
+    for (int i = 0; i < halfedge_count; i++) {
+        ++_outgoing_offsets.at(_geometry->indices.at(i) + 1);
+    }
+    for (int v = 0; v < vertex_count; v++) {
+        _outgoing_offsets.at(v + 1) += _outgoing_offsets.at(v);
+    }
+    _outgoing.resize(halfedge_count);
+    std::vector<unsigned> fill(_outgoing_offsets.begin(), _outgoing_offsets.end() - 1);
+    for (int i = 0; i < halfedge_count; i++) {
+        const auto a = _geometry->indices.at(i);
+        _outgoing.at(fill.at(a)++) = static_cast<unsigned>(i);
         _vertices.at(a) = {i};
     }
-    for (int i = 0; i < face_count; i++) {
-        const auto v_b = _halfedges.at(i).vertex_ref;
-        for (int edge_from_a : _halfedge_map.at(v_b)) {
-            if (_halfedges.at(edge_from_a).vertex_ref == _geometry->indices.at(i)) {
-                _halfedges.at(i).opposite = edge_from_a;
+    // The boundary halfedge following one entering v leaves v at the other side of the same face fan. It is found by
+    // rotating around v through the faces, so loops stay separate even if several holes touch the same vertex.
+    _boundary_next.assign(halfedge_count, -1);
+#pragma omp parallel for
+    for (int i = 0; i < halfedge_count; i++) {
+        if (_halfedges.at(i).opposite != -1) {
+            continue;
+        }
+        const auto v = _halfedges.at(i).vertex_ref;
+        const auto max_steps = _outgoing_offsets.at(v + 1) - _outgoing_offsets.at(v);
+        auto out = _halfedges.at(i).next();
+        for (unsigned step = 0; step < max_steps; ++step) {
+            const auto opp = _halfedges.at(out).opposite;
+            if (opp == -1) {
+                _boundary_next.at(i) = out;
                 break;
             }
+            out = _halfedges.at(opp).next();
         }
     }
 }
@@ -45,93 +108,36 @@ std::vector<glm::vec4> tostf::Halfedge_mesh::calculate_normals() const {
     std::vector<glm::vec4> normals(_vertices.size());
 #pragma omp parallel for
     for (int i = 0; i < static_cast<int>(normals.size()); i++) {
-        const auto he_start = _vertices.at(i).halfedge_ref;
-        auto he_a = he_start;
-        glm::vec3 normal(0);
-        do {
-            const auto ab = _geometry->vertices.at(i) - _geometry->vertices.at(_halfedges.at(he_a).vertex_ref);
-            const auto he_b = _halfedges.at(he_a).next();
-            const auto ac = _geometry->vertices.at(i) - _geometry->vertices.at(_halfedges.at(he_b).vertex_ref);
-            const auto weight = glm::acos(dot(ab, ac) / (length(ab) * length(ac)));
-            const auto triangle_normal = math::calc_normal(_geometry->vertices.at(i),
-                                                           _geometry->vertices.at(_halfedges.at(he_a).vertex_ref),
-                                                           _geometry->vertices.at(_halfedges.at(he_b).vertex_ref));
-
-            const auto he_a_op = _halfedges.at(he_a).opposite;
-            normal += triangle_normal * 0.5f * weight;
-            if (he_a_op < 0) {
-                break;
-            }
-            he_a = _halfedges.at(he_a_op).next();
+        normals.at(i) = calculate_vertex_normal(i, _geometry->vertices);
+    }
+    return normals;
+}
+
+std::vector<glm::vec4> tostf::Halfedge_mesh::calculate_normals(const std::vector<glm::vec4>& moved_vertices,
+                                                               const std::vector<glm::vec4>& reference_normals) const {
+    if (moved_vertices.size() != _vertices.size() || reference_normals.size() != _vertices.size()) {
+        throw std::runtime_error{"Moved vertices or reference normals do not match the mesh."};
+    }
+    std::vector<unsigned char> moved(_vertices.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(moved.size()); i++) {
+        moved.at(i) = moved_vertices.at(i) != _geometry->vertices.at(i);
+    }
+    std::vector<glm::vec4> normals(_vertices.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(normals.size()); i++) {
+        bool affected = moved.at(i) != 0;
+        for (auto o = _outgoing_offsets.at(i); o < _outgoing_offsets.at(i + 1) && !affected; ++o) {
+            const auto& he = _halfedges.at(_outgoing.at(o));
+            affected = moved.at(he.vertex_ref) != 0 || moved.at(_halfedges.at(he.next()).vertex_ref) != 0;
         }
-        while (he_a != he_start && he_a > 0);
-        normals.at(i) = glm::vec4(normalize(normal), 0.0f);
+        normals.at(i) = affected ? calculate_vertex_normal(i, moved_vertices) : reference_normals.at(i);
     }
     return normals;
 }
 
-tostf::Mesh_stats tostf::Halfedge_mesh::calculate_mesh_stats() {
-    Mesh_stats stats;
-    const auto face_count = static_cast<int>(_halfedges.size());
-    for (int i = 0; i < face_count; i++) {
-        const auto he_a = i;
-        const auto v_a = _halfedges.at(he_a).vertex_ref;
-        const auto he_b = _halfedges.at(he_a).next();
-        const auto v_b = _halfedges.at(he_b).vertex_ref;
-        const auto he_c = _halfedges.at(he_b).next();
-        const auto v_c = _halfedges.at(he_c).vertex_ref;
-        const auto a = _geometry->vertices.at(v_a);
-        const auto b = _geometry->vertices.at(v_b);
-        const auto c = _geometry->vertices.at(v_c);
-        const auto ab = b - a;
-        const auto ac = a - c;
-        const auto bc = b - c;
-        const auto length_ab = length(ab);
-        const auto length_ac = length(ac);
-        const auto length_bc = length(bc);
-        // Volume calc http://chenlab.ece.cornell.edu/Publication/Cha/icip01_Cha.pdf
-        const auto v321 = c.x * b.y * a.z;
-        const auto v231 = b.x * c.y * a.z;
-        const auto v312 = c.x * a.y * b.z;
-        const auto v132 = a.x * c.y * b.z;
-        const auto v213 = b.x * a.y * c.z;
-        const auto v123 = a.x * b.y * c.z;
-        stats.volume += (1.0f / 6.0f) * (-v321 + v231 + v312 - v132 - v213 + v123);
-        // edge length
-        float edge_length = length_ab + length_ac + length_bc;
-        stats.edge_length.avg += edge_length;
-        if (stats.edge_length.min > length_ab) {
-            stats.edge_length.min = length_ab;
-        }
-        if (stats.edge_length.min > length_ac) {
-            stats.edge_length.min = length_ac;
-        }
-        if (stats.edge_length.min > length_bc) {
-            stats.edge_length.min = length_bc;
-        }
-        if (stats.edge_length.max < length_ab) {
-            stats.edge_length.max = length_ab;
-        }
-        if (stats.edge_length.max < length_ac) {
-            stats.edge_length.max = length_ac;
-        }
-        if (stats.edge_length.max < length_bc) {
-            stats.edge_length.max = length_bc;
-        }
-        // area calc
-        float area = glm::acos(dot(ab, ac) / (length_ab * length_ac));
-        stats.area.avg += area;
-        if (stats.area.min > area) {
-            stats.area.min = area;
-        }
-        if (stats.area.max < area) {
-            stats.area.max = area;
-        }
-    }
-    stats.edge_length.avg = stats.edge_length.avg / static_cast<float>(face_count * 3);
-    stats.area.avg = stats.area.avg / static_cast<float>(face_count);
-    stats.volume /= 3.0f;
-    return stats;
+tostf::Mesh_stats tostf::Halfedge_mesh::calculate_mesh_stats() const {
+    return tostf::calculate_mesh_stats(_geometry->vertices, _geometry->indices);
 }
 
 std::vector<glm::vec4> tostf::Halfedge_mesh::find_hard_edge_candidates() const {
@@ -167,6 +173,63 @@ std::vector<glm::vec4> tostf::Halfedge_mesh::find_hard_edge_candidates() const {
     return edge_points;
 }
 
+std::vector<unsigned char> tostf::Halfedge_mesh::find_feature_vertices(const float feature_angle) const {
+    const auto min_cos = glm::cos(glm::radians(feature_angle));
+    const auto halfedge_count = static_cast<int>(_halfedges.size());
+    std::vector<unsigned char> feature_edges(halfedge_count, 0);
+#pragma omp parallel for
+    for (int i = 0; i < halfedge_count; i++) {
+        const auto opp = _halfedges.at(i).opposite;
+        if (opp < 0) {
+            feature_edges.at(i) = 1;
+            continue;
+        }
+        if (opp < i) {
+            continue;
+        }
+        const auto face_normal = [this](const int he) {
+            const auto f = 3 * (he / 3);
+            return math::calc_normalized_normal(_geometry->vertices.at(_geometry->indices.at(f)),
+                                                _geometry->vertices.at(_geometry->indices.at(f + 1)),
+                                                _geometry->vertices.at(_geometry->indices.at(f + 2)));
+        };
+        feature_edges.at(i) = dot(face_normal(i), face_normal(opp)) < min_cos ? 1 : 0;
+    }
+    std::vector<unsigned char> features(_vertices.size(), 0);
+    for (int i = 0; i < halfedge_count; i++) {
+        if (feature_edges.at(i) != 0) {
+            features.at(_geometry->indices.at(i)) = 1;
+            features.at(_halfedges.at(i).vertex_ref) = 1;
+        }
+    }
+    return features;
+}
+
+glm::vec4 tostf::Halfedge_mesh::calculate_vertex_normal(const int vertex,
+                                                       const std::vector<glm::vec4>& positions) const {
+    const auto he_start = _vertices.at(vertex).halfedge_ref;
+    auto he_a = he_start;
+    glm::vec3 normal(0);
+    do {
+        const auto ab = positions.at(vertex) - positions.at(_halfedges.at(he_a).vertex_ref);
+        const auto he_b = _halfedges.at(he_a).next();
+        const auto ac = positions.at(vertex) - positions.at(_halfedges.at(he_b).vertex_ref);
+        const auto weight = glm::acos(dot(ab, ac) / (length(ab) * length(ac)));
+        const auto triangle_normal = math::calc_normal(positions.at(vertex),
+                                                       positions.at(_halfedges.at(he_a).vertex_ref),
+                                                       positions.at(_halfedges.at(he_b).vertex_ref));
+
+        const auto he_a_op = _halfedges.at(he_a).opposite;
+        normal += triangle_normal * 0.5f * weight;
+        if (he_a_op < 0) {
+            break;
+        }
+        he_a = _halfedges.at(he_a_op).next();
+    }
+    while (he_a != he_start && he_a > 0);
+    return glm::vec4(normalize(normal), 0.0f);
+}
+
 std::shared_ptr<tostf::Geometry> tostf::Halfedge_mesh::get_geometry() const {
     return _geometry;
 }
@@ -207,42 +270,136 @@ std::vector<unsigned> tostf::Halfedge_mesh::compute_one_ring_neighborhood_faces(
 }
 
 void tostf::Halfedge_mesh::find_boundaries() {
-    _boundaries = std::vector<std::vector<unsigned>>();
-    std::set<unsigned> boundary_candidates;
-    unsigned boundary_id = 0;
+    std::vector<unsigned> boundary_halfedges;
     for (int i = 0; i < static_cast<int>(_halfedges.size()); ++i) {
-        const auto he = _halfedges.at(i);
-        if (he.opposite == -1) {
-            const auto res = boundary_candidates.emplace(i);
-            if (res.second) {
-                _boundaries->push_back({he.vertex_ref});
-                int next_he = i;
-                while ((next_he = find_adjacent_boundary_candidate(_halfedges.at(next_he).vertex_ref)) != -1
-                       && next_he != i) {
-                    const auto res_candidate = boundary_candidates.emplace(next_he);
-                    if (res_candidate.second) {
-                        _boundaries->at(boundary_id).push_back(_halfedges.at(next_he).vertex_ref);
-                    }
-                }
-                ++boundary_id;
+        if (_halfedges.at(i).opposite == -1) {
+            boundary_halfedges.push_back(static_cast<unsigned>(i));
+        }
+    }
+    const auto boundary_count = static_cast<int>(boundary_halfedges.size());
+    // Loops are traversed on positions in boundary_halfedges, which is sorted by halfedge id.
+    std::vector<int> next_pos(boundary_count, -1);
+#pragma omp parallel for
+    for (int i = 0; i < boundary_count; ++i) {
+        const auto next_he = _boundary_next.at(boundary_halfedges.at(i));
+        if (next_he >= 0) {
+            next_pos.at(i) = static_cast<int>(std::lower_bound(boundary_halfedges.begin(), boundary_halfedges.end(),
+                                                               static_cast<unsigned>(next_he))
+                                              - boundary_halfedges.begin());
+        }
+    }
+    // At non-manifold vertices several boundary halfedges can share a successor. The predecessors are counted
+    // serially and shared successors are cut off from all of them, so the chains meeting there stay open
+    // and next_pos and prev_pos remain inverse to each other.
+    std::vector<int> prev_pos(boundary_count, -1);
+    std::vector<int> prev_count(boundary_count, 0);
+    for (int i = 0; i < boundary_count; ++i) {
+        if (next_pos.at(i) >= 0) {
+            prev_pos.at(next_pos.at(i)) = i;
+            prev_count.at(next_pos.at(i))++;
+        }
+    }
+    for (int i = 0; i < boundary_count; ++i) {
+        if (next_pos.at(i) >= 0 && prev_count.at(next_pos.at(i)) > 1) {
+            prev_pos.at(next_pos.at(i)) = -1;
+            next_pos.at(i) = -1;
+        }
+    }
+    // Pointer jumping in both directions labels every halfedge with the smallest position of its loop
+    // after log2(boundary_count) rounds.
+    std::vector<int> labels(boundary_count);
+    std::iota(labels.begin(), labels.end(), 0);
+    auto fwd = next_pos;
+    auto bwd = prev_pos;
+    std::vector<int> new_labels(boundary_count);
+    std::vector<int> new_fwd(boundary_count);
+    std::vector<int> new_bwd(boundary_count);
+    for (int span = 1; span < boundary_count; span *= 2) {
+#pragma omp parallel for
+        for (int i = 0; i < boundary_count; ++i) {
+            auto label = labels.at(i);
+            if (fwd.at(i) >= 0) {
+                label = glm::min(label, labels.at(fwd.at(i)));
+            }
+            if (bwd.at(i) >= 0) {
+                label = glm::min(label, labels.at(bwd.at(i)));
             }
+            new_labels.at(i) = label;
+            new_fwd.at(i) = fwd.at(i) >= 0 ? fwd.at(fwd.at(i)) : -1;
+            new_bwd.at(i) = bwd.at(i) >= 0 ? bwd.at(bwd.at(i)) : -1;
         }
+        std::swap(labels, new_labels);
+        std::swap(fwd, new_fwd);
+        std::swap(bwd, new_bwd);
     }
-}
-
-int tostf::Halfedge_mesh::find_adjacent_boundary_candidate(const unsigned next_vertex) {
-    if (next_vertex >= _halfedge_map.size()) {
-        return -1;
+    std::vector<int> roots;
+    for (int i = 0; i < boundary_count; ++i) {
+        if (labels.at(i) == i) {
+            roots.push_back(i);
+        }
     }
-    for (auto he : _halfedge_map.at(next_vertex)) {
-        if (_halfedges.at(he).opposite == -1) {
-            return he;
+    _boundaries = std::vector<Boundary_loop>(roots.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int l = 0; l < static_cast<int>(roots.size()); ++l) {
+        auto& loop = _boundaries->at(l);
+        // Loops start at their smallest halfedge, open chains at their first one.
+        auto start = roots.at(l);
+        auto pos = start;
+        while (next_pos.at(pos) >= 0 && next_pos.at(pos) != start) {
+            pos = next_pos.at(pos);
+        }
+        loop.closed = next_pos.at(pos) == start;
+        if (!loop.closed) {
+            while (prev_pos.at(start) >= 0) {
+                start = prev_pos.at(start);
+            }
+        }
+        pos = start;
+        std::vector<glm::vec4> points;
+        do {
+            loop.vertices.push_back(_halfedges.at(boundary_halfedges.at(pos)).vertex_ref);
+            points.push_back(_geometry->vertices.at(loop.vertices.back()));
+            pos = next_pos.at(pos);
+        }
+        while (pos >= 0 && pos != start);
+        const auto point_count = static_cast<int>(points.size());
+        for (int i = 0; i + 1 < point_count; ++i) {
+            loop.perimeter += distance(glm::vec3(points.at(i)), glm::vec3(points.at(i + 1)));
+        }
+        if (loop.closed && point_count > 1) {
+            loop.perimeter += distance(glm::vec3(points.back()), glm::vec3(points.front()));
+        }
+        if (point_count < 3) {
+            loop.plane.center = points.front();
+            continue;
+        }
+        loop.plane = find_plane(points);
+        float squared_plane_dist = 0.0f;
+        for (const auto& p : points) {
+            const auto rel = glm::vec3(p - loop.plane.center);
+            loop.radius = glm::max(loop.radius, length(rel));
+            squared_plane_dist += glm::pow(dot(rel, glm::vec3(loop.plane.normal)), 2.0f);
+        }
+        if (loop.radius > 0.0f) {
+            loop.planarity = glm::sqrt(squared_plane_dist / static_cast<float>(point_count)) / loop.radius;
         }
     }
-    return -1;
+}
+
+const std::vector<std::pair<unsigned, unsigned>>& tostf::Halfedge_mesh::get_non_manifold_edges() const {
+    return _non_manifold_edges;
 }
 
 std::vector<std::vector<unsigned>> tostf::Halfedge_mesh::get_boundaries() {
+    const auto& loops = get_boundary_loops();
+    std::vector<std::vector<unsigned>> boundaries(loops.size());
+    for (int i = 0; i < static_cast<int>(loops.size()); ++i) {
+        boundaries.at(i) = loops.at(i).vertices;
+    }
+    return boundaries;
+}
+
+const std::vector<tostf::Boundary_loop>& tostf::Halfedge_mesh::get_boundary_loops() {
     if (!_boundaries) {
         find_boundaries();
     }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "geometry/geometry.hpp"
+#include "data_processing/plane_fitting.hpp"
 
 namespace tostf {
     struct Halfedge {
@@ -27,24 +28,52 @@ namespace tostf {
     };
 
 
+    struct Boundary_loop {
+        // Target vertices of the boundary halfedges in walking order.
+        std::vector<unsigned> vertices;
+        Plane plane;
+        float perimeter = 0.0f;
+        // Largest distance of a vertex to the plane center.
+        float radius = 0.0f;
+        // Root mean square distance of the vertices to the plane relative to the radius, 0 for planar loops.
+        float planarity = 0.0f;
+        // Open chains only occur at inconsistently oriented faces.
+        bool closed = true;
+    };
+
     class Halfedge_mesh {
     public:
         explicit Halfedge_mesh(std::shared_ptr<Geometry> geometry);
         void build();
         std::vector<glm::vec4> calculate_normals() const;
+        // Normals for the same connectivity with moved vertex positions. Only vertices with a moved vertex in their
+        // one-ring are recalculated, the normals of all others are copied from reference_normals.
+        std::vector<glm::vec4> calculate_normals(const std::vector<glm::vec4>& moved_vertices,
+                                                 const std::vector<glm::vec4>& reference_normals) const;
         std::vector<glm::vec4> find_hard_edge_candidates() const;
-        Mesh_stats calculate_mesh_stats();
+        // Marks the vertices of boundary and non-manifold edges and of edges whose faces enclose more than
+        // feature_angle degrees.
+        std::vector<unsigned char> find_feature_vertices(float feature_angle) const;
+        Mesh_stats calculate_mesh_stats() const;
         std::shared_ptr<Geometry> get_geometry() const;
         Geometry_view compute_one_ring_neighborhood(unsigned vertex_id);
         std::vector<unsigned> compute_one_ring_neighborhood_faces(unsigned vertex_id);
         void find_boundaries();
-        int find_adjacent_boundary_candidate(unsigned next_vertex);
         std::vector<std::vector<unsigned>> get_boundaries();
+        const std::vector<Boundary_loop>& get_boundary_loops();
+        // Edges shared by more than two faces or by two faces with the same orientation. They are left unpaired.
+        const std::vector<std::pair<unsigned, unsigned>>& get_non_manifold_edges() const;
     private:
         std::shared_ptr<Geometry> _geometry;
         std::vector<Halfedge> _halfedges;
         std::vector<Halfedge_vertex> _vertices;
-        std::vector<std::vector<unsigned>> _halfedge_map;
-        std::optional<std::vector<std::vector<unsigned>>> _boundaries;
+        // Outgoing halfedges of vertex v are _outgoing[_outgoing_offsets[v]] to _outgoing[_outgoing_offsets[v + 1]].
+        std::vector<unsigned> _outgoing_offsets;
+        std::vector<unsigned> _outgoing;
+        std::vector<std::pair<unsigned, unsigned>> _non_manifold_edges;
+        // Following boundary halfedge of every boundary halfedge, -1 for inner halfedges and the ends of open chains.
+        std::vector<int> _boundary_next;
+        std::optional<std::vector<Boundary_loop>> _boundaries;
+        glm::vec4 calculate_vertex_normal(int vertex, const std::vector<glm::vec4>& positions) const;
     };
 }
@@ -11,9 +11,9 @@
 #include "math/vector_math.hpp"
 
 tostf::Tri_face_mesh::Tri_face_mesh(std::shared_ptr<Geometry> geom) : _geometry(std::move(geom)) {
-    face_indices.resize(_geometry->count() / 3);
-    face_normals.resize(_geometry->count() / 3);
-    face_centers.resize(_geometry->count() / 3);
+    _face_indices.resize(_geometry->count() / 3);
+    _face_normals.resize(_geometry->count() / 3);
+    _face_centers.resize(_geometry->count() / 3);
 #pragma omp parallel for
     for (int i = 0; i < static_cast<int>(_geometry->count() / 3); i++) {
         const auto j = static_cast<unsigned>(i * 3);
@@ -24,129 +24,95 @@ tostf::Tri_face_mesh::Tri_face_mesh(std::shared_ptr<Geometry> geom) : _geometry(
         const auto ac = a - c;
         const auto face_normal = glm::vec4(normalize(cross(glm::vec3(ab), glm::vec3(ac))), 0.0f);
         const auto face_center = (a + b + c) / 3.0f;
-        face_indices.at(i) = {
+        _face_indices.at(i) = {
             _geometry->indices.at(j), _geometry->indices.at(j + 1), _geometry->indices.at(j + 2),
         };
-        face_normals.at(i) = face_normal;
-        face_centers.at(i) = face_center;
+        _face_normals.at(i) = face_normal;
+        _face_centers.at(i) = face_center;
     }
+    build_face_index();
+}
+
+void tostf::Tri_face_mesh::build_face_index() {
+    _alive.assign(_face_indices.size(), 1);
+    _dead_count = 0;
+    _face_ids.clear();
+    _face_ids.reserve(_face_indices.size());
+    // Duplicate faces of the input geometry are dead from the start, so every alive face is in the index.
+    for (unsigned i = 0; i < _face_indices.size(); ++i) {
+        if (!_face_ids.try_emplace(canonical_face(_face_indices.at(i)), i).second) {
+            _alive.at(i) = 0;
+            ++_dead_count;
+        }
+    }
+    compact();
 }
 
 std::shared_ptr<tostf::Mesh> tostf::Tri_face_mesh::to_mesh() {
+    compact();
     auto m = std::make_shared<Mesh>();
-    m->indices.resize(face_indices.size() * 3);
+    m->indices.resize(_face_indices.size() * 3);
 #pragma omp parallel for
     for (int i = 0; i < static_cast<int>(m->indices.size()); i++) {
         m->indices.at(i) = i;
     }
-    m->vertices.resize(face_indices.size() * 3);
+    m->vertices.resize(_face_indices.size() * 3);
 #pragma omp parallel for
-    for (int i = 0; i < static_cast<int>(face_indices.size()); i++) {
-        m->vertices.at(i * 3) = _geometry->vertices.at(face_indices.at(i).at(0));
-        m->vertices.at(i * 3 + 1) = _geometry->vertices.at(face_indices.at(i).at(1));
-        m->vertices.at(i * 3 + 2) = _geometry->vertices.at(face_indices.at(i).at(2));
+    for (int i = 0; i < static_cast<int>(_face_indices.size()); i++) {
+        m->vertices.at(i * 3) = _geometry->vertices.at(_face_indices.at(i).at(0));
+        m->vertices.at(i * 3 + 1) = _geometry->vertices.at(_face_indices.at(i).at(1));
+        m->vertices.at(i * 3 + 2) = _geometry->vertices.at(_face_indices.at(i).at(2));
     }
     return m;
 }
 
 std::vector<unsigned> tostf::Tri_face_mesh::get_indices() {
-    std::vector<unsigned> indices(face_indices.size() * 3);
+    compact();
+    std::vector<unsigned> indices(_face_indices.size() * 3);
 #pragma omp parallel for
-    for (int i = 0; i < static_cast<int>(face_indices.size()); i++) {
-        indices.at(i * 3) = face_indices.at(i).at(0);
-        indices.at(i * 3 + 1) = face_indices.at(i).at(1);
-        indices.at(i * 3 + 2) = face_indices.at(i).at(2);
+    for (int i = 0; i < static_cast<int>(_face_indices.size()); i++) {
+        indices.at(i * 3) = _face_indices.at(i).at(0);
+        indices.at(i * 3 + 1) = _face_indices.at(i).at(1);
+        indices.at(i * 3 + 2) = _face_indices.at(i).at(2);
     }
     return indices;
 }
 
 std::vector<std::array<unsigned, 3>> tostf::Tri_face_mesh::get_index_tuples() const {
-    return face_indices;
-}
-
-tostf::Mesh_stats tostf::Tri_face_mesh::calculate_mesh_stats() {
-    Mesh_stats stats{};
-    const auto face_count = static_cast<int>(face_indices.size());
-    for (int i = 0; i < face_count; i++) {
-        const auto face = face_indices.at(i);
-        const auto v_a = face.at(0);
-        const auto v_b = face.at(1);
-        const auto v_c = face.at(2);
-        const auto a = _geometry->vertices.at(v_a);
-        const auto b = _geometry->vertices.at(v_b);
-        const auto c = _geometry->vertices.at(v_c);
-        const auto ab = b - a;
-        const auto ac = a - c;
-        const auto bc = b - c;
-        const auto length_ab = length(ab);
-        const auto length_ac = length(ac);
-        const auto length_bc = length(bc);
-        // Volume calc http://chenlab.ece.cornell.edu/Publication/Cha/icip01_Cha.pdf
-        const auto v321 = c.x * b.y * a.z;
-        const auto v231 = b.x * c.y * a.z;
-        const auto v312 = c.x * a.y * b.z;
-        const auto v132 = a.x * c.y * b.z;
-        const auto v213 = b.x * a.y * c.z;
-        const auto v123 = a.x * b.y * c.z;
-        stats.volume += (1.0f / 6.0f) * (-v321 + v231 + v312 - v132 - v213 + v123);
-        // edge length
-        float edge_length = length_ab + length_ac + length_bc;
-        stats.edge_length.avg += edge_length;
-        if (stats.edge_length.min > length_ab) {
-            stats.edge_length.min = length_ab;
-        }
-        if (stats.edge_length.min > length_ac) {
-            stats.edge_length.min = length_ac;
-        }
-        if (stats.edge_length.min > length_bc) {
-            stats.edge_length.min = length_bc;
-        }
-        if (stats.edge_length.max < length_ab) {
-            stats.edge_length.max = length_ab;
-        }
-        if (stats.edge_length.max < length_ac) {
-            stats.edge_length.max = length_ac;
-        }
-        if (stats.edge_length.max < length_bc) {
-            stats.edge_length.max = length_bc;
-        }
-        // area calc
-        float area = glm::acos(dot(ab, ac) / (length_ab * length_ac));
-        stats.area.avg += area;
-        if (stats.area.min > area) {
-            stats.area.min = area;
-        }
-        if (stats.area.max < area) {
-            stats.area.max = area;
+    if (_dead_count == 0) {
+        return _face_indices;
+    }
+    std::vector<std::array<unsigned, 3>> tuples;
+    tuples.reserve(face_count());
+    for (unsigned i = 0; i < _face_indices.size(); ++i) {
+        if (is_alive(i)) {
+            tuples.push_back(_face_indices.at(i));
         }
     }
-    stats.edge_length.avg = stats.edge_length.avg / static_cast<float>(face_count * 3);
-    stats.area.avg = stats.area.avg / static_cast<float>(face_count);
-    return stats;
+    return tuples;
 }
 
-inline bool operator==(const std::array<unsigned, 3>& f1, const std::array<unsigned, 3>& f2) {
-    return f1.at(0) == f2.at(0) && f1.at(1) == f2.at(1) && f1.at(2) == f2.at(2)
-           || f1.at(0) == f2.at(1) && f1.at(1) == f2.at(2) && f1.at(2) == f2.at(0)
-           || f1.at(0) == f2.at(2) && f1.at(1) == f2.at(0) && f1.at(2) == f2.at(1);
+tostf::Mesh_stats tostf::Tri_face_mesh::calculate_mesh_stats() {
+    return tostf::calculate_mesh_stats(_geometry->vertices, get_indices());
 }
 
 bool tostf::Tri_face_mesh::add_face(const std::array<unsigned, 3>& face) {
-    if (std::find(face_indices.begin(), face_indices.end(), face) == face_indices.end()) {
-        face_indices.push_back(face);
-        const auto face_normal = math::calc_normalized_normal(_geometry->vertices.at(face.at(0)),
-                                                              _geometry->vertices.at(face.at(1)),
-                                                              _geometry->vertices.at(face.at(2)));
-        const auto face_center = math::calc_center({
-            _geometry->vertices.at(face.at(0)),
-            _geometry->vertices.at(face.at(1)),
-            _geometry->vertices.at(face.at(2))
-        });
-        face_normals.emplace_back(face_normal, 0.0f);
-        face_centers.push_back(face_center);
-        return true;
-    }
-    return false;
+    if (!_face_ids.try_emplace(canonical_face(face), static_cast<unsigned>(_face_indices.size())).second) {
+        return false;
+    }
+    _face_indices.push_back(face);
+    const auto face_normal = math::calc_normalized_normal(_geometry->vertices.at(face.at(0)),
+                                                          _geometry->vertices.at(face.at(1)),
+                                                          _geometry->vertices.at(face.at(2)));
+    const auto face_center = math::calc_center({
+        _geometry->vertices.at(face.at(0)),
+        _geometry->vertices.at(face.at(1)),
+        _geometry->vertices.at(face.at(2))
+    });
+    _face_normals.emplace_back(face_normal, 0.0f);
+    _face_centers.push_back(face_center);
+    _alive.push_back(1);
+    return true;
 }
 
 void tostf::Tri_face_mesh::add_faces(const std::vector<std::array<unsigned, 3>>& faces) {
@@ -162,49 +128,116 @@ void tostf::Tri_face_mesh::add_faces(const std::vector<std::array<unsigned, 3>>&
         normals.at(i) = glm::vec4(face_normal, 0.0f);
         centers.at(i) = face_center;
     }
-    face_indices.insert(face_indices.end(), faces.begin(), faces.end());
-    face_normals.insert(face_normals.end(), normals.begin(), normals.end());
-    face_centers.insert(face_centers.end(), centers.begin(), centers.end());
+    _face_indices.reserve(_face_indices.size() + faces.size());
+    _face_normals.reserve(_face_normals.size() + faces.size());
+    _face_centers.reserve(_face_centers.size() + faces.size());
+    for (unsigned i = 0; i < faces.size(); ++i) {
+        if (_face_ids.try_emplace(canonical_face(faces.at(i)), static_cast<unsigned>(_face_indices.size())).second) {
+            _face_indices.push_back(faces.at(i));
+            _face_normals.push_back(normals.at(i));
+            _face_centers.push_back(centers.at(i));
+            _alive.push_back(1);
+        }
+    }
 }
 
 void tostf::Tri_face_mesh::add_faces(const std::vector<unsigned>& faces) {
     std::vector<std::array<unsigned, 3>> indices(faces.size() / 3);
-    std::vector<glm::vec4> normals(faces.size() / 3);
-    std::vector<glm::vec4> centers(faces.size() / 3);
 #pragma omp parallel for
-    for (int i = 0; i < static_cast<int>(faces.size() / 3); i++) {
+    for (int i = 0; i < static_cast<int>(indices.size()); i++) {
         indices.at(i) = {faces.at(i * 3 + 0), faces.at(i * 3 + 1), faces.at(i * 3 + 2)};
-        auto a = _geometry->vertices.at(faces.at(i * 3 + 0));
-        auto b = _geometry->vertices.at(faces.at(i * 3 + 1));
-        auto c = _geometry->vertices.at(faces.at(i * 3 + 2));
-        const auto face_normal = math::calc_normalized_normal(a, b, c);
-        const auto face_center = math::calc_center({a, b, c});
-        normals.at(i) = glm::vec4(face_normal, 0.0f);
-        centers.at(i) = face_center;
     }
-    face_indices.insert(face_indices.end(), indices.begin(), indices.end());
-    face_normals.insert(face_normals.end(), normals.begin(), normals.end());
-    face_centers.insert(face_centers.end(), centers.begin(), centers.end());
+    add_faces(indices);
 }
 
 void tostf::Tri_face_mesh::remove_face(const std::array<unsigned, 3>& index_triple) {
-    const auto del_it = std::find(face_indices.begin(), face_indices.end(), index_triple);
-    if (del_it != face_indices.end()) {
-        const auto dist = std::distance(face_indices.begin(), del_it);
-        face_indices.erase(del_it);
-        face_normals.erase(face_normals.begin() + dist);
-        face_centers.erase(face_centers.begin() + dist);
-    }
+    remove_faces({index_triple});
 }
 
 void tostf::Tri_face_mesh::remove_faces(const std::vector<std::array<unsigned, 3>>& del_faces) {
-    for (auto& f : del_faces) {
-        remove_face(f);
+    std::vector<int> del_ids(del_faces.size(), -1);
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(del_faces.size()); i++) {
+        const auto it = _face_ids.find(canonical_face(del_faces.at(i)));
+        if (it != _face_ids.end()) {
+            del_ids.at(i) = static_cast<int>(it->second);
+        }
+    }
+    for (unsigned i = 0; i < del_ids.size(); ++i) {
+        if (del_ids.at(i) < 0 || !is_alive(static_cast<unsigned>(del_ids.at(i)))) {
+            continue;
+        }
+        _alive.at(del_ids.at(i)) = 0;
+        _face_ids.erase(canonical_face(del_faces.at(i)));
+        ++_dead_count;
     }
+    if (4 * _dead_count > _face_indices.size()) {
+        compact();
+    }
+}
+
+bool tostf::Tri_face_mesh::has_face(const std::array<unsigned, 3>& index_triple) const {
+    return _face_ids.find(canonical_face(index_triple)) != _face_ids.end();
+}
+
+int tostf::Tri_face_mesh::find_face(const std::array<unsigned, 3>& index_triple) {
+    compact();
+    const auto it = _face_ids.find(canonical_face(index_triple));
+    return it != _face_ids.end() ? static_cast<int>(it->second) : -1;
+}
+
+bool tostf::Tri_face_mesh::is_alive(const unsigned face_id) const {
+    return _alive.at(face_id) != 0;
+}
+
+size_t tostf::Tri_face_mesh::face_count() const {
+    return _face_indices.size() - _dead_count;
+}
+
+void tostf::Tri_face_mesh::compact() {
+    if (_dead_count == 0) {
+        return;
+    }
+    std::vector<unsigned> new_ids(_face_indices.size());
+    unsigned live_count = 0;
+    for (unsigned i = 0; i < _face_indices.size(); ++i) {
+        new_ids.at(i) = live_count;
+        live_count += _alive.at(i);
+    }
+    std::vector<std::array<unsigned, 3>> indices(live_count);
+    std::vector<glm::vec4> normals(live_count);
+    std::vector<glm::vec4> centers(live_count);
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(_face_indices.size()); i++) {
+        if (_alive.at(i) != 0) {
+            indices.at(new_ids.at(i)) = _face_indices.at(i);
+            normals.at(new_ids.at(i)) = _face_normals.at(i);
+            centers.at(new_ids.at(i)) = _face_centers.at(i);
+        }
+    }
+    for (auto& [face, id] : _face_ids) {
+        id = new_ids.at(id);
+    }
+    _face_indices = std::move(indices);
+    _face_normals = std::move(normals);
+    _face_centers = std::move(centers);
+    _alive.assign(live_count, 1);
+    _dead_count = 0;
+}
+
+const std::vector<std::array<unsigned, 3>>& tostf::Tri_face_mesh::get_face_indices() {
+    compact();
+    return _face_indices;
+}
+
+const std::vector<glm::vec4>& tostf::Tri_face_mesh::get_face_normals() {
+    compact();
+    return _face_normals;
 }
 
-bool tostf::Tri_face_mesh::has_face(const std::array<unsigned, 3>& index_triple) {
-    return std::find(face_indices.begin(), face_indices.end(), index_triple) != face_indices.end();
+const std::vector<glm::vec4>& tostf::Tri_face_mesh::get_face_centers() {
+    compact();
+    return _face_centers;
 }
 
 std::shared_ptr<tostf::Geometry> tostf::Tri_face_mesh::get_geometry() const {
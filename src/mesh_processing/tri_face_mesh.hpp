@@ -9,6 +9,8 @@
 
 #include "geometry/mesh.hpp"
 #include <array>
+#include <cstdint>
+#include <unordered_map>
 
 namespace tostf
 {
@@ -17,6 +19,29 @@ namespace tostf
         glm::vec4 pos;
     };
 
+    // Rotates the face so that its smallest index comes first, the orientation is kept.
+    inline std::array<unsigned, 3> canonical_face(const std::array<unsigned, 3>& face) {
+        if (face.at(1) < face.at(0) && face.at(1) <= face.at(2)) {
+            return {face.at(1), face.at(2), face.at(0)};
+        }
+        if (face.at(2) < face.at(0) && face.at(2) < face.at(1)) {
+            return {face.at(2), face.at(0), face.at(1)};
+        }
+        return face;
+    }
+
+    struct Face_hash {
+        size_t operator()(const std::array<unsigned, 3>& face) const {
+            auto h = static_cast<uint64_t>(face.at(0)) * 0x9E3779B97F4A7C15ull;
+            h = (h ^ face.at(1)) * 0xBF58476D1CE4E5B9ull;
+            h = (h ^ face.at(2)) * 0x94D049BB133111EBull;
+            return static_cast<size_t>(h ^ (h >> 31u));
+        }
+    };
+
+    // Faces are indexed by their canonical rotation, duplicate faces of the input geometry are dropped. Removed faces
+    // are marked dead and the face arrays are compacted once a quarter of them is dead or the faces are requested,
+    // so the face ids of the getters and find_face always refer to alive faces only.
     class Tri_face_mesh {
     public:
         Tri_face_mesh() = default;
@@ -30,13 +55,26 @@ namespace tostf
         void add_faces(const std::vector<unsigned>& faces);
         void remove_face(const std::array<unsigned, 3>& index_triple);
         void remove_faces(const std::vector<std::array<unsigned, 3>>& del_faces);
-        bool has_face(const std::array<unsigned, 3>& index_triple);
+        bool has_face(const std::array<unsigned, 3>& index_triple) const;
+        // Id of the face in get_face_indices, -1 if the mesh does not hold it.
+        int find_face(const std::array<unsigned, 3>& index_triple);
+        size_t face_count() const;
+        void compact();
+        const std::vector<std::array<unsigned, 3>>& get_face_indices();
+        const std::vector<glm::vec4>& get_face_normals();
+        const std::vector<glm::vec4>& get_face_centers();
         std::shared_ptr<Geometry> get_geometry() const;
         void set_geometry(const std::shared_ptr<Geometry>& geom);
-        std::vector<std::array<unsigned, 3>> face_indices;
-        std::vector<glm::vec4> face_normals;
-        std::vector<glm::vec4> face_centers;
     private:
+        void build_face_index();
+        // Faces in _face_indices that were removed but not compacted yet are dead.
+        bool is_alive(unsigned face_id) const;
+        std::vector<std::array<unsigned, 3>> _face_indices;
+        std::vector<glm::vec4> _face_normals;
+        std::vector<glm::vec4> _face_centers;
         std::shared_ptr<Geometry> _geometry;
+        std::unordered_map<std::array<unsigned, 3>, unsigned, Face_hash> _face_ids;
+        std::vector<unsigned char> _alive;
+        size_t _dead_count = 0;
     };
 }
@@ -0,0 +1,281 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "decomposition_planner.hpp"
+#include "glm/gtx/component_wise.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <optional>
+#include <sstream>
+#include <utility>
+
+constexpr int voxelization_block_count = 64;
+
+struct Lumen_voxels {
+    glm::ivec3 resolution{1};
+    std::vector<glm::ivec3> coords;
+    // Voxels sorted along every axis, ties keep the order of coords.
+    std::array<std::vector<int>, 3> axis_orders;
+};
+
+struct Decomposition_result {
+    std::vector<size_t> voxels_per_subdomain;
+    size_t interface_faces = 0;
+    float imbalance = 1.0f;
+};
+
+double calc_edge_function(const glm::dvec2& u, const glm::dvec2& v, const glm::dvec2& p) {
+    return (v.x - u.x) * (p.y - u.y) - (v.y - u.y) * (p.x - u.x);
+}
+
+// Points on an edge belong to only one of the two counter-clockwise triangles sharing it,
+// because the triangles run along the edge in opposite directions.
+bool is_inside_edge(const double w, const glm::dvec2& u, const glm::dvec2& v) {
+    return w > 0.0 || (w == 0.0 && (v.y - u.y > 0.0 || (v.y == u.y && v.x - u.x < 0.0)));
+}
+
+Lumen_voxels voxelize_lumen(const std::vector<glm::vec4>& vertices, const std::vector<unsigned>& indices,
+                            const tostf::Bounding_box& domain, const float voxel_size) {
+    Lumen_voxels voxels;
+    const glm::dvec3 origin(domain.min);
+    voxels.resolution = glm::max(glm::ivec3(glm::ceil((glm::vec3(domain.max) - glm::vec3(domain.min)) / voxel_size)),
+                                 glm::ivec3(1));
+    const auto res = voxels.resolution;
+    // Rays along z through the centers of the voxel columns cross the closed surface an even number of times.
+    const auto face_count = static_cast<int>(indices.size() / 3);
+    std::vector<std::vector<std::pair<int, float>>> block_crossings(voxelization_block_count);
+#pragma omp parallel for
+    for (int block = 0; block < voxelization_block_count; ++block) {
+        const auto first = static_cast<int>(static_cast<int64_t>(face_count) * block / voxelization_block_count);
+        const auto last = static_cast<int>(static_cast<int64_t>(face_count) * (block + 1)
+                                           / voxelization_block_count);
+        auto& crossings = block_crossings.at(block);
+        for (int f = first; f < last; ++f) {
+            std::array<glm::dvec3, 3> corners{};
+            for (int i = 0; i < 3; ++i) {
+                corners.at(i) = (glm::dvec3(vertices.at(indices.at(f * 3 + i))) - origin)
+                                / static_cast<double>(voxel_size);
+            }
+            glm::dvec2 a(corners.at(0));
+            glm::dvec2 b(corners.at(1));
+            glm::dvec2 c(corners.at(2));
+            auto area = calc_edge_function(a, b, c);
+            if (area == 0.0) {
+                continue;
+            }
+            if (area < 0.0) {
+                std::swap(b, c);
+                std::swap(corners.at(1), corners.at(2));
+                area = -area;
+            }
+            const auto min_corner = glm::min(glm::min(a, b), c);
+            const auto max_corner = glm::max(glm::max(a, b), c);
+            const auto i_first = std::max(static_cast<int>(glm::ceil(min_corner.x - 0.5)), 0);
+            const auto i_last = std::min(static_cast<int>(glm::floor(max_corner.x - 0.5)), res.x - 1);
+            const auto j_first = std::max(static_cast<int>(glm::ceil(min_corner.y - 0.5)), 0);
+            const auto j_last = std::min(static_cast<int>(glm::floor(max_corner.y - 0.5)), res.y - 1);
+            for (int j = j_first; j <= j_last; ++j) {
+                for (int i = i_first; i <= i_last; ++i) {
+                    const glm::dvec2 p(i + 0.5, j + 0.5);
+                    const auto w_a = calc_edge_function(b, c, p);
+                    const auto w_b = calc_edge_function(c, a, p);
+                    const auto w_c = calc_edge_function(a, b, p);
+                    if (is_inside_edge(w_a, b, c) && is_inside_edge(w_b, c, a) && is_inside_edge(w_c, a, b)) {
+                        const auto z = (w_a * corners.at(0).z + w_b * corners.at(1).z + w_c * corners.at(2).z) / area;
+                        crossings.emplace_back(i + res.x * j, static_cast<float>(z));
+                    }
+                }
+            }
+        }
+    }
+    std::vector<std::pair<int, float>> crossings;
+    for (const auto& block : block_crossings) {
+        crossings.insert(crossings.end(), block.begin(), block.end());
+    }
+    std::sort(std::execution::par, crossings.begin(), crossings.end());
+    // Voxels between the first and second, third and fourth crossing of a column and so on are inside.
+    // An unpaired last crossing of an open surface is ignored.
+    for (size_t k = 0; k + 1 < crossings.size(); ++k) {
+        if (crossings.at(k).first != crossings.at(k + 1).first) {
+            continue;
+        }
+        const auto column = crossings.at(k).first;
+        const auto z_first = std::max(static_cast<int>(glm::ceil(crossings.at(k).second - 0.5f)), 0);
+        const auto z_last = std::min(static_cast<int>(glm::floor(crossings.at(k + 1).second - 0.5f)), res.z - 1);
+        for (int z = z_first; z <= z_last; ++z) {
+            voxels.coords.emplace_back(column % res.x, column / res.x, z);
+        }
+        ++k;
+    }
+    const auto voxel_count = static_cast<int>(voxels.coords.size());
+    for (int axis = 0; axis < 3; ++axis) {
+        std::vector<int> offsets(res[axis] + 1, 0);
+        for (const auto& c : voxels.coords) {
+            ++offsets.at(c[axis] + 1);
+        }
+        for (int i = 0; i < res[axis]; ++i) {
+            offsets.at(i + 1) += offsets.at(i);
+        }
+        auto& order = voxels.axis_orders.at(axis);
+        order.resize(voxel_count);
+        for (int v = 0; v < voxel_count; ++v) {
+            order.at(offsets.at(voxels.coords.at(v)[axis])++) = v;
+        }
+    }
+    return voxels;
+}
+
+// OpenFOAM's simple method sorts the cells along every axis independently and splits them into equally large
+// groups, the subdomain is the combination of the three groups.
+std::vector<int> assign_simple(const Lumen_voxels& voxels, const glm::ivec3& n) {
+    const auto voxel_count = voxels.coords.size();
+    std::array<std::vector<int>, 3> groups{};
+    for (int axis = 0; axis < 3; ++axis) {
+        groups.at(axis).resize(voxel_count);
+        for (size_t rank = 0; rank < voxel_count; ++rank) {
+            groups.at(axis).at(voxels.axis_orders.at(axis).at(rank)) = static_cast<int>(rank * n[axis] / voxel_count);
+        }
+    }
+    std::vector<int> subdomains(voxel_count);
+    for (size_t v = 0; v < voxel_count; ++v) {
+        subdomains.at(v) = groups.at(0).at(v) + n.x * (groups.at(1).at(v) + n.y * groups.at(2).at(v));
+    }
+    return subdomains;
+}
+
+// OpenFOAM's hierarchical method splits the cells along the first axis of the order into equally large groups,
+// then every group along the second axis and so on, which balances the cell counts.
+std::vector<int> assign_hierarchical(const Lumen_voxels& voxels, const glm::ivec3& n,
+                                     const std::array<int, 3>& order) {
+    std::vector<int> subdomains(voxels.coords.size(), 0);
+    int group_count = 1;
+    for (const auto axis : order) {
+        const auto parts = n[axis];
+        std::vector<size_t> group_sizes(group_count, 0);
+        for (const auto s : subdomains) {
+            ++group_sizes.at(s);
+        }
+        std::vector<size_t> group_ranks(group_count, 0);
+        for (const auto v : voxels.axis_orders.at(axis)) {
+            const auto group = subdomains.at(v);
+            const auto part = static_cast<int>(group_ranks.at(group)++ * parts / group_sizes.at(group));
+            subdomains.at(v) = group * parts + part;
+        }
+        group_count *= parts;
+    }
+    return subdomains;
+}
+
+Decomposition_result evaluate_decomposition(const Lumen_voxels& voxels, const std::vector<int>& subdomains,
+                                            const int subdomain_count, std::vector<int>& owner_grid) {
+    Decomposition_result result;
+    result.voxels_per_subdomain.resize(subdomain_count, 0);
+    const auto res = voxels.resolution;
+    for (size_t v = 0; v < voxels.coords.size(); ++v) {
+        const auto& c = voxels.coords.at(v);
+        owner_grid.at(c.x + res.x * (c.y + res.y * c.z)) = subdomains.at(v);
+        ++result.voxels_per_subdomain.at(subdomains.at(v));
+    }
+    const std::array<int, 3> strides{1, res.x, res.x * res.y};
+    for (size_t v = 0; v < voxels.coords.size(); ++v) {
+        const auto& c = voxels.coords.at(v);
+        const auto id = c.x + res.x * (c.y + res.y * c.z);
+        for (int axis = 0; axis < 3; ++axis) {
+            if (c[axis] + 1 < res[axis]) {
+                const auto neighbor = owner_grid.at(id + strides.at(axis));
+                result.interface_faces += neighbor >= 0 && neighbor != subdomains.at(v);
+            }
+        }
+    }
+    const auto max_voxels = *std::max_element(result.voxels_per_subdomain.begin(), result.voxels_per_subdomain.end());
+    result.imbalance = static_cast<float>(max_voxels) * subdomain_count / static_cast<float>(voxels.coords.size());
+    return result;
+}
+
+tostf::foam::Decomposition_plan tostf::foam::plan_decomposition(const std::vector<glm::vec4>& vertices,
+                                                                const std::vector<unsigned>& indices,
+                                                                const Bounding_box& domain, const float cell_size,
+                                                                const int max_sub_domains,
+                                                                const int min_cells_per_subdomain,
+                                                                const int max_voxels_per_axis) {
+    Decomposition_plan plan;
+    const auto extent = glm::vec3(domain.max - domain.min);
+    plan.voxel_size = std::max(cell_size, glm::compMax(extent) / static_cast<float>(max_voxels_per_axis));
+    const auto voxels = voxelize_lumen(vertices, indices, domain, plan.voxel_size);
+    if (voxels.coords.empty()) {
+        return plan;
+    }
+    const auto cells_per_voxel = static_cast<double>(plan.voxel_size / cell_size);
+    plan.estimated_cells = static_cast<size_t>(
+        static_cast<double>(voxels.coords.size()) * cells_per_voxel * cells_per_voxel * cells_per_voxel);
+    plan.subdomain_count = static_cast<int>(std::clamp(
+        plan.estimated_cells / static_cast<size_t>(std::max(min_cells_per_subdomain, 1)), size_t{1},
+        static_cast<size_t>(std::max(max_sub_domains, 1))));
+    const auto res = voxels.resolution;
+    std::vector<int> owner_grid(static_cast<size_t>(res.x) * res.y * res.z, -1);
+    const auto to_cells = [cells_per_voxel](const size_t voxel_count, const double exponent) {
+        return static_cast<size_t>(static_cast<double>(voxel_count) * glm::pow(cells_per_voxel, exponent));
+    };
+    // Subdomain sizes of the previous bounding box based decomposition.
+    const auto bb = calculate_bounding_box(vertices);
+    const auto bb_diff = glm::vec3(bb.max - bb.min);
+    const auto max_side_length = glm::compMax(bb_diff) / static_cast<float>(std::max(max_sub_domains, 1));
+    plan.simple_subdomains = glm::max(glm::ivec3(glm::ceil(bb_diff / max_side_length)), glm::ivec3(1));
+    const auto simple = evaluate_decomposition(voxels, assign_simple(voxels, plan.simple_subdomains),
+                                               glm::compMul(plan.simple_subdomains), owner_grid);
+    plan.simple_imbalance = simple.imbalance;
+    plan.simple_interface_faces = to_cells(simple.interface_faces, 2.0);
+    const std::array<std::pair<std::array<int, 3>, const char*>, 6> orders{{
+        {{0, 1, 2}, "xyz"}, {{0, 2, 1}, "xzy"}, {{1, 0, 2}, "yxz"},
+        {{1, 2, 0}, "yzx"}, {{2, 0, 1}, "zxy"}, {{2, 1, 0}, "zyx"}
+    }};
+    std::optional<Decomposition_result> best;
+    for (int nx = 1; nx <= plan.subdomain_count; ++nx) {
+        if (plan.subdomain_count % nx != 0) {
+            continue;
+        }
+        for (int ny = 1; ny <= plan.subdomain_count / nx; ++ny) {
+            if (plan.subdomain_count / nx % ny != 0) {
+                continue;
+            }
+            const glm::ivec3 n(nx, ny, plan.subdomain_count / nx / ny);
+            for (const auto& [order, order_name] : orders) {
+                auto result = evaluate_decomposition(voxels, assign_hierarchical(voxels, n, order),
+                                                     plan.subdomain_count, owner_grid);
+                if (!best || result.interface_faces < best->interface_faces
+                    || (result.interface_faces == best->interface_faces && result.imbalance < best->imbalance)) {
+                    best = std::move(result);
+                    plan.subdomains = n;
+                    plan.order = order_name;
+                }
+            }
+        }
+    }
+    plan.imbalance = best->imbalance;
+    plan.interface_faces = to_cells(best->interface_faces, 2.0);
+    for (const auto v : best->voxels_per_subdomain) {
+        plan.cells_per_subdomain.push_back(to_cells(v, 3.0));
+    }
+    return plan;
+}
+
+std::string tostf::foam::Decomposition_plan::to_string() const {
+    std::stringstream report;
+    report << "Estimated background cells " << estimated_cells << " from voxels of size " << voxel_size << "\n";
+    report << "hierarchical n (" << subdomains.x << " " << subdomains.y << " " << subdomains.z << ") order " << order
+        << "\n";
+    report << "    imbalance " << imbalance << ", interface faces " << interface_faces << "\n";
+    report << "simple n (" << simple_subdomains.x << " " << simple_subdomains.y << " " << simple_subdomains.z << ")\n";
+    report << "    imbalance " << simple_imbalance << ", interface faces " << simple_interface_faces << "\n";
+    report << "Cells per subdomain\n";
+    for (size_t i = 0; i < cells_per_subdomain.size(); ++i) {
+        report << "    " << i << " " << cells_per_subdomain.at(i) << "\n";
+    }
+    return report.str();
+}
@@ -0,0 +1,48 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "geometry/geometry.hpp"
+#include <string>
+#include <vector>
+
+namespace tostf
+{
+    namespace foam
+    {
+        // Hierarchical decomposition chosen from a voxelization of the lumen. Cell counts are estimates of the
+        // background mesh only, refinement near the surface by snappyHexMesh is not included.
+        struct Decomposition_plan {
+            std::string to_string() const;
+            int subdomain_count = 1;
+            glm::ivec3 subdomains{1};
+            // Split order of the hierarchical method, e.g. "xyz".
+            std::string order = "xyz";
+            float voxel_size = 0.0f;
+            size_t estimated_cells = 0;
+            std::vector<size_t> cells_per_subdomain;
+            // Faces between voxels of different subdomains, a measure of the communication between the ranks.
+            size_t interface_faces = 0;
+            // Largest subdomain divided by the average subdomain.
+            float imbalance = 1.0f;
+            // The bounding box based simple decomposition with the same maximal subdomain count for comparison.
+            glm::ivec3 simple_subdomains{1};
+            float simple_imbalance = 1.0f;
+            size_t simple_interface_faces = 0;
+        };
+
+        // The lumen of the closed mesh is voxelized within domain with cells of cell_size, coarsened to at most
+        // max_voxels_per_axis voxels along the longest side. Every factorization of the subdomain count and split
+        // order is evaluated and the one with the fewest interface faces is kept. The subdomain count is
+        // max_sub_domains, reduced until every subdomain holds about min_cells_per_subdomain cells.
+        Decomposition_plan plan_decomposition(const std::vector<glm::vec4>& vertices,
+                                              const std::vector<unsigned>& indices, const Bounding_box& domain,
+                                              float cell_size, int max_sub_domains,
+                                              int min_cells_per_subdomain = 10000, int max_voxels_per_axis = 128);
+    }
+}
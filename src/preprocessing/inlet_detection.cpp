@@ -7,24 +7,39 @@
 
 #include "inlet_detection.hpp"
 #include "data_processing/clustering.hpp"
+#include "mesh_processing/face_regions.hpp"
 #include "mesh_processing/tri_face_mesh.hpp"
-#include <set>
+#include "utility/logging.hpp"
 #include "utility/random.hpp"
+#include <algorithm>
+#include <limits>
 
 std::vector<tostf::truncation_plane> tostf::find_truncation_planes(const std::vector<glm::vec4>& edge_candidates,
-                                                                   const int k) {
+                                                                   const int k, const unsigned seed) {
     std::vector<truncation_plane> res(k);
-    auto clusters = k_means_pp(edge_candidates, k);
+    auto clusters = k_means_pp(edge_candidates, k, 100, seed);
     bool cluster_empty = false;
     for (int i = 0; i < k; i++) {
         cluster_empty = cluster_empty || clusters.at(i).data_points.empty();
     }
-    if (!cluster_empty) {
+    if (cluster_empty) {
+        return {};
+    }
 #pragma omp parallel for
-        for (int i = 0; i < k; i++) {
-            clusters.at(i).remove_outlier();
-            res.at(i) = std::make_pair(find_plane(clusters.at(i).data_points), analyze_dataset(clusters.at(i).data_points));
-        }
+    for (int i = 0; i < k; i++) {
+        clusters.at(i).remove_outlier();
+        res.at(i).second = analyze_dataset(clusters.at(i).data_points);
+    }
+    // All clusters are fitted in a single pass over their labeled points.
+    std::vector<glm::vec4> points;
+    std::vector<int> labels;
+    for (int i = 0; i < k; i++) {
+        points.insert(points.end(), clusters.at(i).data_points.begin(), clusters.at(i).data_points.end());
+        labels.insert(labels.end(), clusters.at(i).data_points.size(), i);
+    }
+    const auto planes = find_planes(points, labels, k);
+    for (int i = 0; i < k; i++) {
+        res.at(i).first = planes.at(i);
     }
     return res;
 }
@@ -47,174 +62,209 @@ void tostf::Inlet::set_boundary_type(const boundary_type b_type) {
     boundary.type = b_type;
 }
 
-std::vector<tostf::Inlet> tostf::detect_inlets_automatically(const Structured_mesh& mesh_data, const int plane_count) {
-    std::vector<Inlet> inlets(plane_count);
-    auto trunc_planes = find_truncation_planes(mesh_data.halfedge->find_hard_edge_candidates(), plane_count);
-    for (int p = 0; p < plane_count; p++) {
-        std::vector<std::array<unsigned, 3>> indices;
-        auto plane = trunc_planes.at(p).first;
-        const auto cluster_stats = trunc_planes.at(p).second;
-        std::vector<glm::vec4> inlet_points;
-        for (unsigned f = 0; f < mesh_data.tri_face_mesh->face_indices.size(); ++f) {
-            if (plane.is_on_plane(mesh_data.tri_face_mesh->face_centers.at(f), 0.3f)
-                && abs(dot(mesh_data.tri_face_mesh->face_normals.at(f), plane.normal)) >= 0.9
-                && distance(mesh_data.tri_face_mesh->face_centers.at(f), plane.center)
-                < 4.0f * cluster_stats.standard_deviation) {
-                if (dot(mesh_data.tri_face_mesh->face_normals.at(f), plane.normal) < 0.0f) {
-                    plane.normal = -plane.normal;
-                }
-                auto face_ids = mesh_data.tri_face_mesh->face_indices.at(f);
-                inlet_points.push_back(mesh_data.mesh->vertices.at(face_ids.at(0)));
-                inlet_points.push_back(mesh_data.mesh->vertices.at(face_ids.at(1)));
-                inlet_points.push_back(mesh_data.mesh->vertices.at(face_ids.at(2)));
-                indices.insert(indices.end(), mesh_data.tri_face_mesh->face_indices.at(f));
+// Fits a plane to the vertices of the faces and marks them in highlighted. The normal is oriented along direction.
+tostf::Inlet fit_inlet(const tostf::Mesh& mesh, std::vector<std::array<unsigned, 3>> faces,
+                       const glm::vec4& direction, std::vector<float>& highlighted) {
+    std::vector<glm::vec4> inlet_points;
+    for (const auto& face : faces) {
+        for (const auto v : face) {
+            if (highlighted.at(v) == 0.0f) {
+                highlighted.at(v) = 1.0f;
+                inlet_points.push_back(mesh.vertices.at(v));
+            }
+        }
+    }
+    auto new_plane = tostf::find_plane(inlet_points);
+    if (dot(new_plane.normal, direction) < 0.0f) {
+        new_plane.normal = -new_plane.normal;
+    }
+    float dist_to_center = 0.0f;
+    for (int inlet_p_id = 0; inlet_p_id < static_cast<int>(inlet_points.size()); ++inlet_p_id) {
+        dist_to_center = glm::max(dist_to_center, distance(inlet_points.at(inlet_p_id), new_plane.center));
+    }
+    tostf::Inlet inlet(faces, new_plane.center, new_plane.normal);
+    inlet.tangent = new_plane.tangent;
+    inlet.bitangent = new_plane.bitangent;
+    inlet.radius = dist_to_center;
+    return inlet;
+}
+
+// Every alive face is assigned to the closest truncation plane it lies on. Per plane only the largest region of
+// connected faces is kept, planes without any face are dropped.
+std::vector<tostf::Inlet> segment_inlets(const tostf::Structured_mesh& mesh_data,
+                                         const std::vector<tostf::truncation_plane>& trunc_planes) {
+    const auto& face_indices = mesh_data.tri_face_mesh->get_face_indices();
+    const auto& face_normals = mesh_data.tri_face_mesh->get_face_normals();
+    const auto& face_centers = mesh_data.tri_face_mesh->get_face_centers();
+    const auto face_count = static_cast<int>(face_indices.size());
+    const auto plane_count = static_cast<int>(trunc_planes.size());
+    std::vector<int> face_classes(face_count, -1);
+#pragma omp parallel for
+    for (int f = 0; f < face_count; ++f) {
+        const auto& center = face_centers.at(f);
+        const auto& normal = face_normals.at(f);
+        auto closest = std::numeric_limits<float>::max();
+        for (int p = 0; p < plane_count; ++p) {
+            const auto& plane = trunc_planes.at(p).first;
+            const auto dist = distance(center, plane.center);
+            if (dist < closest && dist < 4.0f * trunc_planes.at(p).second.standard_deviation
+                && abs(dot(normal, plane.normal)) >= 0.9f && plane.is_on_plane(center, 0.3f)) {
+                closest = dist;
+                face_classes.at(f) = p;
             }
         }
-        if (indices.empty()) {
-            return detect_inlets_automatically(mesh_data, plane_count);
+    }
+    const auto labels = tostf::label_face_regions(face_indices, face_classes);
+    std::vector<unsigned> region_sizes(face_count, 0);
+    for (int f = 0; f < face_count; ++f) {
+        if (labels.at(f) >= 0) {
+            ++region_sizes.at(labels.at(f));
+        }
+    }
+    std::vector<int> largest_regions(plane_count, -1);
+    for (int f = 0; f < face_count; ++f) {
+        const auto region = labels.at(f);
+        if (region < 0) {
+            continue;
+        }
+        auto& largest = largest_regions.at(face_classes.at(f));
+        if (largest < 0 || region_sizes.at(region) > region_sizes.at(largest)) {
+            largest = region;
         }
-        auto new_plane = tostf::find_plane(inlet_points);
-        if (dot(new_plane.normal, plane.normal) < 0.0f) {
-            new_plane.normal = -new_plane.normal;
+    }
+    std::vector<int> region_planes(face_count, -1);
+    for (int p = 0; p < plane_count; ++p) {
+        if (largest_regions.at(p) >= 0) {
+            region_planes.at(largest_regions.at(p)) = p;
         }
-        float dist_to_center = 0.0f;
-        for (int inlet_p_id = 0; inlet_p_id < static_cast<int>(inlet_points.size()); ++inlet_p_id) {
-            dist_to_center = glm::max(dist_to_center, distance(inlet_points.at(inlet_p_id), new_plane.center));
+    }
+    std::vector<std::vector<std::array<unsigned, 3>>> plane_faces(plane_count);
+    std::vector<glm::vec4> plane_directions(plane_count, glm::vec4(0.0f));
+    for (int f = 0; f < face_count; ++f) {
+        if (labels.at(f) >= 0 && region_planes.at(labels.at(f)) >= 0) {
+            const auto p = region_planes.at(labels.at(f));
+            plane_faces.at(p).push_back(face_indices.at(f));
+            plane_directions.at(p) += face_normals.at(f);
         }
-        inlets.at(p).indices = indices;
-        inlets.at(p).normal = plane.normal;
-        inlets.at(p).center = new_plane.center;
-        inlets.at(p).bitangent = new_plane.bitangent;
-        inlets.at(p).tangent = new_plane.tangent;
-        inlets.at(p).radius = dist_to_center;
-        float radius = 0;
-        for (const auto& face : indices) {
-            radius += distance(inlets.at(p).center, mesh_data.mesh->vertices.at(face.at(0)));
-            radius += distance(inlets.at(p).center, mesh_data.mesh->vertices.at(face.at(1)));
-            radius += distance(inlets.at(p).center, mesh_data.mesh->vertices.at(face.at(2)));
+    }
+    std::vector<tostf::Inlet> inlets;
+    for (int p = 0; p < plane_count; ++p) {
+        if (plane_faces.at(p).empty()) {
+            continue;
         }
-        inlets.at(p).name = "inlet" + std::to_string(p);
+        std::vector<float> highlighted(mesh_data.mesh->vertices.size(), 0.0f);
+        inlets.push_back(fit_inlet(*mesh_data.mesh, std::move(plane_faces.at(p)), plane_directions.at(p),
+                                   highlighted));
+        inlets.back().name = "inlet" + std::to_string(inlets.size() - 1);
     }
     return inlets;
 }
 
-inline bool operator==(const std::array<unsigned, 3>& f1, const std::array<unsigned, 3>& f2) {
-    return f1.at(0) == f2.at(0) && f1.at(1) == f2.at(1) && f1.at(2) == f2.at(2)
-           || f1.at(0) == f2.at(1) && f1.at(1) == f2.at(2) && f1.at(2) == f2.at(0)
-           || f1.at(0) == f2.at(2) && f1.at(1) == f2.at(0) && f1.at(2) == f2.at(1);
+std::vector<tostf::Inlet> tostf::detect_inlets_automatically(const Structured_mesh& mesh_data, const int plane_count,
+                                                             const unsigned seed, const int max_attempts) {
+    const auto edge_candidates = mesh_data.halfedge->find_hard_edge_candidates();
+    std::vector<Inlet> best_inlets;
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+        // Clustering is deterministic, retry with the next seed if a plane could not be found.
+        const auto trunc_planes = find_truncation_planes(edge_candidates, plane_count,
+                                                         seed + static_cast<unsigned>(attempt));
+        if (trunc_planes.empty()) {
+            continue;
+        }
+        auto inlets = segment_inlets(mesh_data, trunc_planes);
+        if (static_cast<int>(inlets.size()) == plane_count) {
+            return inlets;
+        }
+        if (inlets.size() > best_inlets.size()) {
+            best_inlets = std::move(inlets);
+        }
+    }
+    log_warning() << "Only " << best_inlets.size() << " of " << plane_count << " inlets were found after "
+        << max_attempts << " attempts.";
+    return best_inlets;
 }
 
 std::optional<tostf::Manual_inlet_selection> tostf::select_inlet_manually(const Structured_mesh& mesh_data,
                                                                           const unsigned selected_vertex) {
     std::optional<Manual_inlet_selection> result;
+    auto& tri_faces = *mesh_data.original_tri_face_mesh;
+    const auto& face_indices = tri_faces.get_face_indices();
+    const auto& face_normals = tri_faces.get_face_normals();
+    const auto& face_centers = tri_faces.get_face_centers();
+    const auto face_count = static_cast<int>(face_indices.size());
     Plane plane{mesh_data.mesh->vertices.at(selected_vertex), mesh_data.mesh->normals.at(selected_vertex)};
-    std::vector<unsigned> still_to_check{selected_vertex};
-    std::set<unsigned> found_plane_points{selected_vertex};
-    std::vector<float> highlight_data(mesh_data.mesh->vertices.size(), 0);
-    highlight_data.at(selected_vertex) = 1;
-    std::set<std::array<unsigned, 3>> selected_faces;
-    while (!still_to_check.empty()) {
-        std::vector<unsigned> new_still_to_check;
-        for (auto sel_v : still_to_check) {
-            auto one_ring_view = mesh_data.halfedge->compute_one_ring_neighborhood_faces(sel_v);
-            for (unsigned i = 0; i < one_ring_view.size(); i++) {
-                const auto face_id = one_ring_view.at(i);
-                const auto face_indices = mesh_data.original_tri_face_mesh->face_indices.at(face_id);
-                const auto center = mesh_data.original_tri_face_mesh->face_centers.at(face_id);
-                const auto normal = mesh_data.original_tri_face_mesh->face_normals.at(face_id);
-                if (abs(dot(normal, plane.normal)) >= 0.9 && plane.is_on_plane(center, 0.3f)) {
-                    const auto res_face = selected_faces.emplace(face_indices).second;
-                    if (res_face) {
-                        const auto a_id = face_indices.at(0);
-                        const auto b_id = face_indices.at(1);
-                        const auto c_id = face_indices.at(2);
-                        const auto res_a = found_plane_points.emplace(a_id).second;
-                        if (res_a) {
-                            highlight_data.at(a_id) = 1;
-                            new_still_to_check.push_back(a_id);
-                            auto a = mesh_data.mesh->vertices.at(a_id);
-                        }
-                        const auto res_b = found_plane_points.emplace(b_id).second;
-                        if (res_b) {
-                            highlight_data.at(b_id) = 1;
-                            new_still_to_check.push_back(b_id);
-                            auto b = mesh_data.mesh->vertices.at(b_id);
-                        }
-                        const auto res_c = found_plane_points.emplace(c_id).second;
-                        if (res_c) {
-                            highlight_data.at(c_id) = 1;
-                            new_still_to_check.push_back(c_id);
-                            auto c = mesh_data.mesh->vertices.at(c_id);
-                        }
-                    }
-                }
-            }
-        }
-        still_to_check = std::move(new_still_to_check);
-    }
-    std::vector<glm::vec4> inlet_points(found_plane_points.size());
-    int i = 0;
-    for (auto& id : found_plane_points) {
-        inlet_points.at(i) = mesh_data.mesh->vertices.at(id);
-        i++;
+    std::vector<int> face_classes(face_count);
+#pragma omp parallel for
+    for (int f = 0; f < face_count; ++f) {
+        face_classes.at(f) = abs(dot(face_normals.at(f), plane.normal)) >= 0.9f
+                             && plane.is_on_plane(face_centers.at(f), 0.3f) ? 0 : -1;
     }
-    auto new_plane = tostf::find_plane(inlet_points);
-    if (dot(new_plane.normal, plane.normal) < 0.0f) {
-        new_plane.normal = -new_plane.normal;
+    const auto labels = label_face_regions(face_indices, face_classes);
+    // The selection consists of all regions touching the selected vertex. The halfedge mesh numbers the faces of the
+    // input geometry, which differ from the face ids if duplicate faces were dropped.
+    const auto& indices = mesh_data.mesh->indices;
+    std::vector<int> selected_regions;
+    for (const auto he_face : mesh_data.halfedge->compute_one_ring_neighborhood_faces(selected_vertex)) {
+        if (3 * static_cast<size_t>(he_face) + 2 >= indices.size()) {
+            continue;
+        }
+        const auto f = tri_faces.find_face({indices.at(3 * he_face), indices.at(3 * he_face + 1),
+                                            indices.at(3 * he_face + 2)});
+        if (f >= 0 && labels.at(f) >= 0) {
+            selected_regions.push_back(labels.at(f));
+        }
     }
-    float dist_to_center = 0.0f;
-    for (int inlet_p_id = 0; inlet_p_id < static_cast<int>(inlet_points.size()); ++inlet_p_id) {
-        dist_to_center = glm::max(dist_to_center, distance(inlet_points.at(inlet_p_id), new_plane.center));
+    if (selected_regions.empty()) {
+        return result;
     }
-    if (!selected_faces.empty()) {
-        std::vector<std::array<unsigned, 3>> res_indices;
-        std::copy(selected_faces.begin(), selected_faces.end(), std::back_inserter(res_indices));
-        result = {highlight_data, {res_indices, new_plane.center, new_plane.normal}};
-        result->selection.tangent = new_plane.tangent;
-        result->selection.bitangent = new_plane.bitangent;
-        result->selection.radius = dist_to_center;
+    std::vector<std::array<unsigned, 3>> selected_faces;
+    for (int f = 0; f < face_count; ++f) {
+        if (labels.at(f) >= 0
+            && std::find(selected_regions.begin(), selected_regions.end(), labels.at(f)) != selected_regions.end()) {
+            selected_faces.push_back(face_indices.at(f));
+        }
     }
+    std::vector<float> highlight_data(mesh_data.mesh->vertices.size(), 0);
+    highlight_data.at(selected_vertex) = 1;
+    auto selection = fit_inlet(*mesh_data.mesh, std::move(selected_faces), plane.normal, highlight_data);
+    result = {highlight_data, selection};
     return result;
 }
 
 std::vector<tostf::Inlet> tostf::detect_inlets_from_holes(const Structured_mesh& mesh_data) {
     std::vector<Inlet> inlets;
-    auto boundaries = mesh_data.halfedge->get_boundaries();
-    if (!boundaries.empty()) {
-        const auto vertices_count = mesh_data.mesh->vertices.size();
-        mesh_data.mesh->vertices.resize(vertices_count + boundaries.size());
-        mesh_data.mesh->normals.resize(vertices_count + boundaries.size());
-        inlets.resize(boundaries.size());
-        for (int boundary_id = 0; boundary_id < static_cast<int>(boundaries.size()); ++boundary_id) {
-            auto b = boundaries.at(boundary_id);
-            inlets.at(boundary_id).indices.resize(b.size() * 3);
-            std::vector<glm::vec4> inlet_points(b.size());
+    const auto& loops = mesh_data.halfedge->get_boundary_loops();
+    if (!loops.empty()) {
+        const auto vertices_count = static_cast<unsigned>(mesh_data.mesh->vertices.size());
+        mesh_data.mesh->vertices.resize(vertices_count + loops.size());
+        mesh_data.mesh->normals.resize(vertices_count + loops.size());
+        inlets.resize(loops.size());
+        for (int boundary_id = 0; boundary_id < static_cast<int>(loops.size()); ++boundary_id) {
+            const auto& loop = loops.at(boundary_id);
+            const auto& b = loop.vertices;
+            const auto center_id = vertices_count + static_cast<unsigned>(boundary_id);
+            inlets.at(boundary_id).indices.resize(b.size());
             std::vector<unsigned> indices(b.size() * 3);
             for (unsigned i = 0; i < b.size(); ++i) {
                 const auto next_i = (i + 1) % b.size();
-                inlet_points.at(i) = mesh_data.mesh->vertices.at(b.at(i));
-                const std::array<unsigned, 3> index_tuple{b.at(next_i), b.at(i), vertices_count + boundary_id};
+                const std::array<unsigned, 3> index_tuple{b.at(next_i), b.at(i), center_id};
                 inlets.at(boundary_id).indices.at(i) = index_tuple;
                 indices.at(i * 3 + 0) = b.at(next_i);
                 indices.at(i * 3 + 1) = b.at(i);
-                indices.at(i * 3 + 2) = vertices_count + boundary_id;
+                indices.at(i * 3 + 2) = center_id;
             }
-            auto plane = tostf::find_plane(inlet_points);
+            auto plane = loop.plane;
             if (dot(plane.normal, mesh_data.mesh->normals.at(b.at(0))) < 0.0f) {
                 plane.normal = -plane.normal;
             }
-            float dist_to_center = 0.0f;
-            for (int inlet_p_id = 0; inlet_p_id < static_cast<int>(inlet_points.size()); ++inlet_p_id) {
-                dist_to_center = glm::max(dist_to_center, distance(inlet_points.at(inlet_p_id), plane.center));
-            }
-            mesh_data.mesh->vertices.at(vertices_count + boundary_id) = plane.center;
-            mesh_data.mesh->normals.at(vertices_count + boundary_id) = plane.normal;
+            mesh_data.mesh->vertices.at(center_id) = plane.center;
+            mesh_data.mesh->normals.at(center_id) = plane.normal;
             mesh_data.mesh->indices.insert(mesh_data.mesh->indices.end(), indices.begin(), indices.end());
             inlets.at(boundary_id).normal = plane.normal;
             inlets.at(boundary_id).center = plane.center;
             inlets.at(boundary_id).tangent = plane.tangent;
-            inlets.at(boundary_id).bitangent = plane.tangent;
-            inlets.at(boundary_id).radius = dist_to_center;
+            inlets.at(boundary_id).bitangent = plane.bitangent;
+            inlets.at(boundary_id).radius = loop.radius;
             inlets.at(boundary_id).name = "inlet" + std::to_string(boundary_id);
         }
     }
@@ -14,7 +14,9 @@
 namespace tostf
 {
     using truncation_plane = std::pair<Plane, Dataset_stats<glm::vec4>>;
-    std::vector<truncation_plane> find_truncation_planes(const std::vector<glm::vec4>& edge_candidates, int k);
+    // Returns no planes if one of the k clusters of edge candidates is empty.
+    std::vector<truncation_plane> find_truncation_planes(const std::vector<glm::vec4>& edge_candidates, int k,
+                                                        unsigned seed = 0);
 
     enum class boundary_type : int {
         wall = 0,
@@ -78,13 +80,18 @@ namespace tostf
         float inflow_velocity = 0.5f;
     };
 
-    std::vector<Inlet> detect_inlets_automatically(const Structured_mesh& mesh_data, int plane_count);
+    // Faces of the tri face mesh are assigned to the truncation planes in parallel and grouped into connected regions,
+    // the largest region per plane becomes an inlet. If fewer than plane_count inlets are found, the clustering is
+    // repeated with the following seeds up to max_attempts times and the best result is returned.
+    std::vector<Inlet> detect_inlets_automatically(const Structured_mesh& mesh_data, int plane_count, unsigned seed = 0,
+                                                   int max_attempts = 8);
 
     struct Manual_inlet_selection {
         std::vector<float> highlighted;
         Inlet selection;
     };
 
+    // Selects the connected faces around the vertex that lie on its tangent plane.
     std::optional<Manual_inlet_selection> select_inlet_manually(const Structured_mesh& mesh_data,
                                                                 unsigned selected_vertex);
 
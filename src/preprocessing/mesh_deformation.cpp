@@ -0,0 +1,191 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "mesh_deformation.hpp"
+#include "utility/random.hpp"
+#include "math/statistics.hpp"
+#include <array>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+
+void tostf::calc_distances_to_reference(Deformed_mesh& deformed, const std::vector<glm::vec4>& reference_vertices,
+                                        const std::vector<glm::vec4>& reference_normals) {
+    const auto vertex_count = static_cast<int>(deformed.vertices.size());
+    if (reference_vertices.size() != deformed.vertices.size() || reference_normals.size() != deformed.vertices.size()) {
+        throw std::runtime_error{"Deformed mesh does not match the reference mesh."};
+    }
+    deformed.distances_to_reference.resize(vertex_count);
+    // Fixed blocks merged in order keep the statistics independent of the thread count.
+    constexpr int block_count = 64;
+    std::vector<math::Running_stats> block_stats(block_count);
+#pragma omp parallel for
+    for (int b = 0; b < block_count; ++b) {
+        const auto end = static_cast<int>(static_cast<int64_t>(vertex_count) * (b + 1) / block_count);
+        for (auto i = static_cast<int>(static_cast<int64_t>(vertex_count) * b / block_count); i < end; ++i) {
+            const auto dir = glm::vec3(deformed.vertices.at(i) - reference_vertices.at(i));
+            const auto dist = length(dir) * glm::sign(dot(dir, glm::vec3(reference_normals.at(i))));
+            deformed.distances_to_reference.at(i) = dist;
+            block_stats.at(b).add(dist);
+        }
+    }
+    math::Running_stats stats;
+    for (const auto& s : block_stats) {
+        stats.merge(s);
+    }
+    deformed.min_dist_to_ref = stats.min;
+    deformed.max_dist_to_ref = stats.max;
+    deformed.avg_dist_to_ref = static_cast<float>(stats.mean);
+    deformed.sd_dist_to_ref = static_cast<float>(glm::sqrt(stats.variance()));
+}
+
+std::vector<tostf::Deformation_params> tostf::gen_deformation_params(const Deformation_params& reference,
+                                                                     const float variation, const int count,
+                                                                     const uint64_t seed) {
+    std::vector<Deformation_params> params(count, reference);
+    if (variation == 0.0f) {
+        return params;
+    }
+    std::mt19937_64 gen(seed);
+    std::normal_distribution<float> iter_nd(static_cast<float>(reference.iterations),
+                                            variation * static_cast<float>(reference.iterations));
+    std::normal_distribution<float> gauss_nd(reference.gauss_variance, variation * reference.gauss_variance);
+    std::normal_distribution<float> rayleigh_variance_nd(reference.rayleigh_variance,
+                                                         variation * reference.rayleigh_variance);
+    std::normal_distribution<float> shift_nd(reference.rayleigh_shift, variation * reference.rayleigh_shift);
+    std::normal_distribution<float> scale_nd(reference.scale, variation * reference.scale);
+    for (auto& p : params) {
+        p.iterations = glm::max(0, static_cast<int>(iter_nd(gen)));
+        p.gauss_variance = gauss_nd(gen);
+        p.rayleigh_variance = rayleigh_variance_nd(gen);
+        p.rayleigh_shift = shift_nd(gen);
+        p.scale = scale_nd(gen);
+    }
+    return params;
+}
+
+std::vector<tostf::Deformation_bump> tostf::gen_deformation_bumps(const Deformation_params& params,
+                                                                  const Bounding_box& bb, const uint64_t seed,
+                                                                  const uint64_t stream) {
+    const auto stream_seed = mix_bits(seed ^ mix_bits(stream + 1));
+    const auto lower = glm::vec3(bb.min) * 1.5f;
+    const auto upper = glm::vec3(bb.max) * 1.5f;
+    std::vector<Deformation_bump> bumps(glm::max(params.iterations, 0));
+    for (int i = 0; i < static_cast<int>(bumps.size()); ++i) {
+        const auto counter = 4 * static_cast<uint64_t>(i);
+        const glm::vec3 r(gen_counter_random_float(stream_seed, counter),
+                          gen_counter_random_float(stream_seed, counter + 1),
+                          gen_counter_random_float(stream_seed, counter + 2));
+        bumps.at(i).center = glm::vec4(lower + r * (upper - lower), 1.0f);
+        // Three out of four bumps push the vertices outwards.
+        bumps.at(i).sign = gen_counter_random_float(stream_seed, counter + 3) < 0.25f ? -1.0f : 1.0f;
+    }
+    return bumps;
+}
+
+// Vertices are deformed in blocks which stay in cache while all bumps are applied.
+constexpr int deformation_block_size = 1024;
+
+// Returns false without writing the block if cancel was set before all bumps were applied.
+bool deform_block(const std::vector<glm::vec4>& vertices, std::vector<glm::vec4>& deformed, const int first,
+                  const int last, const tostf::Deformation_params& params,
+                  const std::vector<tostf::Deformation_bump>& bumps, const std::vector<tostf::Inlet>& inlets,
+                  const std::atomic<bool>* cancel) {
+    const auto count = last - first;
+    std::array<float, deformation_block_size> x{};
+    std::array<float, deformation_block_size> y{};
+    std::array<float, deformation_block_size> z{};
+    for (int i = 0; i < count; ++i) {
+        x.at(i) = vertices.at(first + i).x;
+        y.at(i) = vertices.at(first + i).y;
+        z.at(i) = vertices.at(first + i).z;
+    }
+    // calc_gauss_rayleigh with both exponentials merged and the constant factors hoisted out of the loop.
+    const auto gauss_norm = 1.0f / glm::sqrt(2.0f * glm::pi<float>() * params.gauss_variance);
+    const auto inv_gauss = -1.0f / (2.0f * params.gauss_variance);
+    const auto inv_rayleigh = -1.0f / (2.0f * params.rayleigh_variance);
+    for (const auto& bump : bumps) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            return false;
+        }
+        const auto strength = bump.sign * params.scale * gauss_norm / params.rayleigh_variance;
+#pragma omp simd
+        for (int i = 0; i < count; ++i) {
+            const auto dx = x[i] - bump.center.x;
+            const auto dy = y[i] - bump.center.y;
+            const auto dz = z[i] - bump.center.z;
+            // Vertices within 1.5 radii of an inlet center are fixed, the deformation fades in up to 2.5 radii.
+            float inlet_weight = 1.0f;
+            for (const auto& inlet : inlets) {
+                const auto ix = x[i] - inlet.center.x;
+                const auto iy = y[i] - inlet.center.y;
+                const auto iz = z[i] - inlet.center.z;
+                const auto inlet_dist = glm::sqrt(ix * ix + iy * iy + iz * iz);
+                inlet_weight = glm::min(inlet_weight, glm::max(
+                                            glm::max(inlet_dist - inlet.radius, 0.0f) / inlet.radius - 0.5f, 0.0f));
+            }
+            const auto sq_dist = dx * dx + dy * dy + dz * dz;
+            const auto rayleigh_dist = glm::sqrt(sq_dist) + params.rayleigh_shift;
+            // Clamping keeps the exponential out of the slow denormal range, its contribution is negligible there.
+            const auto gauss_rayleigh = rayleigh_dist * glm::exp(glm::max(
+                                            rayleigh_dist * rayleigh_dist * inv_rayleigh + sq_dist * inv_gauss, -80.0f));
+            const auto factor = strength * gauss_rayleigh * inlet_weight;
+            x[i] += dx * factor;
+            y[i] += dy * factor;
+            z[i] += dz * factor;
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        deformed.at(first + i) = glm::vec4(x.at(i), y.at(i), z.at(i), vertices.at(first + i).w);
+    }
+    return true;
+}
+
+std::vector<glm::vec4> tostf::deform_vertices(const std::vector<glm::vec4>& vertices,
+                                              const Deformation_params& params,
+                                              const std::vector<Deformation_bump>& bumps,
+                                              const std::vector<Inlet>& preserved_inlets) {
+    return deform_vertices_batch(vertices, {params}, {bumps}, preserved_inlets).front();
+}
+
+std::vector<std::vector<glm::vec4>> tostf::deform_vertices_batch(
+    const std::vector<glm::vec4>& vertices, const std::vector<Deformation_params>& params,
+    const std::vector<std::vector<Deformation_bump>>& bumps, const std::vector<Inlet>& preserved_inlets,
+    const std::function<void(int)>& on_finished, const std::atomic<bool>* cancel) {
+    if (params.size() != bumps.size()) {
+        throw std::runtime_error{"Every deformation requires its own bumps."};
+    }
+    const auto mesh_count = static_cast<int>(params.size());
+    const auto block_count = (static_cast<int>(vertices.size()) + deformation_block_size - 1)
+                             / deformation_block_size;
+    std::vector<std::vector<glm::vec4>> deformed(mesh_count, std::vector<glm::vec4>(vertices.size()));
+    std::vector<std::atomic<int>> remaining_blocks(mesh_count);
+    for (auto& r : remaining_blocks) {
+        r = block_count;
+    }
+    // Meshes and vertex blocks are flattened into one loop, so a few large meshes scale as well as many small ones.
+#pragma omp parallel for schedule(dynamic)
+    for (int task = 0; task < mesh_count * block_count; ++task) {
+        const auto mesh_id = task / block_count;
+        const auto first = (task % block_count) * deformation_block_size;
+        const auto last = glm::min(first + deformation_block_size, static_cast<int>(vertices.size()));
+        if (!deform_block(vertices, deformed.at(mesh_id), first, last, params.at(mesh_id), bumps.at(mesh_id),
+                          preserved_inlets, cancel)) {
+            continue;
+        }
+        if (remaining_blocks.at(mesh_id).fetch_sub(1) == 1 && on_finished) {
+            on_finished(mesh_id);
+        }
+    }
+    // Meshes with blocks left undeformed by a cancellation are reset as a whole instead of being torn.
+    for (int mesh_id = 0; mesh_id < mesh_count; ++mesh_id) {
+        if (remaining_blocks.at(mesh_id) > 0) {
+            deformed.at(mesh_id) = vertices;
+        }
+    }
+    return deformed;
+}
@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <functional>
 #include "math/glm_helper.hpp"
-#include "gpu_interface/texture.hpp"
+#include "preprocessing/inlet_detection.hpp"
 
 namespace tostf {
     struct Deformed_mesh {
@@ -21,6 +24,43 @@ namespace tostf {
         float max_dist_to_ref{};
         float avg_dist_to_ref{};
         float sd_dist_to_ref{};
-        std::unique_ptr<Texture2D> tex = nullptr;
     };
+
+    // Signed distance of every vertex to its reference position along the reference normal.
+    // The distance statistics of the deformed mesh are computed in the same pass.
+    void calc_distances_to_reference(Deformed_mesh& deformed, const std::vector<glm::vec4>& reference_vertices,
+                                     const std::vector<glm::vec4>& reference_normals);
+
+    // Every iteration pushes the vertices away from or towards a random center by a Gauss-Rayleigh curve
+    // of their distance to the center.
+    struct Deformation_params {
+        int iterations = 100;
+        float gauss_variance = 2.0f;
+        float rayleigh_variance = 1.0f;
+        float rayleigh_shift = 1.0f;
+        float scale = 1.0f;
+    };
+
+    struct Deformation_bump {
+        glm::vec4 center{};
+        float sign = 1.0f;
+    };
+
+    // Varies every parameter of the reference by a normal distribution with variation * value as deviation.
+    std::vector<Deformation_params> gen_deformation_params(const Deformation_params& reference, float variation,
+                                                           int count, uint64_t seed);
+    // The bumps only depend on seed and stream, so deformations can be generated in any order.
+    std::vector<Deformation_bump> gen_deformation_bumps(const Deformation_params& params, const Bounding_box& bb,
+                                                        uint64_t seed, uint64_t stream);
+    // Applies the bumps in order, vertices close to the preserved inlets are not moved.
+    std::vector<glm::vec4> deform_vertices(const std::vector<glm::vec4>& vertices, const Deformation_params& params,
+                                           const std::vector<Deformation_bump>& bumps,
+                                           const std::vector<Inlet>& preserved_inlets = {});
+    // Deforms a copy of the vertices for every parameter set, parallel over meshes and vertex blocks.
+    // on_finished is called from the worker threads with the id of every completed deformation.
+    // Setting cancel stops the blocks between bumps, deformations that did not complete keep the input vertices.
+    std::vector<std::vector<glm::vec4>> deform_vertices_batch(
+        const std::vector<glm::vec4>& vertices, const std::vector<Deformation_params>& params,
+        const std::vector<std::vector<Deformation_bump>>& bumps, const std::vector<Inlet>& preserved_inlets = {},
+        const std::function<void(int)>& on_finished = nullptr, const std::atomic<bool>* cancel = nullptr);
 }
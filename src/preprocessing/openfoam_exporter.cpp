@@ -6,9 +6,14 @@
 //
 
 #include "openfoam_exporter.hpp"
+#include <exception>
+#include <stdexcept>
 #include <utility>
 #include "utility/logging.hpp"
 #include "file/file_handling.hpp"
+#include "file/obj_writer.hpp"
+#include "file/stl_io.hpp"
+#include "decomposition_planner.hpp"
 #include "geometry/mesh_handling.hpp"
 #include "utility/random.hpp"
 #include "utility/str_conversion.hpp"
@@ -460,8 +465,8 @@ std::string gen_bb_vertices_str(const tostf::Bounding_box& bb, float bb_offset)
            "    (" + max_x + " " + max_y + " " + max_z + ")\n);\n";
 }
 
-std::string gen_surface_feature_extract_dict(const std::string& name, const tostf::foam::Surface_feature_extract& feature_extract) {
-    return gen_foam_file_str("surfaceFeatureExtractDict") + name + ".obj {\n"
+std::string gen_surface_feature_extract_dict(const std::string& file_name, const tostf::foam::Surface_feature_extract& feature_extract) {
+    return gen_foam_file_str("surfaceFeatureExtractDict") + file_name + " {\n"
            + feature_extract.to_string() + "}\n" + gen_file_end_str();
 }
 
@@ -488,22 +493,32 @@ std::string gen_castellated_back(const glm::vec4& location_in_mesh) {
            + std::to_string(location_in_mesh.y) + " " + std::to_string(location_in_mesh.z) + ");\n}\n";
 }
 
-std::string gen_regions_str(const std::string& name, const std::vector<tostf::Inlet>& inlets) {
+// OBJ regions are named after their groups. Binary STL regions are named patch<id> after the solid id of the
+// triangles, the wall is solid 0. This relies on every solid having faces, which export_openfoam_cases checks.
+std::string gen_regions_str(const std::string& name, const std::vector<tostf::Inlet>& inlets,
+                            const tostf::foam::surface_format format) {
     std::string regions;
-    for (auto& inlet : inlets) {
-        regions += "            " + inlet.name + " { name " + name + "_" + inlet.name + "; }\n";
+    if (format == tostf::foam::surface_format::binary_stl) {
+        regions += "            patch0 { name " + name + "_" + name + "; }\n";
+    }
+    for (size_t i = 0; i < inlets.size(); ++i) {
+        const auto region = format == tostf::foam::surface_format::binary_stl
+                                ? "patch" + std::to_string(i + 1) : inlets.at(i).name;
+        regions += "            " + region + " { name " + name + "_" + inlets.at(i).name + "; }\n";
     }
     return regions;
 }
 
-std::string gen_snappy_hex_mesh_front(const std::string& name, const tostf::foam::Snappy_hex_mesh_controls& snappy,
-                                      const std::vector<tostf::Inlet>& inlets) {
+std::string gen_snappy_hex_mesh_front(const std::string& name, const std::string& file_name,
+                                      const tostf::foam::Snappy_hex_mesh_controls& snappy,
+                                      const std::vector<tostf::Inlet>& inlets,
+                                      const tostf::foam::surface_format format) {
     return gen_foam_file_str("snappyHexMeshDict")
            .append("castellatedMesh true;\nsnap " + bool_to_str(snappy.snap_active) + ";\naddLayers ")
            .append(bool_to_str(snappy.add_layers.has_value()) + ";\n")
-           .append("geometry {\n    " + name + ".obj {\n        type triSurfaceMesh;\n"
+           .append("geometry {\n    " + file_name + " {\n        type triSurfaceMesh;\n"
                "        name " + name + ";\n        regions {\n")
-           .append(gen_regions_str(name, inlets)).append("        }\n    }\n}\n")
+           .append(gen_regions_str(name, inlets, format)).append("        }\n    }\n}\n")
            .append(gen_castellated_front(name, snappy.castellated, inlets));
 }
 
@@ -514,60 +529,48 @@ std::string gen_snappy_hex_mesh_back() {
         "mergeTolerance 1e-6;\n").append(gen_file_end_str());
 }
 
-std::string gen_mesh_data_str(const std::vector<unsigned>& indices, const std::vector<glm::vec4>& vertices,
-                              const std::vector<glm::vec4>& normals, const int precision = 7) {
-    std::stringstream vert_str;
-    std::stringstream normal_str;
-    vert_str.setf(std::ios::fixed, std::ios::floatfield);
-    normal_str.setf(std::ios::fixed, std::ios::floatfield);
-    vert_str.precision(precision);
-    normal_str.precision(precision);
-    std::thread vert_thread([&vert_str, &indices, &vertices]() {
-        for (int i = 0; i < static_cast<int>(indices.size()); i++) {
-            const auto& v = vertices.at(indices.at(i));
-            vert_str << "v " << v.x << " " << v.y << " " << v.z << "\n";
-        }
-    });
-    std::thread normal_thread([&normal_str, &indices, &normals]() {
-        for (int i = 0; i < static_cast<int>(indices.size()); i++) {
-            const auto& n = normals.at(indices.at(i));
-            normal_str << "vn " << n.x << " " << n.y << " " << n.z << "\n";
-        }
-    });
-    vert_thread.join();
-    normal_thread.join();
-    vert_str << normal_str.str();
-    return vert_str.str();
-}
-
-std::string gen_mesh_indices_str_from_view(const tostf::Geometry_view& view, const unsigned index_offset = 0) {
-    std::stringstream face_str;
-    for (int i = 0; i < static_cast<int>(view.indices.size()) / 3; i++) {
-        const int index_a = index_offset + i * 3 + 0 + 1;
-        const int index_b = index_offset + i * 3 + 1 + 1;
-        const int index_c = index_offset + i * 3 + 2 + 1;
-        face_str << "f " << index_a << "/" << "/" << index_a
-            << " " << index_b << "/" << "/" << index_b
-            << " " << index_c << "/" << "/" << index_c << "\n";
-    }
-    return face_str.str();
-}
-
-std::string gen_mesh_export_str(const std::string& name, const std::vector<glm::vec4>& vertices, const std::vector<glm::vec4>& normals,
-                                const std::string& wall_indices_str, const std::vector<std::string>& inlet_indices_strs,
-                                const std::vector<unsigned>& wall_indices,
-                                const std::vector<tostf::Geometry_view>& inlet_views,
-                                const std::vector<tostf::Inlet>& inlets) {
-    std::stringstream exp_str;
-    exp_str << "g " + name + "\n";
-    exp_str << gen_mesh_data_str(wall_indices, vertices, normals);
-    exp_str << wall_indices_str;
+// Vertices and normals are written once and indexed by the faces of the wall and every inlet group.
+void export_mesh_obj(const std::filesystem::path& path, const std::string& name,
+                     const std::vector<glm::vec4>& vertices, const std::vector<glm::vec4>& normals,
+                     const std::vector<unsigned>& wall_indices, const std::vector<tostf::Geometry_view>& inlet_views,
+                     const std::vector<tostf::Inlet>& inlets) {
+    tostf::Obj_writer writer(path);
+    writer.write_vertices(vertices);
+    writer.write_normals(normals);
+    writer.write_group(name);
+    writer.write_faces(wall_indices, true, false);
     for (unsigned i = 0; i < inlets.size(); ++i) {
-        exp_str << "g " << inlets.at(i).name << "\n";
-        exp_str << gen_mesh_data_str(inlet_views.at(i).indices, vertices, normals);
-        exp_str << inlet_indices_strs.at(i);
+        writer.write_group(inlets.at(i).name);
+        writer.write_faces(inlet_views.at(i).indices, true, false);
+    }
+    writer.close();
+}
+
+void export_mesh_surface(const std::filesystem::path& path, const tostf::foam::surface_format format,
+                         const std::string& name, const std::vector<glm::vec4>& vertices,
+                         const std::vector<glm::vec4>& normals, const std::vector<unsigned>& wall_indices,
+                         const std::vector<tostf::Geometry_view>& inlet_views,
+                         const std::vector<tostf::Inlet>& inlets) {
+    if (format == tostf::foam::surface_format::obj) {
+        export_mesh_obj(path, name, vertices, normals, wall_indices, inlet_views, inlets);
+        return;
+    }
+    std::vector<tostf::Stl_solid> solids{{name, wall_indices}};
+    for (size_t i = 0; i < inlets.size(); ++i) {
+        solids.push_back({inlets.at(i).name, inlet_views.at(i).indices});
+    }
+    tostf::export_binary_stl(path, vertices, solids);
+}
+
+// Files that are equal for all cases are hard linked to the reference case, copies are the fallback on file
+// systems without hard links. OpenFOAM only reads them, so the cases do not influence each other.
+void link_shared_file(const std::filesystem::path& source, const std::filesystem::path& target) {
+    std::error_code error;
+    std::filesystem::remove(target, error);
+    std::filesystem::create_hard_link(source, target, error);
+    if (error) {
+        std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing);
     }
-    return exp_str.str();
 }
 
 std::string gen_deformed_stats_str(const tostf::Deformed_mesh& deformed, const float scale) {
@@ -584,6 +587,18 @@ void tostf::foam::export_openfoam_cases(const std::string& name, const OpenFOAM_
                                         const std::vector<Deformed_mesh>& deformed_meshes, const Geometry_view& wall,
                                         const std::vector<Geometry_view>& inlet_views,
                                         const std::vector<Inlet>& inlets) {
+    // OpenFOAM numbers STL solids by their first triangle, so an empty solid would shift all later patch names.
+    if (inlet_views.size() != inlets.size()) {
+        throw std::runtime_error{"Every inlet requires its own faces."};
+    }
+    if (wall.indices.empty()) {
+        throw std::runtime_error{"The wall of " + name + " has no faces."};
+    }
+    for (size_t i = 0; i < inlets.size(); ++i) {
+        if (inlet_views.at(i).indices.empty()) {
+            throw std::runtime_error{"Inlet " + inlets.at(i).name + " of " + name + " has no faces."};
+        }
+    }
     const auto block_mesh_dict_front = gen_foam_file_str("blockMeshDict").append("scale 1.0;\n");
     auto scaled_bb_min = (bb.min - info.block_mesh.bb_offset) * scale;
     auto scaled_bb_max = (bb.max + info.block_mesh.bb_offset) * scale;
@@ -599,11 +614,38 @@ void tostf::foam::export_openfoam_cases(const std::string& name, const OpenFOAM_
     auto max_side_length = abs(max_grid_side_length / info.decompose_par_dict.max_sub_domains);
     glm::ivec3 subdomain_sizes(ceil(bb_diff / max_side_length));
     auto subdomain_count = subdomain_sizes.x * subdomain_sizes.y * subdomain_sizes.z;
+    std::string decomposition_method = "method simple;\nsimpleCoeffs {\n    n (" + std::to_string(subdomain_sizes.x)
+                                       + " " + std::to_string(subdomain_sizes.y) + " "
+                                       + std::to_string(subdomain_sizes.z) + ");\n";
+    std::optional<Decomposition_plan> decomposition_plan;
+    if (info.parallel && info.decompose_par_dict.plan) {
+        Bounding_box domain;
+        domain.min = bb.min - info.block_mesh.bb_offset;
+        domain.max = bb.max + info.block_mesh.bb_offset;
+        decomposition_plan = plan_decomposition(mesh->vertices, mesh->indices, domain,
+                                                info.block_mesh.initial_cell_size / scale,
+                                                info.decompose_par_dict.max_sub_domains,
+                                                info.decompose_par_dict.min_cells_per_subdomain);
+        if (decomposition_plan->estimated_cells == 0) {
+            log_warning() << "The mesh encloses no volume, the bounding box is decomposed instead.";
+            decomposition_plan.reset();
+        }
+        else {
+            const auto& n = decomposition_plan->subdomains;
+            subdomain_count = decomposition_plan->subdomain_count;
+            decomposition_method = "method hierarchical;\nhierarchicalCoeffs {\n    n (" + std::to_string(n.x) + " "
+                                   + std::to_string(n.y) + " " + std::to_string(n.z) + ");\n    order "
+                                   + decomposition_plan->order + ";\n";
+            log_info() << "Planned decomposition with predicted imbalance " << decomposition_plan->imbalance
+                << " instead of " << decomposition_plan->simple_imbalance << " for the bounding box split.";
+        }
+    }
     auto decompose_par_str = gen_foam_file_str("decomposeParDict").append(std::string("numberOfSubdomains " + std::to_string(subdomain_count) + ";\n"
-        "method simple;\nsimpleCoeffs {\n    n (" + std::to_string(subdomain_sizes.x) + " " + std::to_string(subdomain_sizes.y) + " " + std::to_string(subdomain_sizes.z) + ");\n"
-        "delta 0.001;\n}\ndistributed no;\nroots ( );\n"))
+        + decomposition_method + "delta 0.001;\n}\ndistributed no;\nroots ( );\n"))
         .append(gen_file_end_str());
-    const auto snappy_hex_front = gen_snappy_hex_mesh_front(name, info.snappy_hex_mesh, inlets);
+    const auto file_name = name + (info.surface == surface_format::binary_stl ? ".stl" : ".obj");
+    const auto snappy_hex_front = gen_snappy_hex_mesh_front(name, file_name, info.snappy_hex_mesh, inlets,
+                                                            info.surface);
     std::string snappy_hex_back(info.snappy_hex_mesh.snap.to_string() + gen_snappy_hex_mesh_back());
     const auto scale_str = std::to_string(scale);
     const std::string mesh_gen_bash("#!/bin/bash\n" + std::string(source_openfoam) + "\nblockMesh >> mesh_gen_log;surfaceFeatureExtract >> mesh_gen_log;"
@@ -620,17 +662,9 @@ void tostf::foam::export_openfoam_cases(const std::string& name, const OpenFOAM_
         const std::string run_sim_global_parallel = "for d in */\ndo\ncd \"${d}\" && ./run_simulation_parallel.sh\ncd ..\ndone\n";
         save_str_to_file(info.export_path / "run_simulations_parallel.sh", run_sim_global_parallel);
     }
-    if (info.post_processing.lambda2 || info.post_processing.wall_shear_stress || info.post_processing.q_criterion) {
+    if (info.post_processing.wall_shear_stress) {
         std::string postprocess_str = std::string(source_openfoam) + "\nfor d in */\ndo\ncd \"${d}\"\n";
-        if (info.post_processing.lambda2) {
-            postprocess_str.append("postProcess -func Lambda2 -noZero >> postprocess_log\n");
-        }
-        if (info.post_processing.q_criterion) {
-            postprocess_str.append("postProcess -func Q >> postprocess_log\n");
-        }
-        if (info.post_processing.wall_shear_stress) {
-            postprocess_str.append(info.algorithm.get_application_name() + " -postProcess -func wallShearStress >> postprocess_log\n");
-        }
+        postprocess_str.append(info.algorithm.get_application_name() + " -postProcess -func wallShearStress >> postprocess_log\n");
         postprocess_str.append("cd ..\ndone\n");
         save_str_to_file(info.export_path / "post_process.sh", postprocess_str);
     }
@@ -648,7 +682,7 @@ void tostf::foam::export_openfoam_cases(const std::string& name, const OpenFOAM_
     save_str_to_file(ref_case_path / "system" / "fvSolution", fv_solution_str);
 	auto fv_schemes_str = gen_schemes_str(info.schemes);
     save_str_to_file(ref_case_path / "system" / "fvSchemes", fv_schemes_str);
-	auto feature_dict = gen_surface_feature_extract_dict(name, info.feature_extract);
+	auto feature_dict = gen_surface_feature_extract_dict(file_name, info.feature_extract);
     save_str_to_file(ref_case_path / "system" / "surfaceFeatureExtractDict", feature_dict);
     create_directory(ref_case_path / "constant");
 	auto transport_info = gen_transport_properties_str(info.blood_flow);
@@ -675,61 +709,68 @@ void tostf::foam::export_openfoam_cases(const std::string& name, const OpenFOAM_
     const auto loc_in_ref = mesh->find_random_point_in_mesh(point_offset);
     save_str_to_file(ref_case_path / "system" / "snappyHexMeshDict",
                      snappy_hex_front + gen_castellated_back(loc_in_ref).append(snappy_hex_back));
-    const auto wall_indices = gen_mesh_indices_str_from_view(wall);
-    auto offset = static_cast<unsigned>(wall.indices.size());
-    std::vector<std::string> inlet_indices_strings(inlets.size());
-    for (int i = 0; i < static_cast<int>(inlet_views.size()); ++i) {
-        inlet_indices_strings.at(i) = gen_mesh_indices_str_from_view(inlet_views.at(i), offset);
-        offset += static_cast<unsigned>(inlet_views.at(i).indices.size());
-    }
-    const std::filesystem::path file_name = name + ".obj";
-    const auto reference_mesh = gen_mesh_export_str(name, mesh->vertices, mesh->normals, wall_indices, inlet_indices_strings,
-                                                    wall.indices, inlet_views, inlets);
-    save_str_to_file(ref_case_path / "constant" / "triSurface" / file_name, reference_mesh);
+    export_mesh_surface(ref_case_path / "constant" / "triSurface" / file_name, info.surface, name, mesh->vertices,
+                        mesh->normals, wall.indices, inlet_views, inlets);
     save_str_to_file(ref_case_path / "reference_case.foam", "");
-    for (const auto& d : deformed_meshes) {
-		std::filesystem::path exp_path = info.export_path / d.name;
-		create_directory(exp_path);
-		save_str_to_file(exp_path / "mesh_gen.sh", mesh_gen_bash);
-		save_str_to_file(exp_path / "run_simulation.sh", run_bash);
-		if (info.parallel) {
-			save_str_to_file(exp_path / "run_simulation_parallel.sh", run_parallel_bash);
-		}
-		create_directory(exp_path / "system");
-		save_str_to_file(exp_path / "system" / "controlDict", control_dict_str);
-		save_str_to_file(exp_path / "system" / "fvSolution", fv_solution_str);
-		save_str_to_file(exp_path / "system" / "fvSchemes", fv_schemes_str);
-		save_str_to_file(exp_path / "system" / "surfaceFeatureExtractDict", feature_dict);
-		create_directory(exp_path / "constant");
-		save_str_to_file(exp_path / "constant" / "transportProperties", transport_info);
-		save_str_to_file(exp_path / "constant" / "turbulenceProperties", turbulence_str);
-		create_directory(exp_path / "constant" / "triSurface");
-		create_directory(exp_path / time_dir_name);
-		save_str_to_file(exp_path / time_dir_name / "U", initial_U_str);
-		save_str_to_file(exp_path / time_dir_name / "p", initial_p_str);
-        save_str_to_file(exp_path / "dist_to_ref.txt", gen_deformed_stats_str(d, scale));
-        save_str_to_file(exp_path / "system" / "blockMeshDict",
-                         block_mesh_dict_front + gen_bb_vertices_str(calculate_bounding_box(d.vertices),
-                                                                     info.block_mesh.bb_offset)
-                         .append(block_mesh_dict_back));
-        auto deformed_mesh = std::make_shared<Mesh>();
-        deformed_mesh->vertices = d.vertices;
-        deformed_mesh->indices = mesh->indices;
-        Halfedge_mesh he_deformed(deformed_mesh);
-        deformed_mesh->normals = he_deformed.calculate_normals();
-        const auto loc_in_def = deformed_mesh->find_random_point_in_mesh(point_offset);
-        save_str_to_file(exp_path / "system" / "snappyHexMeshDict",
-                         snappy_hex_front + gen_castellated_back(loc_in_def).append(snappy_hex_back));
-        auto deformed_mesh_str = gen_mesh_export_str(name, d.vertices, deformed_mesh->normals, wall_indices,
-                                                     inlet_indices_strings,
-                                                     wall.indices, inlet_views, inlets);
-        save_str_to_file(exp_path / "constant" / "triSurface" / file_name, deformed_mesh_str);
-        save_str_to_file(exp_path / std::string(d.name + ".foam"), "");
-    }
+    std::vector<std::filesystem::path> shared_files{
+        "mesh_gen.sh", "run_simulation.sh", std::filesystem::path("system") / "controlDict",
+        std::filesystem::path("system") / "fvSolution", std::filesystem::path("system") / "fvSchemes",
+        std::filesystem::path("system") / "surfaceFeatureExtractDict",
+        std::filesystem::path("constant") / "transportProperties",
+        std::filesystem::path("constant") / "turbulenceProperties"
+    };
     if (info.parallel) {
         save_str_to_file(ref_case_path / "system" / "decomposeParDict", decompose_par_str);
-        for (const auto& d : deformed_meshes) {
-            save_str_to_file(info.export_path / d.name / "system" / "decomposeParDict", decompose_par_str);
+        if (decomposition_plan) {
+            save_str_to_file(ref_case_path / "decomposition_report.txt", decomposition_plan->to_string());
+        }
+        shared_files.emplace_back("run_simulation_parallel.sh");
+        shared_files.push_back(std::filesystem::path("system") / "decomposeParDict");
+    }
+    const Halfedge_mesh he_reference(mesh);
+    // mesh->normals may differ from computed ones, e.g. at hole cap centers, so unmoved vertices copy these instead.
+    const auto reference_normals = he_reference.calculate_normals();
+    std::exception_ptr export_error = nullptr;
+    // The cases are independent, dynamic scheduling balances their differing snappyHexMeshDict and OBJ sizes.
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < static_cast<int>(deformed_meshes.size()); ++i) {
+        try {
+            const auto& d = deformed_meshes.at(i);
+            const auto exp_path = info.export_path / d.name;
+            create_directory(exp_path);
+            create_directory(exp_path / "system");
+            create_directory(exp_path / "constant");
+            create_directory(exp_path / "constant" / "triSurface");
+            create_directory(exp_path / time_dir_name);
+            for (const auto& f : shared_files) {
+                link_shared_file(ref_case_path / f, exp_path / f);
+            }
+            // The initial fields are written by decomposePar and reconstructPar, so they are not shared.
+            save_str_to_file(exp_path / time_dir_name / "U", initial_U_str);
+            save_str_to_file(exp_path / time_dir_name / "p", initial_p_str);
+            save_str_to_file(exp_path / "dist_to_ref.txt", gen_deformed_stats_str(d, scale));
+            save_str_to_file(exp_path / "system" / "blockMeshDict",
+                             block_mesh_dict_front + gen_bb_vertices_str(calculate_bounding_box(d.vertices),
+                                                                         info.block_mesh.bb_offset)
+                             .append(block_mesh_dict_back));
+            Mesh deformed_mesh;
+            deformed_mesh.vertices = d.vertices;
+            deformed_mesh.normals = he_reference.calculate_normals(d.vertices, reference_normals);
+            const auto loc_in_def = deformed_mesh.find_random_point_in_mesh(point_offset);
+            save_str_to_file(exp_path / "system" / "snappyHexMeshDict",
+                             snappy_hex_front + gen_castellated_back(loc_in_def).append(snappy_hex_back));
+            export_mesh_surface(exp_path / "constant" / "triSurface" / file_name, info.surface, name, d.vertices,
+                                deformed_mesh.normals, wall.indices, inlet_views, inlets);
+            save_str_to_file(exp_path / std::string(d.name + ".foam"), "");
         }
+        catch (...) {
+#pragma omp critical
+            if (!export_error) {
+                export_error = std::current_exception();
+            }
+        }
+    }
+    if (export_error) {
+        std::rethrow_exception(export_error);
     }
 }
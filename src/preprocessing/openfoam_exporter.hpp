@@ -215,6 +215,9 @@ namespace tostf
 
         struct Decompose_par_dict {
             int max_sub_domains = 2;
+            // Plans a hierarchical decomposition from the voxelized lumen instead of splitting the bounding box.
+            bool plan = true;
+            int min_cells_per_subdomain = 10000;
         };
 
         struct Surface_feature_extract {
@@ -263,10 +266,14 @@ namespace tostf
             bool snap_active = true;
         };
 
+        // Lambda2, Q and vorticity are computed from U when loading a case, see foam_processing/derived_fields.hpp.
         struct Post_processing {
-            bool lambda2 = true;
             bool wall_shear_stress = true;
-            bool q_criterion = true;
+        };
+
+        enum class surface_format : int {
+            obj = 0,
+            binary_stl = 1
         };
 
         struct OpenFOAM_export_info {
@@ -282,6 +289,8 @@ namespace tostf
             Snappy_hex_mesh_controls snappy_hex_mesh{};
             Mesh_quality_controls mesh_quality{};
             Post_processing post_processing{};
+            // Binary STL files are several times smaller and faster to parse for snappyHexMesh.
+            surface_format surface = surface_format::obj;
             bool execute_export = false;
             bool inlet_specified = false;
             bool parallel = true;
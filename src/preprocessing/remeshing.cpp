@@ -0,0 +1,661 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "remeshing.hpp"
+#include "mesh_processing/edge_key.hpp"
+#include "mesh_processing/halfedge_mesh.hpp"
+#include "utility/logging.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+// Symmetric 4x4 error quadric of Garland and Heckbert. Holds aa, ab, ac, ad, bb, bc, bd, cc, cd, dd of the planes.
+struct Quadric {
+    std::array<double, 10> q{};
+
+    void add_plane(const glm::dvec3& n, const double d, const double weight) {
+        const std::array<double, 10> plane{
+            n.x * n.x, n.x * n.y, n.x * n.z, n.x * d, n.y * n.y, n.y * n.z, n.y * d, n.z * n.z, n.z * d, d * d
+        };
+        for (int i = 0; i < 10; ++i) {
+            q.at(i) += weight * plane.at(i);
+        }
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        for (int i = 0; i < 10; ++i) {
+            q.at(i) += other.q.at(i);
+        }
+        return *this;
+    }
+
+    double evaluate(const glm::dvec3& p) const {
+        return q.at(0) * p.x * p.x + 2.0 * q.at(1) * p.x * p.y + 2.0 * q.at(2) * p.x * p.z + 2.0 * q.at(3) * p.x
+               + q.at(4) * p.y * p.y + 2.0 * q.at(5) * p.y * p.z + 2.0 * q.at(6) * p.y
+               + q.at(7) * p.z * p.z + 2.0 * q.at(8) * p.z + q.at(9);
+    }
+
+    // Position of the smallest error, empty if the quadric is close to singular.
+    std::optional<glm::dvec3> find_optimum() const {
+        const glm::dvec3 r0(q.at(0), q.at(1), q.at(2));
+        const glm::dvec3 r1(q.at(1), q.at(4), q.at(5));
+        const glm::dvec3 r2(q.at(2), q.at(5), q.at(7));
+        const auto det = dot(r0, cross(r1, r2));
+        const auto scale = q.at(0) + q.at(4) + q.at(7);
+        if (glm::abs(det) <= 1e-9 * scale * scale * scale) {
+            return std::nullopt;
+        }
+        // Cramer's rule for A p = -b.
+        const glm::dvec3 b(-q.at(3), -q.at(6), -q.at(8));
+        const auto c12 = cross(r1, r2);
+        const auto c20 = cross(r2, r0);
+        const auto c01 = cross(r0, r1);
+        return glm::dvec3(dot(b, c12), dot(b, c20), dot(b, c01)) / det;
+    }
+};
+
+// Indexed triangle soup that is edited in place. Removed faces are marked dead and the faces around every vertex
+// are rebuilt before each pass.
+struct Collapse_mesh {
+    std::vector<glm::vec3> positions;
+    std::vector<std::array<unsigned, 3>> faces;
+    std::vector<unsigned char> face_alive;
+    std::vector<unsigned char> locked;
+    std::vector<Quadric> quadrics;
+    // Faces around vertex v are vertex_faces[face_offsets[v]] to vertex_faces[face_offsets[v + 1]].
+    std::vector<unsigned> face_offsets;
+    std::vector<unsigned> vertex_faces;
+};
+
+struct Collapse {
+    unsigned keep = 0;
+    unsigned remove = 0;
+    glm::vec3 position{};
+    double cost = 0.0;
+};
+
+Collapse_mesh init_collapse_mesh(const std::shared_ptr<tostf::Mesh>& mesh, const std::vector<unsigned char>& locked,
+                                 const float feature_angle) {
+    if (!locked.empty() && locked.size() != mesh->vertices.size()) {
+        throw std::runtime_error{"Locked vertices do not match the mesh vertices."};
+    }
+    Collapse_mesh m;
+    m.positions.resize(mesh->vertices.size());
+#pragma omp parallel for
+    for (int v = 0; v < static_cast<int>(mesh->vertices.size()); ++v) {
+        m.positions.at(v) = glm::vec3(mesh->vertices.at(v));
+    }
+    m.faces.resize(mesh->indices.size() / 3);
+#pragma omp parallel for
+    for (int f = 0; f < static_cast<int>(m.faces.size()); ++f) {
+        m.faces.at(f) = {mesh->indices.at(3 * f), mesh->indices.at(3 * f + 1), mesh->indices.at(3 * f + 2)};
+    }
+    m.face_alive.assign(m.faces.size(), 1);
+    m.locked = tostf::Halfedge_mesh(mesh).find_feature_vertices(feature_angle);
+    for (int v = 0; v < static_cast<int>(locked.size()); ++v) {
+        m.locked.at(v) = static_cast<unsigned char>(m.locked.at(v) | locked.at(v));
+    }
+    return m;
+}
+
+void build_vertex_faces(Collapse_mesh& m) {
+    const auto vertex_count = static_cast<int>(m.positions.size());
+    m.face_offsets.assign(vertex_count + 1, 0);
+    for (int f = 0; f < static_cast<int>(m.faces.size()); ++f) {
+        if (m.face_alive.at(f) != 0) {
+            for (const auto v : m.faces.at(f)) {
+                ++m.face_offsets.at(v + 1);
+            }
+        }
+    }
+    for (int v = 0; v < vertex_count; ++v) {
+        m.face_offsets.at(v + 1) += m.face_offsets.at(v);
+    }
+    m.vertex_faces.resize(m.face_offsets.back());
+    std::vector<unsigned> fill(m.face_offsets.begin(), m.face_offsets.end() - 1);
+    for (int f = 0; f < static_cast<int>(m.faces.size()); ++f) {
+        if (m.face_alive.at(f) != 0) {
+            for (const auto v : m.faces.at(f)) {
+                m.vertex_faces.at(fill.at(v)++) = static_cast<unsigned>(f);
+            }
+        }
+    }
+}
+
+bool contains_vertex(const std::array<unsigned, 3>& face, const unsigned v) {
+    return face.at(0) == v || face.at(1) == v || face.at(2) == v;
+}
+
+std::vector<unsigned> collect_neighbors(const Collapse_mesh& m, const unsigned v) {
+    std::vector<unsigned> neighbors;
+    for (auto i = m.face_offsets.at(v); i < m.face_offsets.at(v + 1); ++i) {
+        for (const auto n : m.faces.at(m.vertex_faces.at(i))) {
+            if (n != v) {
+                neighbors.push_back(n);
+            }
+        }
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    return neighbors;
+}
+
+// Keeps a locked endpoint in place, otherwise the position is chosen by the caller.
+std::optional<Collapse> orient_collapse(const Collapse_mesh& m, const unsigned v0, const unsigned v1) {
+    if (m.locked.at(v0) != 0 && m.locked.at(v1) != 0) {
+        return std::nullopt;
+    }
+    if (m.locked.at(v1) != 0) {
+        return Collapse{v1, v0, m.positions.at(v1)};
+    }
+    return Collapse{v0, v1, m.positions.at(v0)};
+}
+
+std::optional<Collapse> find_quadric_collapse(const Collapse_mesh& m, const unsigned v0, const unsigned v1) {
+    auto collapse = orient_collapse(m, v0, v1);
+    if (!collapse) {
+        return std::nullopt;
+    }
+    auto q = m.quadrics.at(v0);
+    q += m.quadrics.at(v1);
+    if (m.locked.at(collapse->keep) == 0) {
+        const auto optimum = q.find_optimum();
+        if (optimum) {
+            collapse->position = glm::vec3(optimum.value());
+        }
+        else {
+            // Flat regions have no unique optimum, the best of the endpoints and the midpoint is taken.
+            const auto mid = 0.5f * (m.positions.at(v0) + m.positions.at(v1));
+            for (const auto& p : {m.positions.at(v1), mid}) {
+                if (q.evaluate(glm::dvec3(p)) < q.evaluate(glm::dvec3(collapse->position))) {
+                    collapse->position = p;
+                }
+            }
+        }
+    }
+    collapse->cost = q.evaluate(glm::dvec3(collapse->position));
+    return collapse;
+}
+
+std::optional<Collapse> find_short_edge_collapse(const Collapse_mesh& m, const unsigned v0, const unsigned v1,
+                                                 const float min_length, const float max_length) {
+    const auto edge_length = distance(m.positions.at(v0), m.positions.at(v1));
+    if (edge_length >= min_length) {
+        return std::nullopt;
+    }
+    auto collapse = orient_collapse(m, v0, v1);
+    if (!collapse) {
+        return std::nullopt;
+    }
+    if (m.locked.at(collapse->keep) == 0) {
+        collapse->position = 0.5f * (m.positions.at(v0) + m.positions.at(v1));
+    }
+    // Collapses that create long edges would be split again in the next iteration.
+    for (const auto v : {v0, v1}) {
+        for (auto i = m.face_offsets.at(v); i < m.face_offsets.at(v + 1); ++i) {
+            for (const auto n : m.faces.at(m.vertex_faces.at(i))) {
+                if (distance(m.positions.at(n), collapse->position) > max_length && n != v0 && n != v1) {
+                    return std::nullopt;
+                }
+            }
+        }
+    }
+    collapse->cost = edge_length;
+    return collapse;
+}
+
+// Rejects collapses that make the mesh non-manifold or flip or degenerate a remaining face.
+bool is_collapse_valid(const Collapse_mesh& m, const Collapse& c) {
+    int shared_faces = 0;
+    for (auto i = m.face_offsets.at(c.remove); i < m.face_offsets.at(c.remove + 1); ++i) {
+        shared_faces += contains_vertex(m.faces.at(m.vertex_faces.at(i)), c.keep) ? 1 : 0;
+    }
+    // Link condition, the endpoints may only share the vertices opposite of the collapsed edge.
+    const auto keep_neighbors = collect_neighbors(m, c.keep);
+    const auto remove_neighbors = collect_neighbors(m, c.remove);
+    std::vector<unsigned> common;
+    std::set_intersection(keep_neighbors.begin(), keep_neighbors.end(), remove_neighbors.begin(),
+                          remove_neighbors.end(), std::back_inserter(common));
+    if (static_cast<int>(common.size()) != shared_faces) {
+        return false;
+    }
+    for (const auto v : {c.keep, c.remove}) {
+        for (auto i = m.face_offsets.at(v); i < m.face_offsets.at(v + 1); ++i) {
+            const auto& face = m.faces.at(m.vertex_faces.at(i));
+            if (contains_vertex(face, c.keep) && contains_vertex(face, c.remove)) {
+                continue;
+            }
+            std::array<glm::vec3, 3> points{};
+            std::array<glm::vec3, 3> moved{};
+            for (int k = 0; k < 3; ++k) {
+                points.at(k) = m.positions.at(face.at(k));
+                moved.at(k) = face.at(k) == v ? c.position : points.at(k);
+            }
+            const auto old_normal = cross(points.at(1) - points.at(0), points.at(2) - points.at(0));
+            const auto new_normal = cross(moved.at(1) - moved.at(0), moved.at(2) - moved.at(0));
+            const auto new_length = length(new_normal);
+            if (new_length <= std::numeric_limits<float>::min()) {
+                return false;
+            }
+            const auto old_length = length(old_normal);
+            if (old_length > 0.0f && dot(old_normal, new_normal) < 0.2f * old_length * new_length) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Returns the number of removed faces.
+int collapse_edge(Collapse_mesh& m, const Collapse& c, std::vector<unsigned char>& dirty) {
+    int removed = 0;
+    for (const auto v : {c.keep, c.remove}) {
+        for (auto i = m.face_offsets.at(v); i < m.face_offsets.at(v + 1); ++i) {
+            for (const auto n : m.faces.at(m.vertex_faces.at(i))) {
+                dirty.at(n) = 1;
+            }
+        }
+    }
+    for (auto i = m.face_offsets.at(c.remove); i < m.face_offsets.at(c.remove + 1); ++i) {
+        const auto f = m.vertex_faces.at(i);
+        auto& face = m.faces.at(f);
+        if (contains_vertex(face, c.keep)) {
+            m.face_alive.at(f) = 0;
+            ++removed;
+            continue;
+        }
+        for (auto& v : face) {
+            if (v == c.remove) {
+                v = c.keep;
+            }
+        }
+    }
+    m.positions.at(c.keep) = c.position;
+    if (!m.quadrics.empty()) {
+        m.quadrics.at(c.keep) += m.quadrics.at(c.remove);
+    }
+    return removed;
+}
+
+// One pass of independent collapses. Every vertex takes part in at most one collapse and only edges whose faces
+// lie completely inside of a single region are collapsed, so the regions are processed in parallel.
+// find_candidate returns the collapse for an edge or nothing. Every region removes at most its share of
+// max_removed faces. Returns the number of removed faces.
+template <typename Candidate_func>
+int run_collapse_pass(Collapse_mesh& m, const int pass, const int region_resolution,
+                      const Candidate_func& find_candidate,
+                      const size_t max_removed = std::numeric_limits<size_t>::max()) {
+    build_vertex_faces(m);
+    const auto vertex_count = static_cast<int>(m.positions.size());
+    const auto face_count = static_cast<int>(m.faces.size());
+    glm::vec3 bb_min(std::numeric_limits<float>::max());
+    glm::vec3 bb_max(std::numeric_limits<float>::lowest());
+    for (const auto& p : m.positions) {
+        bb_min = glm::min(bb_min, p);
+        bb_max = glm::max(bb_max, p);
+    }
+    const auto resolution = glm::max(region_resolution, 1);
+    const auto cell_size = glm::max((bb_max - bb_min) / static_cast<float>(resolution), glm::vec3(1e-20f));
+    const auto shift = pass % 2 == 1 ? 0.5f * cell_size : glm::vec3(0.0f);
+    const auto cells_per_axis = resolution + 1;
+    std::vector<int> vertex_regions(vertex_count);
+#pragma omp parallel for
+    for (int v = 0; v < vertex_count; ++v) {
+        const auto cell = glm::clamp(glm::ivec3((m.positions.at(v) - bb_min + shift) / cell_size), glm::ivec3(0),
+                                glm::ivec3(cells_per_axis - 1));
+        vertex_regions.at(v) = (cell.z * cells_per_axis + cell.y) * cells_per_axis + cell.x;
+    }
+    std::vector<int> face_regions(face_count, -1);
+#pragma omp parallel for
+    for (int f = 0; f < face_count; ++f) {
+        const auto& face = m.faces.at(f);
+        const auto region = vertex_regions.at(face.at(0));
+        if (m.face_alive.at(f) != 0 && vertex_regions.at(face.at(1)) == region
+            && vertex_regions.at(face.at(2)) == region) {
+            face_regions.at(f) = region;
+        }
+    }
+    std::vector<unsigned char> interior(vertex_count, 0);
+#pragma omp parallel for
+    for (int v = 0; v < vertex_count; ++v) {
+        auto is_interior = m.face_offsets.at(v) < m.face_offsets.at(v + 1);
+        for (auto i = m.face_offsets.at(v); i < m.face_offsets.at(v + 1) && is_interior; ++i) {
+            is_interior = face_regions.at(m.vertex_faces.at(i)) == vertex_regions.at(v);
+        }
+        interior.at(v) = is_interior ? 1 : 0;
+    }
+    // Counting sort of the faces by region keeps them ordered by id inside of every region.
+    const auto region_count = cells_per_axis * cells_per_axis * cells_per_axis;
+    std::vector<unsigned> region_offsets(region_count + 1, 0);
+    for (int f = 0; f < face_count; ++f) {
+        if (face_regions.at(f) >= 0) {
+            ++region_offsets.at(face_regions.at(f) + 1);
+        }
+    }
+    for (int r = 0; r < region_count; ++r) {
+        region_offsets.at(r + 1) += region_offsets.at(r);
+    }
+    std::vector<unsigned> region_faces(region_offsets.back());
+    std::vector<unsigned> fill(region_offsets.begin(), region_offsets.end() - 1);
+    for (int f = 0; f < face_count; ++f) {
+        if (face_regions.at(f) >= 0) {
+            region_faces.at(fill.at(face_regions.at(f))++) = static_cast<unsigned>(f);
+        }
+    }
+    std::vector<unsigned char> dirty(vertex_count, 0);
+    std::vector<int> removed(region_count, 0);
+    const auto region_face_count = static_cast<double>(region_faces.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int r = 0; r < region_count; ++r) {
+        const auto budget = glm::ceil(static_cast<double>(max_removed)
+                                      * static_cast<double>(region_offsets.at(r + 1) - region_offsets.at(r))
+                                      / glm::max(region_face_count, 1.0));
+        for (auto i = region_offsets.at(r); i < region_offsets.at(r + 1)
+                                            && static_cast<double>(removed.at(r)) < budget; ++i) {
+            const auto f = region_faces.at(i);
+            const auto face = m.faces.at(f);
+            if (m.face_alive.at(f) == 0 || dirty.at(face.at(0)) != 0 || dirty.at(face.at(1)) != 0
+                || dirty.at(face.at(2)) != 0) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                const auto v0 = face.at(k);
+                const auto v1 = face.at((k + 1) % 3);
+                if (interior.at(v0) == 0 || interior.at(v1) == 0) {
+                    continue;
+                }
+                const auto collapse = find_candidate(v0, v1);
+                if (collapse && is_collapse_valid(m, collapse.value())) {
+                    removed.at(r) += collapse_edge(m, collapse.value(), dirty);
+                    break;
+                }
+            }
+        }
+    }
+    int removed_faces = 0;
+    for (const auto r : removed) {
+        removed_faces += r;
+    }
+    return removed_faces;
+}
+
+// Splits every edge longer than max_length at its midpoint. Faces are split into two to four faces depending on
+// their number of split edges. Returns the number of split edges.
+int split_long_edges(Collapse_mesh& m, const float max_length, const float feature_angle) {
+    const auto face_count = static_cast<int>(m.faces.size());
+    // Both faces of a long edge store its key, so the faces sharing an edge end up next to each other after sorting.
+    std::vector<std::pair<uint64_t, unsigned>> face_keys(3 * static_cast<size_t>(face_count),
+                                                         {std::numeric_limits<uint64_t>::max(), 0});
+#pragma omp parallel for
+    for (int f = 0; f < face_count; ++f) {
+        if (m.face_alive.at(f) == 0) {
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            const auto a = m.faces.at(f).at(k);
+            const auto b = m.faces.at(f).at((k + 1) % 3);
+            if (distance(m.positions.at(a), m.positions.at(b)) > max_length) {
+                face_keys.at(3 * f + k) = {tostf::undirected_edge_key(a, b), static_cast<unsigned>(f)};
+            }
+        }
+    }
+    std::sort(std::execution::par, face_keys.begin(), face_keys.end());
+    while (!face_keys.empty() && face_keys.back().first == std::numeric_limits<uint64_t>::max()) {
+        face_keys.pop_back();
+    }
+    std::vector<uint64_t> keys;
+    std::vector<size_t> key_runs;
+    for (size_t i = 0; i < face_keys.size(); ++i) {
+        if (i == 0 || face_keys.at(i).first != face_keys.at(i - 1).first) {
+            keys.push_back(face_keys.at(i).first);
+            key_runs.push_back(i);
+        }
+    }
+    key_runs.push_back(face_keys.size());
+    const auto split_count = static_cast<int>(keys.size());
+    if (split_count == 0) {
+        return 0;
+    }
+    const auto min_cos = glm::cos(glm::radians(feature_angle));
+    const auto face_normal = [&m](const unsigned f) {
+        const auto& face = m.faces.at(f);
+        const auto normal = cross(m.positions.at(face.at(1)) - m.positions.at(face.at(0)),
+                                  m.positions.at(face.at(2)) - m.positions.at(face.at(0)));
+        const auto normal_length = length(normal);
+        return normal_length > 0.0f ? normal / normal_length : normal;
+    };
+    const auto first_new = static_cast<unsigned>(m.positions.size());
+    m.positions.resize(m.positions.size() + split_count);
+    m.locked.resize(m.positions.size());
+#pragma omp parallel for
+    for (int e = 0; e < split_count; ++e) {
+        const auto [a, b] = tostf::edge_key_vertices(keys.at(e));
+        m.positions.at(first_new + e) = 0.5f * (m.positions.at(a) + m.positions.at(b));
+        // Midpoints are locked on boundary, non-manifold and feature edges only. Edges between two locked vertices
+        // can also cross the surface from one boundary or feature line to another.
+        const auto run = key_runs.at(e);
+        const auto is_feature = key_runs.at(e + 1) - run != 2
+                                || dot(face_normal(face_keys.at(run).second),
+                                       face_normal(face_keys.at(run + 1).second)) < min_cos;
+        m.locked.at(first_new + e) = static_cast<unsigned char>(is_feature ? 1 : 0);
+    }
+    const auto find_midpoint = [&keys, first_new](const unsigned a, const unsigned b) {
+        const auto key = tostf::undirected_edge_key(a, b);
+        const auto it = std::lower_bound(keys.begin(), keys.end(), key);
+        return it != keys.end() && *it == key ? static_cast<int>(first_new + (it - keys.begin())) : -1;
+    };
+    std::vector<std::array<int, 3>> midpoints(face_count, {-1, -1, -1});
+    std::vector<unsigned> face_offsets(face_count + 1, 0);
+#pragma omp parallel for
+    for (int f = 0; f < face_count; ++f) {
+        if (m.face_alive.at(f) == 0) {
+            continue;
+        }
+        unsigned new_faces = 1;
+        for (int k = 0; k < 3; ++k) {
+            midpoints.at(f).at(k) = find_midpoint(m.faces.at(f).at(k), m.faces.at(f).at((k + 1) % 3));
+            new_faces += midpoints.at(f).at(k) >= 0 ? 1 : 0;
+        }
+        face_offsets.at(f + 1) = new_faces;
+    }
+    for (int f = 0; f < face_count; ++f) {
+        face_offsets.at(f + 1) += face_offsets.at(f);
+    }
+    std::vector<std::array<unsigned, 3>> faces(face_offsets.back());
+#pragma omp parallel for
+    for (int f = 0; f < face_count; ++f) {
+        if (m.face_alive.at(f) == 0) {
+            continue;
+        }
+        auto out = face_offsets.at(f);
+        const auto& mids = midpoints.at(f);
+        const auto split_edges = (mids.at(0) >= 0 ? 1 : 0) + (mids.at(1) >= 0 ? 1 : 0) + (mids.at(2) >= 0 ? 1 : 0);
+        // Rotates the face so that the first edge is split and, for two split edges, the last one is not.
+        int rot = 0;
+        if (split_edges == 1) {
+            rot = mids.at(0) >= 0 ? 0 : mids.at(1) >= 0 ? 1 : 2;
+        }
+        else if (split_edges == 2) {
+            rot = mids.at(2) < 0 ? 0 : mids.at(0) < 0 ? 1 : 2;
+        }
+        const auto a = m.faces.at(f).at(rot);
+        const auto b = m.faces.at(f).at((rot + 1) % 3);
+        const auto c = m.faces.at(f).at((rot + 2) % 3);
+        const auto m0 = static_cast<unsigned>(mids.at(rot));
+        const auto m1 = static_cast<unsigned>(mids.at((rot + 1) % 3));
+        const auto m2 = static_cast<unsigned>(mids.at((rot + 2) % 3));
+        if (split_edges == 0) {
+            faces.at(out) = {a, b, c};
+        }
+        else if (split_edges == 1) {
+            faces.at(out++) = {a, m0, c};
+            faces.at(out) = {m0, b, c};
+        }
+        else if (split_edges == 2) {
+            faces.at(out++) = {m0, b, m1};
+            faces.at(out++) = {a, m0, m1};
+            faces.at(out) = {a, m1, c};
+        }
+        else {
+            faces.at(out++) = {a, m0, m2};
+            faces.at(out++) = {m0, b, m1};
+            faces.at(out++) = {m2, m1, c};
+            faces.at(out) = {m0, m1, m2};
+        }
+    }
+    m.faces = std::move(faces);
+    m.face_alive.assign(m.faces.size(), 1);
+    return split_count;
+}
+
+// Moves every unlocked vertex towards the centroid of its neighbors within its tangent plane.
+void relax_tangentially(Collapse_mesh& m) {
+    build_vertex_faces(m);
+    const auto vertex_count = static_cast<int>(m.positions.size());
+    std::vector<glm::vec3> relaxed(m.positions);
+#pragma omp parallel for
+    for (int v = 0; v < vertex_count; ++v) {
+        const auto begin = m.face_offsets.at(v);
+        const auto end = m.face_offsets.at(v + 1);
+        if (m.locked.at(v) != 0 || begin == end) {
+            continue;
+        }
+        glm::vec3 normal(0.0f);
+        glm::vec3 centroid(0.0f);
+        for (auto i = begin; i < end; ++i) {
+            const auto& face = m.faces.at(m.vertex_faces.at(i));
+            const auto& p0 = m.positions.at(face.at(0));
+            const auto& p1 = m.positions.at(face.at(1));
+            const auto& p2 = m.positions.at(face.at(2));
+            normal += cross(p1 - p0, p2 - p0);
+            centroid += p0 + p1 + p2 - m.positions.at(v);
+        }
+        if (dot(normal, normal) <= 0.0f) {
+            continue;
+        }
+        normal = normalize(normal);
+        const auto offset = centroid / (2.0f * static_cast<float>(end - begin)) - m.positions.at(v);
+        relaxed.at(v) = m.positions.at(v) + offset - dot(offset, normal) * normal;
+    }
+    m.positions = std::move(relaxed);
+}
+
+// Removes dead faces and unreferenced vertices and recalculates the normals.
+std::shared_ptr<tostf::Mesh> to_mesh(const Collapse_mesh& m) {
+    std::vector<int> remap(m.positions.size(), -1);
+    auto mesh = std::make_shared<tostf::Mesh>();
+    for (int f = 0; f < static_cast<int>(m.faces.size()); ++f) {
+        if (m.face_alive.at(f) == 0) {
+            continue;
+        }
+        for (const auto v : m.faces.at(f)) {
+            if (remap.at(v) < 0) {
+                remap.at(v) = static_cast<int>(mesh->vertices.size());
+                mesh->vertices.emplace_back(m.positions.at(v), 1.0f);
+            }
+            mesh->indices.push_back(static_cast<unsigned>(remap.at(v)));
+        }
+    }
+    mesh->normals = tostf::Halfedge_mesh(mesh).calculate_normals();
+    return mesh;
+}
+
+float tostf::calc_target_edge_length(const Mesh_stats& stats, const float factor) {
+    return factor * stats.edge_length_distribution.quantiles.at(2);
+}
+
+std::shared_ptr<tostf::Mesh> tostf::decimate_mesh(const std::shared_ptr<Mesh>& mesh, const size_t target_face_count,
+                                                  const Remeshing_settings& settings,
+                                                  const std::vector<unsigned char>& locked) {
+    auto m = init_collapse_mesh(mesh, locked, settings.feature_angle);
+    build_vertex_faces(m);
+    // Area weighted plane quadrics of the faces around every vertex.
+    m.quadrics.resize(m.positions.size());
+#pragma omp parallel for
+    for (int v = 0; v < static_cast<int>(m.positions.size()); ++v) {
+        for (auto i = m.face_offsets.at(v); i < m.face_offsets.at(v + 1); ++i) {
+            const auto& face = m.faces.at(m.vertex_faces.at(i));
+            const glm::dvec3 p0(m.positions.at(face.at(0)));
+            const auto normal = cross(glm::dvec3(m.positions.at(face.at(1))) - p0,
+                                      glm::dvec3(m.positions.at(face.at(2))) - p0);
+            const auto double_area = length(normal);
+            if (double_area > 0.0) {
+                const auto n = normal / double_area;
+                m.quadrics.at(v).add_plane(n, -dot(n, p0), 0.5 * double_area);
+            }
+        }
+    }
+    auto alive_count = m.faces.size();
+    int idle_passes = 0;
+    for (int pass = 0; pass < settings.max_passes && alive_count > target_face_count && idle_passes < 2; ++pass) {
+        build_vertex_faces(m);
+        // Only the cheapest collapses are allowed in this pass. Every vertex collapses at most once per pass,
+        // so more candidates than needed for the target are admitted and the regions stop at their budget.
+        std::vector<double> costs(m.faces.size(), std::numeric_limits<double>::max());
+#pragma omp parallel for
+        for (int f = 0; f < static_cast<int>(m.faces.size()); ++f) {
+            if (m.face_alive.at(f) == 0) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                const auto collapse = find_quadric_collapse(m, m.faces.at(f).at(k), m.faces.at(f).at((k + 1) % 3));
+                if (collapse) {
+                    costs.at(f) = glm::min(costs.at(f), collapse->cost);
+                }
+            }
+        }
+        const auto remaining = alive_count - target_face_count;
+        const auto threshold_id = glm::min(4 * remaining, costs.size() - 1);
+        std::nth_element(costs.begin(), costs.begin() + static_cast<std::ptrdiff_t>(threshold_id), costs.end());
+        const auto threshold = costs.at(threshold_id);
+        const auto removed = run_collapse_pass(m, pass, settings.region_resolution,
+                                               [&m, threshold](const unsigned v0, const unsigned v1) {
+                                                   auto collapse = find_quadric_collapse(m, v0, v1);
+                                                   if (collapse && collapse->cost > threshold) {
+                                                       collapse.reset();
+                                                   }
+                                                   return collapse;
+                                               }, remaining);
+        alive_count -= static_cast<size_t>(removed);
+        idle_passes = removed == 0 ? idle_passes + 1 : 0;
+    }
+    log_info() << "Decimated mesh from " << mesh->indices.size() / 3 << " to " << alive_count << " faces.";
+    return to_mesh(m);
+}
+
+std::shared_ptr<tostf::Mesh> tostf::remesh_isotropic(const std::shared_ptr<Mesh>& mesh, const float target_edge_length,
+                                                     const int iterations, const Remeshing_settings& settings,
+                                                     const std::vector<unsigned char>& locked) {
+    if (target_edge_length <= 0.0f) {
+        throw std::runtime_error{"Target edge length has to be positive."};
+    }
+    auto m = init_collapse_mesh(mesh, locked, settings.feature_angle);
+    const auto min_length = 0.8f * target_edge_length;
+    const auto max_length = 4.0f / 3.0f * target_edge_length;
+    for (int it = 0; it < iterations; ++it) {
+        split_long_edges(m, max_length, settings.feature_angle);
+        int idle_passes = 0;
+        for (int pass = 0; pass < settings.max_passes && idle_passes < 2; ++pass) {
+            const auto removed = run_collapse_pass(m, pass, settings.region_resolution,
+                                                   [&m, min_length, max_length](const unsigned v0, const unsigned v1) {
+                                                       return find_short_edge_collapse(m, v0, v1, min_length,
+                                                                                       max_length);
+                                                   });
+            idle_passes = removed == 0 ? idle_passes + 1 : 0;
+        }
+        relax_tangentially(m);
+    }
+    auto result = to_mesh(m);
+    log_info() << "Remeshed mesh from " << mesh->indices.size() / 3 << " to " << result->indices.size() / 3
+        << " faces.";
+    return result;
+}
@@ -0,0 +1,36 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include "geometry/mesh.hpp"
+
+namespace tostf
+{
+    struct Remeshing_settings {
+        // Edges whose faces enclose a larger angle in degrees are kept, e.g. the rims of inlet caps.
+        float feature_angle = 40.0f;
+        // Collapses run in parallel on a grid of regions per axis. Every region only edits its interior vertices in
+        // face id order, edges crossing regions are skipped and the grid is shifted by half a region every pass.
+        int region_resolution = 4;
+        int max_passes = 64;
+    };
+
+    // Target edge length for isotropic remeshing as a multiple of the median edge length.
+    float calc_target_edge_length(const Mesh_stats& stats, float factor = 1.0f);
+
+    // Quadric error metric edge collapses until about target_face_count faces remain. Vertices on boundaries,
+    // feature edges and vertices marked in locked keep their position, so inlet boundaries are preserved.
+    std::shared_ptr<Mesh> decimate_mesh(const std::shared_ptr<Mesh>& mesh, size_t target_face_count,
+                                        const Remeshing_settings& settings = {},
+                                        const std::vector<unsigned char>& locked = {});
+    // Per iteration edges longer than 4/3 of the target edge length are split, edges shorter than 4/5 of it are
+    // collapsed and the vertices are relaxed tangentially. Vertices are locked as in decimate_mesh.
+    std::shared_ptr<Mesh> remesh_isotropic(const std::shared_ptr<Mesh>& mesh, float target_edge_length,
+                                           int iterations = 3, const Remeshing_settings& settings = {},
+                                           const std::vector<unsigned char>& locked = {});
+}
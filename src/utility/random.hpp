@@ -8,6 +8,7 @@
 #pragma once
 
 #include <random>
+#include <cstdint>
 #include "math/glm_helper.hpp"
 
 namespace tostf
@@ -40,4 +41,18 @@ namespace tostf
         }
         return res;
     }
+
+    // Finalizer of splitmix64, scrambles all bits of the input.
+    inline uint64_t mix_bits(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Counter based random value in [0, 1). The same seed and counter always give the same value,
+    // so parallel loops can draw random numbers independently of the thread schedule.
+    inline float gen_counter_random_float(const uint64_t seed, const uint64_t counter) {
+        const auto bits = mix_bits(mix_bits(seed + 0x9E3779B97F4A7C15ull) + counter);
+        return static_cast<float>(bits >> 40) / static_cast<float>(1ull << 24);
+    }
 }
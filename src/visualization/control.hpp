@@ -14,8 +14,13 @@
 #include "glm/gtx/component_wise.hpp"
 #include "vis_utilities.hpp"
 #include "foam_processing/volume_grid.hpp"
+#include "foam_processing/case_comparison.hpp"
+#include "foam_processing/case_export.hpp"
+#include "foam_processing/derived_fields.hpp"
+#include "foam_processing/temporal_statistics.hpp"
 #include "visualization.hpp"
 #include "math/advanced_techniques.hpp"
+#include "flow_seeding.hpp"
 #include "assimp/postprocess.h"
 
 namespace tostf::vis
@@ -169,13 +174,15 @@ namespace tostf::vis
     };
 
     struct Flow_handler {
-        void init(const float mesh_scale, const int max_pathline_steps) {
+        void init(const float mesh_scale, const int max_pathline_steps, const foam::Poly_mesh& mesh,
+                  const foam::Grid_info& grid_info) {
+            settings.seed_sphere_radius = mesh_scale;
+            pathline_settings.max_pathline_steps = max_pathline_steps;
+            lumen_mask = Lumen_mask(grid_info, mesh);
             vao = std::make_unique<VAO>();
             init_line_buffer();
             init_pathlines_buffer();
-            init_seeds();
-            settings.seed_sphere_radius = mesh_scale;
-            pathline_settings.max_pathline_steps = max_pathline_steps;
+            init_seeds(mesh);
         }
 
         void init_line_buffer() {
@@ -188,15 +195,36 @@ namespace tostf::vis
             pathlines->set_data(std::vector<glm::vec4>(settings.line_count * pathline_settings.max_pathline_steps, glm::vec4(0)));
         }
 
-        void init_seeds() {
-            auto seed_points = generate_points_on_sphere(settings.line_count, settings.seed_sphere_radius,
-                                                     glm::vec3(settings.seed_sphere_pos));
-            seeds = std::make_unique<SSBO>(vis_ssbo_defines::streamline_seeds, seed_points);
+        // Only inlet plane and velocity weighted seeding sample the velocity field.
+        bool seeding_uses_velocities() const {
+            return seeding.strategy == seeding_strategy::inlet_planes
+                   || seeding.strategy == seeding_strategy::velocity_weighted;
+        }
+
+        // Falls back to the seed sphere if the selected strategy cannot place any seeds.
+        std::vector<glm::vec4> gen_seed_points(const foam::Poly_mesh& mesh,
+                                               const std::vector<glm::vec4>& velocities) const {
+            std::vector<glm::vec4> seed_points;
+            if (seeding.strategy == seeding_strategy::inlet_planes) {
+                seed_points = gen_inlet_seeds(find_inflow_boundaries(mesh, velocities), settings.line_count, seeding,
+                                              lumen_mask);
+            }
+            else if (seeding.strategy == seeding_strategy::velocity_weighted && !velocities.empty()) {
+                seed_points = gen_velocity_weighted_seeds(mesh, velocities, settings.line_count, seeding, lumen_mask);
+            }
+            if (seed_points.empty()) {
+                seed_points = gen_sphere_seeds(settings.line_count, settings.seed_sphere_radius,
+                                               glm::vec3(settings.seed_sphere_pos), seeding, lumen_mask);
+            }
+            return seed_points;
+        }
+
+        void init_seeds(const foam::Poly_mesh& mesh, const std::vector<glm::vec4>& velocities = {}) {
+            seeds = std::make_unique<SSBO>(vis_ssbo_defines::streamline_seeds, gen_seed_points(mesh, velocities));
         }
 
-        void init_pathline_integrators() {
-            auto seed_points = generate_points_on_sphere(settings.line_count, settings.seed_sphere_radius,
-                                                     glm::vec3(settings.seed_sphere_pos));
+        void init_pathline_integrators(const foam::Poly_mesh& mesh, const std::vector<glm::vec4>& velocities = {}) {
+            auto seed_points = gen_seed_points(mesh, velocities);
             std::vector<Pathline_integrator> integrators(seed_points.size());
 #pragma omp parallel for
             for (int i = 0; i < static_cast<int>(seed_points.size()); ++i) {
@@ -234,6 +262,8 @@ namespace tostf::vis
         std::shared_ptr<SSBO> pathline_integrator;
 		Streamline_settings settings;
         Pathline_settings pathline_settings;
+        Seeding_settings seeding;
+        Lumen_mask lumen_mask;
         bool seeds_set = false;
         bool updated = false;
         bool pathlines_generated = false;
@@ -267,17 +297,7 @@ namespace tostf::vis
         explicit Case(std::filesystem::path case_path, bool skip_first)
             : path(std::move(case_path)) {
             mesh.load(path);
-            for (auto& p : std::filesystem::directory_iterator(path)) {
-                if (p.is_directory() && is_str_float(p.path().filename().string())) {
-                    if (!skip_first) {
-                        player.steps.push_back(p.path().filename().string());
-                    }
-                    skip_first = false;
-                }
-            }
-            std::sort(player.steps.begin(), player.steps.end(), [](const std::string& a, const std::string& b) {
-				return std::stof(a) < std::stof(b);
-			});
+            player.steps = foam::find_time_steps(path, skip_first);
             if (!player.steps.empty()) {
                 for (auto& f : std::filesystem::directory_iterator(path / player.steps.at(0))) {
                     if (f.is_regular_file()) {
@@ -285,6 +305,12 @@ namespace tostf::vis
                         fields.insert_or_assign(f.path().filename().string(), desc);
                     }
                 }
+                // Derived fields written by postProcess are read from the case, the others are computed from U.
+                for (const auto& f : foam::get_derived_field_names()) {
+                    if (fields.find(f) == fields.end() && foam::has_step_field(mesh, player.steps.at(0), f)) {
+                        fields.emplace(f, Field_description{foam::is_derived_vector_field(f)});
+                    }
+                }
             }
             auto mesh_path = std::filesystem::path(path / "constant" / "triSurface");
             for (auto& f : std::filesystem::directory_iterator(mesh_path)) {
@@ -356,16 +382,43 @@ namespace tostf::vis
         }
 
         inline foam::Field<float> load_scalar_field(const std::string& field_name) {
-            const auto field = mesh.load_scalar_field_from_file(player.steps.at(player.current_step), field_name);
+            const auto temporal_it = temporal_fields.find(field_name);
+            if (temporal_it != temporal_fields.end()) {
+                return temporal_it->second;
+            }
+            const auto difference = foam::parse_difference_field_name(field_name);
+            const auto field = difference ? load_difference_field(difference->first, difference->second)
+                                          : foam::load_step_scalar_field(mesh, player.steps.at(player.current_step),
+                                                                         field_name);
             fields.at(field_name).min_scalar = glm::min(fields.at(field_name).min_scalar, field.min);
             fields.at(field_name).max_scalar = glm::max(fields.at(field_name).max_scalar, field.max);
             return field;
         }
 
+        // Difference of the current step to the current step of the reference case on this mesh. The reference case
+        // itself has no difference_reference and its differences are zero.
+        inline foam::Field<float> load_difference_field(const std::string& field_name, const bool relative) const {
+            if (difference_reference && correspondence) {
+                const auto& ref_player = difference_reference->player;
+                auto difference = foam::calc_field_difference(*correspondence, difference_reference->mesh,
+                                                              ref_player.steps.at(ref_player.current_step), mesh,
+                                                              player.steps.at(player.current_step), field_name);
+                return relative ? std::move(difference.relative_difference) : std::move(difference.difference);
+            }
+            foam::Field<float> field;
+            field.min = 0.0f;
+            field.max = 0.0f;
+            field.internal_data.resize(mesh.cell_centers.size(), 0.0f);
+            for (const auto& b : mesh.boundaries) {
+                field.boundaries_data.emplace_back(b.points.size(), 0.0f);
+            }
+            return field;
+        }
+
         inline void calc_minmax(const std::string& field_name) {
             if (!fields.at(field_name).minmax_set) {
                 for (int s = 0; s < static_cast<int>(player.steps.size()); ++s) {
-                    const auto field = mesh.load_scalar_field_from_file(player.steps.at(s), field_name);
+                    const auto field = foam::load_step_scalar_field(mesh, player.steps.at(s), field_name);
                     fields.at(field_name).min_scalar = glm::min(fields.at(field_name).min_scalar, field.min);
                     fields.at(field_name).max_scalar = glm::max(fields.at(field_name).max_scalar, field.max);
                 }
@@ -373,59 +426,44 @@ namespace tostf::vis
             }
         }
 
+        // Adds the statistics of a field over all steps as virtual fields, which do not change with the step.
+        inline void calc_temporal_statistics(const std::string& field_name) {
+            auto statistics = foam::calc_temporal_statistics(mesh, player.steps, field_name);
+            for (auto& s : statistics) {
+                Field_description desc{false};
+                desc.min_scalar = s.second.min;
+                desc.max_scalar = s.second.max;
+                desc.minmax_set = true;
+                fields.insert_or_assign(s.first, desc);
+                temporal_fields.insert_or_assign(s.first, std::move(s.second));
+            }
+        }
+
+        // Writes the datapoints once and the exported fields of the current step as float32 column files.
         inline void export_current_step() {
             const auto time_step = player.steps.at(player.current_step);
-            std::optional<std::string> empty_internal_data;
-            std::vector<std::optional<std::string>> empty_boundary_data_strs(mesh.boundaries.size());
-            if (!datapoint_str) {
-                datapoint_str = mesh.gen_datapoint_str();
-                save_str_to_file(export_path / "datapoints.txt", datapoint_str.value(), std::ios::out);
-            }
-            else {
-                save_str_to_file(export_path / "datapoints.txt", datapoint_str.value(), std::ios::out);
-            }
-            for (auto f : fields) {
-                log() << f.first;
-                if (f.first != "p" && f.first != "U" && f.first != "Q" && f.first != "Lambda2" && f.first != "wallShearStress") {
+            if (!datapoints_exported) {
+                foam::export_datapoints(mesh, export_path, foam::export_format::columns);
+                datapoints_exported = true;
+            }
+            std::vector<std::string> field_names;
+            for (const auto& f : fields) {
+                if (f.first != "p" && f.first != "U" && f.first != "Q" && f.first != "Lambda2"
+                    && f.first != "wallShearStress") {
                     continue;
                 }
-                std::string scalar_data_str;
-                auto scalar_data = mesh.load_scalar_field_from_file(player.steps.at(player.current_step), f.first);
-                if (!scalar_data.internal_data.empty()) {
-                    std::stringstream strstr;
-                    for (auto v : scalar_data.internal_data) {
-                        strstr << v << "\n";
-                    }
-                    scalar_data_str.append(strstr.str());
-                }
-                else {
-                    if (empty_internal_data) {
-                        scalar_data_str.append(empty_internal_data.value());
-                    }
+                if (foam::has_step_field(mesh, time_step, f.first)) {
+                    field_names.push_back(f.first);
                 }
-                for (unsigned b_id = 0; b_id < mesh.boundaries.size(); ++b_id) {
-                    if (!scalar_data.boundaries_data.at(b_id).empty()) {
-                        std::stringstream strstr;
-                        for (auto v : scalar_data.boundaries_data.at(b_id)) {
-                            strstr << v << "\n";
-                        }
-                        scalar_data_str.append(strstr.str());
-                    }
-                    else {
-                        if (empty_boundary_data_strs.at(b_id)) {
-                            scalar_data_str.append(empty_boundary_data_strs.at(b_id).value());
-                        }
-                    }
-                }
-                save_str_to_file(export_path / (f.first + "_" + time_step + ".txt"), scalar_data_str, std::ios::out);
             }
+            foam::export_step_fields(mesh, time_step, field_names, export_path, foam::export_format::columns);
         }
 
         inline void init_renderers() {
             surface_renderer.init(surface_mesh);
             points_renderer.init(mesh);
             volume_renderer.init(mesh.mesh_bb);
-            flow_renderer.init(mesh_scale, player.get_max_step_id());
+            flow_renderer.init(mesh_scale, player.get_max_step_id(), mesh, volume_renderer.grid_info);
             grid_ssbo = std::make_unique<SSBO>(vis_ssbo_defines::volume_grid);
             grid_ssbo->set_data(volume_renderer.grid_info);
             clipping.init();
@@ -443,16 +481,20 @@ namespace tostf::vis
         foam::Poly_mesh mesh;
         std::map<std::string, Point_to_mesh_interpolation> mesh_interpolations;
         std::map<std::string, Field_description> fields;
+        std::map<std::string, foam::Field<float>> temporal_fields;
+        const Case* difference_reference = nullptr;
+        std::shared_ptr<foam::Mesh_correspondence> correspondence;
         Player player;
         std::map<std::string, std::shared_ptr<Mesh>> surface_mesh;
         float mesh_scale = 1.0f;
         bool renderers_ready = false;
         std::filesystem::path export_path;
-        std::optional<std::string> datapoint_str;
+        bool datapoints_exported = false;
     };
 
     struct Case_comparer {
         void set_reference(const std::filesystem::path& case_path, const bool skip_first) {
+            disable_differences();
             reference = std::make_unique<Case>(case_path, skip_first);
             if (comparing) {
                 fields.clear();
@@ -464,6 +506,7 @@ namespace tostf::vis
         }
 
         void set_comparing_case(const std::filesystem::path& case_path, const bool skip_first) {
+            disable_differences();
             comparing = std::make_unique<Case>(case_path, skip_first);
             if (reference) {
                 fields.clear();
@@ -474,11 +517,53 @@ namespace tostf::vis
             }
         }
 
+        // Computes the temporal statistics in every case holding the field and keeps the selected field.
+        void calc_temporal_statistics(const std::string& field_name) {
+            const auto selected_name = get_field_name(selected_field);
+            for (auto* curr_case : {reference.get(), comparing.get()}) {
+                if (curr_case && curr_case->fields.find(field_name) != curr_case->fields.end()) {
+                    curr_case->calc_temporal_statistics(field_name);
+                }
+            }
+            update_fields(selected_name);
+        }
+
+        // Maps the comparing mesh onto the reference mesh, cached as correspondence.tmap in the comparing case, and
+        // adds the absolute and relative difference of every common step field as fields of both cases.
+        void enable_differences() {
+            if (!reference || !comparing) {
+                return;
+            }
+            const auto selected_name = get_field_name(selected_field);
+            comparing->correspondence = std::make_shared<foam::Mesh_correspondence>(
+                foam::load_or_build_mesh_correspondence(reference->mesh, comparing->mesh, difference_mode,
+                                                        comparing->path / "correspondence.tmap"));
+            comparing->difference_reference = reference.get();
+            for (const auto& f : merge_maps(reference->fields, comparing->fields)) {
+                if (reference->temporal_fields.find(f.first) != reference->temporal_fields.end()
+                    || foam::parse_difference_field_name(f.first)) {
+                    continue;
+                }
+                for (const auto relative : {false, true}) {
+                    const auto name = foam::gen_difference_field_name(f.first, relative);
+                    reference->fields.insert_or_assign(name, Field_description{false});
+                    comparing->fields.insert_or_assign(name, Field_description{false});
+                }
+            }
+            update_fields(selected_name);
+        }
+
+        bool has_differences() const {
+            return comparing && comparing->correspondence;
+        }
+
         void remove_reference() {
+            disable_differences();
             reference.reset();
         }
 
         void remove_comparing_case() {
+            disable_differences();
             comparing.reset();
         }
 
@@ -617,9 +702,45 @@ namespace tostf::vis
         std::map<std::string, Field_description> fields;
         int selected_colormap = 0;
         int selected_field = -1;
+        foam::correspondence_mode difference_mode = foam::correspondence_mode::nearest;
         Legend legend;
 
     private:
+        // Merges the fields of the cases again and keeps the field with the given name selected.
+        void update_fields(const std::string& selected_name) {
+            if (reference && comparing) {
+                fields = merge_maps(reference->fields, comparing->fields);
+            }
+            else if (reference || comparing) {
+                fields = reference ? reference->fields : comparing->fields;
+            }
+            const auto selected_it = fields.find(selected_name);
+            if (selected_field >= 0 && selected_it != fields.end()) {
+                selected_field = static_cast<int>(std::distance(fields.begin(), selected_it));
+            }
+        }
+
+        void disable_differences() {
+            if (!has_differences()) {
+                return;
+            }
+            const auto selected_name = get_field_name(selected_field);
+            comparing->difference_reference = nullptr;
+            comparing->correspondence.reset();
+            for (auto* curr_case : {reference.get(), comparing.get()}) {
+                if (!curr_case) {
+                    continue;
+                }
+                for (auto it = curr_case->fields.begin(); it != curr_case->fields.end();) {
+                    it = foam::parse_difference_field_name(it->first) ? curr_case->fields.erase(it) : std::next(it);
+                }
+            }
+            if (foam::parse_difference_field_name(selected_name)) {
+                selected_field = -1;
+            }
+            update_fields(selected_name);
+        }
+
         void merge_fields() {
             fields.clear();
             auto it_ref = reference->fields.begin();
@@ -0,0 +1,214 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#include "flow_seeding.hpp"
+#include "math/advanced_techniques.hpp"
+#include "utility/logging.hpp"
+#include <random>
+#include <algorithm>
+
+tostf::vis::Lumen_mask::Lumen_mask(const foam::Grid_info& grid_info, const foam::Poly_mesh& mesh) {
+    const foam::Volume_grid grid({grid_info.bb_min, grid_info.bb_max}, grid_info.cell_size);
+    _bb_min = grid.bb.min;
+    _cell_size = grid.cell_size;
+    _cell_count = grid.cell_count;
+    _cells.resize(grid.total_cell_count, 0);
+    // Same coverage as the splatting of the cells into the velocity texture.
+    for (int c = 0; c < static_cast<int>(mesh.cell_centers.size()); ++c) {
+        const auto radius = glm::vec4(glm::vec3(mesh.cell_radii.at(c)), 0.0f);
+        const auto min_index = grid.calc_bound_cell_index_3d(mesh.cell_centers.at(c) - radius);
+        const auto max_index = grid.calc_bound_cell_index_3d(mesh.cell_centers.at(c) + radius);
+        for (auto k = min_index.z; k <= max_index.z; ++k) {
+            for (auto j = min_index.y; j <= max_index.y; ++j) {
+                for (auto i = min_index.x; i <= max_index.x; ++i) {
+                    _cells.at(grid.convert_3d_index_to_1d({i, j, k})) = 1;
+                }
+            }
+        }
+    }
+}
+
+bool tostf::vis::Lumen_mask::is_inside(const glm::vec4& pos) const {
+    if (_cells.empty()) {
+        return true;
+    }
+    const auto rel_pos = (pos - _bb_min) / _cell_size;
+    if (rel_pos.x < 0.0f || rel_pos.y < 0.0f || rel_pos.z < 0.0f) {
+        return false;
+    }
+    const auto ijk = glm::ivec3(rel_pos);
+    if (ijk.x >= _cell_count.x || ijk.y >= _cell_count.y || ijk.z >= _cell_count.z) {
+        return false;
+    }
+    return _cells.at(ijk.z * _cell_count.x * _cell_count.y + ijk.y * _cell_count.x + ijk.x) != 0;
+}
+
+bool tostf::vis::Lumen_mask::empty() const {
+    return _cells.empty();
+}
+
+std::vector<tostf::Inlet> tostf::vis::find_inflow_boundaries(const foam::Poly_mesh& mesh,
+                                                             const std::vector<glm::vec4>& velocities) {
+    std::vector<Inlet> inlets;
+    for (const auto& b : mesh.boundaries) {
+        if (b.points.size() < 3 || b.name.find("wall") != std::string::npos) {
+            continue;
+        }
+        const auto plane = find_plane(b.points);
+        // The cells adjacent to the patch lie inside of the lumen.
+        glm::vec4 inward(0.0f);
+        glm::vec4 inflow(0.0f);
+        for (int f = 0; f < static_cast<int>(b.cell_refs.size()); ++f) {
+            inward += mesh.cell_centers.at(b.cell_refs.at(f)) - b.points.at(f);
+            if (!velocities.empty()) {
+                inflow += velocities.at(b.cell_refs.at(f));
+            }
+        }
+        Inlet inlet;
+        inlet.name = b.name;
+        inlet.center = plane.center;
+        inlet.normal = dot(glm::vec3(plane.normal), glm::vec3(inward)) > 0.0f ? -plane.normal : plane.normal;
+        inlet.tangent = plane.tangent;
+        inlet.bitangent = plane.bitangent;
+        for (const auto& p : b.points) {
+            inlet.radius = glm::max(inlet.radius, distance(glm::vec3(p), glm::vec3(plane.center)));
+        }
+        if (!velocities.empty() && dot(glm::vec3(inflow), glm::vec3(inlet.normal)) >= 0.0f) {
+            continue;
+        }
+        inlet.set_boundary_type(boundary_type::inlet);
+        inlets.push_back(inlet);
+    }
+    return inlets;
+}
+
+// Keeps the candidates inside the lumen and picks count of them evenly spread over the candidate order.
+// If too few candidates are inside, the accepted ones are repeated.
+std::vector<glm::vec4> select_seeds(const std::vector<glm::vec4>& candidates, const int count,
+                                    const tostf::vis::Seeding_settings& settings,
+                                    const tostf::vis::Lumen_mask& mask) {
+    std::vector<glm::vec4> accepted;
+    if (settings.reject_outside && !mask.empty()) {
+        accepted.reserve(candidates.size());
+        for (const auto& c : candidates) {
+            if (mask.is_inside(c)) {
+                accepted.push_back(c);
+            }
+        }
+    }
+    else {
+        accepted = candidates;
+    }
+    if (accepted.empty()) {
+        tostf::log_warning() << "No seed candidate lies inside of the lumen.";
+        accepted = candidates;
+    }
+    if (accepted.empty()) {
+        return {};
+    }
+    if (static_cast<int>(accepted.size()) < count) {
+        tostf::log_warning() << "Only " << accepted.size() << " of " << count
+            << " seeds lie inside of the lumen, seeds are repeated.";
+    }
+    std::vector<glm::vec4> seeds(count);
+    const auto stride = static_cast<double>(accepted.size()) / static_cast<double>(count);
+    for (int i = 0; i < count; ++i) {
+        const auto id = static_cast<size_t>(static_cast<double>(i) * stride);
+        seeds.at(i) = accepted.at(glm::min(id, accepted.size() - 1));
+    }
+    return seeds;
+}
+
+int get_candidate_count(const int count, const tostf::vis::Seeding_settings& settings,
+                        const tostf::vis::Lumen_mask& mask) {
+    if (settings.reject_outside && !mask.empty()) {
+        return count * glm::max(settings.candidates_per_seed, 1);
+    }
+    return count;
+}
+
+std::vector<glm::vec4> tostf::vis::gen_sphere_seeds(const int count, const float radius, const glm::vec3& center,
+                                                    const Seeding_settings& settings, const Lumen_mask& mask) {
+    const auto candidates = generate_points_on_sphere(get_candidate_count(count, settings, mask), radius, center);
+    return select_seeds(candidates, count, settings, mask);
+}
+
+std::vector<glm::vec4> tostf::vis::gen_inlet_seeds(const std::vector<Inlet>& inlets, const int count,
+                                                   const Seeding_settings& settings, const Lumen_mask& mask) {
+    if (inlets.empty()) {
+        return {};
+    }
+    float total_area = 0.0f;
+    for (const auto& inlet : inlets) {
+        total_area += inlet.radius * inlet.radius;
+    }
+    std::vector<glm::vec4> seeds;
+    seeds.reserve(count);
+    const auto golden_angle = glm::pi<float>() * (3.0f - glm::sqrt(5.0f));
+    for (int i = 0; i < static_cast<int>(inlets.size()); ++i) {
+        const auto& inlet = inlets.at(i);
+        // The last inlet receives the remaining seeds to compensate rounding.
+        const auto inlet_count = i + 1 == static_cast<int>(inlets.size())
+                                     ? count - static_cast<int>(seeds.size())
+                                     : static_cast<int>(static_cast<float>(count) * inlet.radius * inlet.radius
+                                                        / total_area);
+        if (inlet_count <= 0) {
+            continue;
+        }
+        const auto candidate_count = get_candidate_count(inlet_count, settings, mask);
+        const auto disk_radius = inlet.radius * settings.inlet_radius_factor;
+        const auto center = inlet.center - inlet.normal * inlet.radius * settings.inlet_offset;
+        std::vector<glm::vec4> candidates(candidate_count);
+#pragma omp parallel for
+        for (int c = 0; c < candidate_count; ++c) {
+            const auto r = disk_radius * glm::sqrt((static_cast<float>(c) + 0.5f) / static_cast<float>(candidate_count));
+            const auto theta = golden_angle * static_cast<float>(c);
+            candidates.at(c) = center + r * (glm::cos(theta) * inlet.tangent + glm::sin(theta) * inlet.bitangent);
+            candidates.at(c).w = 1.0f;
+        }
+        const auto inlet_seeds = select_seeds(candidates, inlet_count, settings, mask);
+        seeds.insert(seeds.end(), inlet_seeds.begin(), inlet_seeds.end());
+    }
+    return seeds;
+}
+
+std::vector<glm::vec4> tostf::vis::gen_velocity_weighted_seeds(const foam::Poly_mesh& mesh,
+                                                               const std::vector<glm::vec4>& velocities,
+                                                               const int count, const Seeding_settings& settings,
+                                                               const Lumen_mask& mask) {
+    if (velocities.size() != mesh.cell_centers.size()) {
+        throw std::runtime_error{"Velocity field does not match the mesh cells."};
+    }
+    std::vector<float> weights(velocities.size());
+#pragma omp parallel for
+    for (int i = 0; i < static_cast<int>(velocities.size()); ++i) {
+        weights.at(i) = length(glm::vec3(velocities.at(i)));
+    }
+    if (std::all_of(weights.begin(), weights.end(), [](const float w) { return w <= 0.0f; })) {
+        log_warning() << "Velocity field is zero everywhere, no seeds can be placed.";
+        return {};
+    }
+    std::mt19937 rng(settings.seed);
+    std::discrete_distribution<int> cell_dist(weights.begin(), weights.end());
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    const auto candidate_count = get_candidate_count(count, settings, mask);
+    std::vector<glm::vec4> seeds;
+    seeds.reserve(count);
+    for (int c = 0; c < candidate_count && static_cast<int>(seeds.size()) < count; ++c) {
+        const auto cell_id = cell_dist(rng);
+        // Rejection sampling of a point inside of the cell sphere.
+        glm::vec3 offset(1.0f);
+        while (dot(offset, offset) > 1.0f) {
+            offset = glm::vec3(uni(rng), uni(rng), uni(rng));
+        }
+        const auto seed = mesh.cell_centers.at(cell_id) + glm::vec4(offset * mesh.cell_radii.at(cell_id), 0.0f);
+        if (!settings.reject_outside || mask.is_inside(seed)) {
+            seeds.push_back(seed);
+        }
+    }
+    return select_seeds(seeds, count, settings, mask);
+}
@@ -0,0 +1,78 @@
+//
+// Alexander Scheid-Rehder
+// alexanderb@scheid-rehder.de
+// https://www.alexsr.de
+// https://github.com/alexsr
+//
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include "foam_processing/foam_loader.hpp"
+#include "foam_processing/volume_grid.hpp"
+#include "preprocessing/inlet_detection.hpp"
+
+namespace tostf::vis
+{
+    enum class seeding_strategy : int {
+        sphere,
+        inlet_planes,
+        velocity_weighted,
+        count
+    };
+
+    inline std::string seeding_strategy_to_str(const seeding_strategy strategy) {
+        switch (strategy) {
+            case seeding_strategy::sphere:
+                return "Sphere";
+            case seeding_strategy::inlet_planes:
+                return "Inlet planes";
+            case seeding_strategy::velocity_weighted:
+                return "Velocity weighted";
+            default:
+                return "Unknown";
+        }
+    }
+
+    struct Seeding_settings {
+        seeding_strategy strategy = seeding_strategy::sphere;
+        // Seeds outside of the lumen are discarded and replaced by further candidates.
+        bool reject_outside = true;
+        // Number of candidates generated per requested seed when rejecting seeds.
+        int candidates_per_seed = 8;
+        // Inlet seeds are placed on a disk with this fraction of the inlet radius.
+        float inlet_radius_factor = 0.9f;
+        // Distance of the inlet seeds to the inlet plane relative to the inlet radius.
+        float inlet_offset = 0.05f;
+        unsigned seed = 0;
+    };
+
+    // Voxel mask of the cells covered by the simulation mesh, uses the same grid as the velocity texture.
+    struct Lumen_mask {
+        Lumen_mask() = default;
+        Lumen_mask(const foam::Grid_info& grid_info, const foam::Poly_mesh& mesh);
+        bool is_inside(const glm::vec4& pos) const;
+        bool empty() const;
+    private:
+        glm::vec4 _bb_min{};
+        float _cell_size = 1.0f;
+        glm::ivec3 _cell_count{0};
+        std::vector<unsigned char> _cells;
+    };
+
+    // Fits an inlet to every boundary patch that is not a wall. The normals point out of the lumen.
+    // If velocities of the internal cells are given, only patches with inflow are returned.
+    std::vector<Inlet> find_inflow_boundaries(const foam::Poly_mesh& mesh,
+                                              const std::vector<glm::vec4>& velocities = {});
+
+    std::vector<glm::vec4> gen_sphere_seeds(int count, float radius, const glm::vec3& center,
+                                            const Seeding_settings& settings, const Lumen_mask& mask);
+    // Seeds are distributed on the inlets proportional to their area on a Fibonacci spiral.
+    std::vector<glm::vec4> gen_inlet_seeds(const std::vector<Inlet>& inlets, int count,
+                                           const Seeding_settings& settings, const Lumen_mask& mask);
+    // Importance sampling of the mesh cells with the velocity magnitude, seeds are jittered inside the cells.
+    std::vector<glm::vec4> gen_velocity_weighted_seeds(const foam::Poly_mesh& mesh,
+                                                       const std::vector<glm::vec4>& velocities, int count,
+                                                       const Seeding_settings& settings, const Lumen_mask& mask);
+}